@@ -67,26 +67,29 @@ vec3    center (0.0f, 0.0f, 0.0f),
         up_axis(0.0f, 0.0f, 1.0f);
 
 
-mat4 projector_matrix;
+/* The number of cascades, or slices of the camera frustum, that each get
+ * their own shadow map.  The lighting shader expects 3.
+ */
+#define N_CASCADE 3
 
-/* Variable to remember the original frame buffer ID.  On iOS, by default,
- * the screen uses a frame buffer, but not on Android.  This will allow you to
- * either set back the original frame buffer ID, or to simply detach the frame
- * buffer (by passing the value 0).
+/* The cascaded shadow maps, all rendered into the tiles of one depth
+ * texture.
+ */
+SHADOW *shadow = NULL;
+
+unsigned short shadow_resolution[N_CASCADE] = { 512, 256, 256 };
+                                        // The width and height of the
+                                        // tile of each cascade, from the
+                                        // nearest to the farthest.  The
+                                        // higher they are, the smoother
+                                        // the shadow will be, at the cost
+                                        // of fill rate and more video
+                                        // memory usage.
+
+/* The matrices of the cascades for the mesh being drawn, from its
+ * vertex positions to the shadow map texture coordinates.
  */
-int main_buffer;
-
-unsigned int depth_texture, // Depth texture ID
-             shadowmap_buffer,  // Frame buffer ID used for creating the shadow
-                                // map in real time.
-             shadowmap_width  = 128,    // The width and height of the
-             shadowmap_height = 256;    // depth texture that will be
-                                        // attached to the frame buffer.
-                                        // The higher the width and
-                                        // height, the smoother the
-                                        // shadow will be, at the cost
-                                        // of performance and more
-                                        // video memory usage.
+mat4 shadow_matrix[N_CASCADE];
 
 void program_bind_attrib_location(void *ptr) {
     PROGRAM *program = (PROGRAM *)ptr;
@@ -115,7 +118,7 @@ void program_draw(void *ptr)
                                1,
                                GL_FALSE,
                                gfx->get_modelview_projection_matrix().m());
-        } else if (name == "PROJECTOR") {
+        } else if (name == "SHADOWMAP") {
             glUniform1i(uniform.location,
                         0);
 
@@ -146,11 +149,18 @@ void program_draw(void *ptr)
                                1,
                                GL_FALSE,
                                gfx->get_normal_matrix().m());
-        } else if (name == "PROJECTORMATRIX") {
+        } else if (name == "SHADOWMATRIX" || name == "SHADOWMATRIX[0]") {
+            /* Some drivers report arrays with their first subscript. */
             glUniformMatrix4fv(uniform.location,
-                               1,
+                               N_CASCADE,
                                GL_FALSE,
-                               projector_matrix.m());
+                               shadow_matrix[0].m());
+        } else if (name == "SPLIT") {
+            /* The view distance at which each cascade ends. */
+            glUniform3f(uniform.location,
+                        shadow->cascade[0].split_far,
+                        shadow->cascade[1].split_far,
+                        shadow->cascade[2].split_far);
         } else if (name == "MATERIAL.ambient") {
             // Material Data
             glUniform4fv(uniform.location,
@@ -248,187 +258,18 @@ void templateAppInit(int width, int height)
 
     obj->get_mesh((char *)"projector", false)->visible = false;
     
-    /* Get the current frame buffer ID that is bound to the current GL
-     * context.  If there is none, the value returned will be less than
-     * 0 (if you are using Android); in this case, clamp the main_buffer
-     * variable to 0 to unbind the framebuffer.  If you are running the
-     * app on iOS you will get the current frame buffer ID and will
-     * reuse it to switch between the shadowmap_buffer ID and the
-     * original ID created by the system.  Very convenient!
-     */
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &main_buffer);
-
-    if (main_buffer < 0) main_buffer = 0;
-
-    /* Generate a new frame buffer ID. */
-    glGenFramebuffers(1, &shadowmap_buffer);
-
-    /* Bind the new framebuffer ID. */
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowmap_buffer);
-
-    /* Create a new texture ID. */
-    glGenTextures(1, &depth_texture);
-
-    /* Bind the new texture ID. */
-    glBindTexture(GL_TEXTURE_2D, depth_texture);
-
-    /* Set the magnification and minification filters to not use
-     * interpolation.
-     */
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    /* Set the texture wrap to be clamped to the edge of the texture.
-     * Just like in the projector tutorial, this will force the UV
-     * values to stay in the range of 0 to 1.
+    /* Create the cascades and the frame buffer with the depth texture
+     * atlas their tiles are laid out in, and no color buffer.  Note that
+     * your GL implementation needs to have the extension
+     * GL_OES_depth_texture available for this tutorial to work.  Casters
+     * up to 20 units behind a cascade, toward the light, still shadow it.
      */
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    /* Create a blank depth texture using the size of the shadow map
-     * specified above.  Note that your GL implementation needs to
-     * have the extension GL_OES_depth_texture available for this
-     * tutorial to work and be able to create a texture using the
-     * GL_DEPTH_COMPONENT pixel format.
-     */
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_DEPTH_COMPONENT,
-                 shadowmap_width,
-                 shadowmap_height,
-                 0,
-                 GL_DEPTH_COMPONENT,
-                 /* Request a 16-bit depth buffer. */
-                 GL_UNSIGNED_SHORT,
-                 NULL);
-
-    /* Unbind the texture. */
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    /* Attach the depth texture to the frame buffer.  This will allow
-     * you to use this texture as a depth buffer.
-     */
-    glFramebufferTexture2D(GL_FRAMEBUFFER,
-                           GL_DEPTH_ATTACHMENT,
-                           GL_TEXTURE_2D,
-                           depth_texture,
-                           0);
+    shadow = new SHADOW(N_CASCADE, shadow_resolution, 0.75f, 20.0f);
 }
 
 
-void draw_scene_from_projector(void)
+void set_camera(void)
 {
-    /* Set up the projection matrix to use the same field of view as the
-     * spot.  The idea behind this block is to pretend to render the scene
-     * from the eye of the spot, and then, later on, reuse the projection
-     * and modelview matrices to transform the vertex position inside the
-     * shader program to be in that same coordinate system.  The result of
-     * this operation will allow you to automatically generate the UV
-     * coordinates from the projector (the spot) and project the texture
-     * on the objects of the scene.
-     */
-    gfx->set_matrix_mode(PROJECTION_MATRIX);
-    gfx->load_identity();
-
-    gfx->set_perspective(light->spot_fov,
-                         (float)viewport_matrix[2] / (float)viewport_matrix[3],
-                           1.0f,
-                          20.0f,
-                         -90.0f);
-
-    gfx->set_matrix_mode(MODELVIEW_MATRIX);
-    gfx->load_identity();
-    /* Execute a look_at to be able to gather the modelview matrix.  Note
-     * that the position of the light and the camera as well as the
-     * projection matrix are the same.  This will allow you to pretend that
-     * the scene is rendered from the light point of view without really
-     * drawing anything, just gather the necessary matrices to be able to
-     * project the texture from the spot.
-     */
-    gfx->look_at(*(vec3 *)&light->position, center, up_axis);
-
-    projector_matrix[0][0] = 0.5f;
-    projector_matrix[0][1] = 0.0f;
-    projector_matrix[0][2] = 0.0f;
-    projector_matrix[0][3] = 0.0f;
-
-    projector_matrix[1][0] = 0.0f;
-    projector_matrix[1][1] = 0.5f;
-    projector_matrix[1][2] = 0.0f;
-    projector_matrix[1][3] = 0.0f;
-
-    projector_matrix[2][0] = 0.0f;
-    projector_matrix[2][1] = 0.0f;
-    projector_matrix[2][2] = 0.5f;
-    projector_matrix[2][3] = 0.0f;
-
-    projector_matrix[3][0] = 0.5f;
-    projector_matrix[3][1] = 0.5f;
-    projector_matrix[3][2] = 0.5f;
-    projector_matrix[3][3] = 1.0f;
-
-    projector_matrix =
-        gfx->get_modelview_projection_matrix() * projector_matrix;
-
-    /* Bind the shadowmap buffer to redirect the drawing to the shadowmap
-     * frame buffer.
-     */
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowmap_buffer);
-
-    /* Resize the viewport to fit the shadow map width and height. */
-    glViewport(0, 0, shadowmap_width, shadowmap_height);
-
-    /* Clear the depth buffer, which will basically clear the content
-     * of the depth_texture.
-     */
-    glClear(GL_DEPTH_BUFFER_BIT);
-
-    /* Cull the front faces.  Because you are trying to render real-time
-     * shadows, you are only interested in the back face of the object,
-     * which basically is the surface that casts the shadow.  By culling
-     * the front face, you will be able to cast shadows for the allow
-     * objects to cast shadows on themselves.
-     */
-    glCullFace(GL_FRONT);
-
-    /* Get the writedepth shader program. */
-    PROGRAM *program = obj->get_program("writedepth", false);
-
-    /* Assign the shader to all materials. */
-    for (auto objmaterial=obj->objmaterial.begin();
-         objmaterial!=obj->objmaterial.end(); ++objmaterial) {
-        objmaterial->program = program;
-    }
-
-    /* Draw the scene as you normally do.  This will fill the
-     * depth_texture values.
-     */
-    for (objmesh=obj->objmesh.begin();
-         objmesh!=obj->objmesh.end(); ++objmesh) {
-
-        gfx->push_matrix();
-
-        gfx->translate(objmesh->location);
-
-        objmesh->draw();
-
-        gfx->pop_matrix();
-    }
-    
-    /* Restore that back faces should be culled. */
-    glCullFace(GL_BACK);
-}
-
-
-void draw_scene(void)
-{
-    glBindFramebuffer(GL_FRAMEBUFFER, main_buffer);
-
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-
-    glViewport(0, 0, viewport_matrix[2], viewport_matrix[3]);
-
     gfx->set_matrix_mode(PROJECTION_MATRIX);
     gfx->load_identity();
 
@@ -460,11 +301,46 @@ void draw_scene(void)
                            -sinAlpha*sinBeta, cosAlpha*sinBeta));
 
     gfx->translate(-14.0f, 12.0f, -7.0f);
+}
+
+
+void draw_scene_from_light(void)
+{
+    /* Cut the camera frustum into the cascades and fit an orthographic
+     * projection, looking down the direction of the spot, around each
+     * one of them.  The camera matrices have to be the ones the scene
+     * will be drawn with.  The scene is between 12 and 31 units away
+     * from the camera: only cover 10 to 35 instead of the whole 0.1 to
+     * 100 given to set_perspective(), so that no texel is spent on
+     * empty space.
+     */
+    set_camera();
+
+    shadow->update(center - vec3(light->position, true),
+                   gfx->get_modelview_matrix(),
+                   gfx->get_projection_matrix(),
+                   10.0f,
+                   35.0f);
+
+    /* Draw the meshes that cast a shadow in each cascade into its tile
+     * with the writedepth shader.  The front faces are culled, so that
+     * the depth texture holds the back faces of the objects, which
+     * basically are the surfaces that cast the shadows.  This will fill
+     * the depth texture values.
+     */
+    shadow->draw(gfx, obj, obj->get_program("writedepth", false));
+}
+
+
+void draw_scene(void)
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+    glViewport(0, 0, viewport_matrix[2], viewport_matrix[3]);
+
+    set_camera();
 
-    mat4 projector_matrix_copy;
-    
-    projector_matrix_copy = projector_matrix;
-    
     /* Get the lighting shader program. */
     PROGRAM *program = obj->get_program("lighting", false);
 
@@ -476,9 +352,11 @@ void draw_scene(void)
         objmaterial->program = program;
     }
     
-    /* Bind and make the depth_texture active on the texture channel 0. */
+    /* Bind and make the depth texture atlas active on the texture
+     * channel 0.
+     */
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, depth_texture);
+    shadow->get_texture()->draw();
 
     /* Reset the counter to loop through the objects. */
     for (objmesh=obj->objmesh.begin();
@@ -488,12 +366,17 @@ void draw_scene(void)
 
         gfx->translate(objmesh->location);
 
-        TStack  l;
-        l.loadMatrix(projector_matrix_copy);
+        /* The cascade matrices go from world space, move them to the
+         * space of the mesh vertices.
+         */
+        for (int i=0; i!=N_CASCADE; ++i) {
+            TStack  l;
+            l.loadMatrix(shadow->cascade[i].shadow_matrix);
 
-        l.translate(objmesh->location);
-        
-        projector_matrix = l.back();
+            l.translate(objmesh->location);
+
+            shadow_matrix[i] = l.back();
+        }
 
         objmesh->draw();
         
@@ -503,15 +386,15 @@ void draw_scene(void)
 
 
 void templateAppDraw(void) {
-    draw_scene_from_projector();
+    draw_scene_from_light();
 
     draw_scene();
 }
 
 
 void templateAppExit(void) {
-    glDeleteFramebuffers(1, &shadowmap_buffer);
-    glDeleteTextures(1, &depth_texture);
+    delete shadow;
+    shadow = NULL;
 
     delete light;
     light = NULL;
@@ -30,6 +30,7 @@ class GL2View extends GLSurfaceView implements SurfaceHolder.Callback
         setRenderer( r );
         
         r.apkFilePath = context.getPackageResourcePath();
+        r.cacheDirPath = context.getCacheDir().getAbsolutePath();
 	}
 
     private static class ContextFactory implements GLSurfaceView.EGLContextFactory
@@ -183,13 +184,14 @@ class GL2View extends GLSurfaceView implements SurfaceHolder.Callback
         }
      } 
     
-    public static native void Init( int w, int h, String apkFilePath );
+    public static native void Init( int w, int h, String apkFilePath, String cacheDirPath );
      
     public static native void Draw();
      
     public static class Renderer implements GLSurfaceView.Renderer
     {
     	public String apkFilePath;
+    	public String cacheDirPath;
     	public int	  width;
     	public int	  height;
     	
@@ -204,7 +206,7 @@ class GL2View extends GLSurfaceView implements SurfaceHolder.Callback
         		this.width  = width;
         		this.height = height;
         		
-         		Init( width, height, apkFilePath );
+         		Init( width, height, apkFilePath, cacheDirPath );
 	        	init_once = 1;
         	}
         }
@@ -225,6 +225,12 @@ void templateAppInit(int width, int height)
         objmaterial->set_draw_callback(material_draw);
     }
 
+    /* Keep the binary form of the MD5 files in the writable directory
+     * the platform code exported as CACHE, so that the next runs load
+     * them instead of parsing the text files again.
+     */
+    RESOURCE::set_cache_path(getenv("CACHE"));
+
     /* Load the MD5 mesh file from disk. */
     md5 = new MD5(MD5_MESH, true);
 
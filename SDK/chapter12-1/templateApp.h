@@ -71,7 +71,7 @@ void templateAppExit( void );
 
 		extern "C"
 		{
-			JNIEXPORT void JNICALL Java_com_android_templateApp_GL2View_Init( JNIEnv *env, jobject obj, jint width, jint height, jstring apkFilePath );
+			JNIEXPORT void JNICALL Java_com_android_templateApp_GL2View_Init( JNIEnv *env, jobject obj, jint width, jint height, jstring apkFilePath, jstring cacheDirPath );
 
 			JNIEXPORT void JNICALL Java_com_android_templateApp_GL2View_Draw( JNIEnv *env, jobject obj );
 
@@ -84,10 +84,12 @@ void templateAppExit( void );
 			JNIEXPORT void JNICALL Java_com_android_templateApp_templateApp_Accelerometer( JNIEnv *env, jobject obj, jfloat x, jfloat y, jfloat z );
 		};
 
-		JNIEXPORT void JNICALL Java_com_android_templateApp_GL2View_Init( JNIEnv *env, jobject obj, jint width, jint height, jstring apkFilePath )
+		JNIEXPORT void JNICALL Java_com_android_templateApp_GL2View_Init( JNIEnv *env, jobject obj, jint width, jint height, jstring apkFilePath, jstring cacheDirPath )
 		{
 			setenv( "FILESYSTEM", env->GetStringUTFChars( apkFilePath, NULL ), 1 );
 
+			setenv( "CACHE", env->GetStringUTFChars( cacheDirPath, NULL ), 1 );
+
 			if( templateApp.Init ) templateApp.Init( width, height );
 		}
 
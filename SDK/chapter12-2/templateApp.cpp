@@ -88,6 +88,11 @@ vec3 rot_angle(0.0f, 0.0f, 0.0f);
 
 bool auto_rotate = false;
 
+/* Set by a triple tap: the next frame runs the benchmarks below and
+ * prints their results to the console.
+ */
+bool benchmark = false;
+
 
 void program_bind_attrib_location(void *ptr) {
     PROGRAM *program = (PROGRAM *)ptr;
@@ -172,6 +177,684 @@ void material_draw(void *ptr)
 }
 
 
+/* Benchmarks.  Build the app with and without GLML_USE_SIMD to compare
+ * the two glml backends.
+ */
+#define BENCHMARK_MATRIX 64
+
+#define BENCHMARK_LOOP   100000
+
+/* The timed loops sum their results in here, so that they are not
+ * optimized away.
+ */
+volatile float benchmark_sink;
+
+
+/* Affine matrices made of a translation, a rotation and a non uniform
+ * scale, the kind the model view stack holds.
+ */
+void benchmark_build_matrix(mat4 *m)
+{
+    TStack tstack;
+
+    for (int i=0; i!=BENCHMARK_MATRIX; ++i) {
+        tstack.loadTranslation(i * 0.5f - 16.0f, i * 0.25f, 3.0f - i * 0.125f);
+
+        tstack.rotate(i * 17.0f, vec3(1.0f, i * 0.1f, 0.5f).normalize());
+
+        tstack.scale(1.0f + i * 0.03f, 0.5f + i * 0.01f, 2.0f);
+
+        m[i] = tstack.back();
+    }
+}
+
+
+/* The closed form mat4 and mat3 inverses, and the affine mat4 path,
+ * against the double precision inverse: largest error, and time per
+ * call.
+ */
+void benchmark_inverse(void)
+{
+    mat4 m[BENCHMARK_MATRIX], r;
+
+    float error[3] = { 0.0f, 0.0f, 0.0f };
+
+    benchmark_build_matrix(m);
+
+    for (int i=0; i!=BENCHMARK_MATRIX; ++i) {
+        dmat4 d;
+
+        dmat3 d3;
+
+        mat3 m3;
+
+        for (int j=0; j!=4; ++j) {
+            for (int k=0; k!=4; ++k) {
+                d[j][k] = m[i][j][k];
+
+                if (j != 3 && k != 3) d3[j][k] = m3[j][k] = m[i][j][k];
+            }
+        }
+
+        dmat4 e  = inverse(d);
+
+        dmat3 e3 = inverse(d3);
+
+        mat4 a = inverse(m[i]),
+             b = affineInverse(m[i]);
+
+        mat3 c = inverse(m3);
+
+        for (int j=0; j!=4; ++j) {
+            for (int k=0; k!=4; ++k) {
+                error[0] = std::max(error[0], (float)fabs(a[j][k] - e[j][k]));
+                error[1] = std::max(error[1], (float)fabs(b[j][k] - e[j][k]));
+
+                if (j != 3 && k != 3)
+                    error[2] = std::max(error[2], (float)fabs(c[j][k] - e3[j][k]));
+            }
+        }
+    }
+
+    unsigned int time[3];
+
+    time[0] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i)
+        r += inverse(m[i % BENCHMARK_MATRIX]);
+
+    time[1] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i)
+        r += affineInverse(m[i % BENCHMARK_MATRIX]);
+
+    time[2] = get_micro_time();
+
+    benchmark_sink = r[0][0];
+
+    console_print("mat4 inverse:       %6.1f ns, error %g\n",
+                  (time[1] - time[0]) * 1000.0f / BENCHMARK_LOOP,
+                  error[0]);
+
+    console_print("mat4 affineInverse: %6.1f ns, error %g\n",
+                  (time[2] - time[1]) * 1000.0f / BENCHMARK_LOOP,
+                  error[1]);
+
+    console_print("mat3 inverse:       error %g\n", error[2]);
+}
+
+
+/* The float vec4 and mat4 arithmetic, which GLML_USE_SIMD replaces, and
+ * the quaternion product against the scalar double precision templates:
+ * largest error, and time per call of the operators and of the TStack
+ * calls built on them.
+ */
+void benchmark_glml(void)
+{
+    mat4 m[BENCHMARK_MATRIX], p, r;
+
+    vec4 v;
+
+    quaternion q[BENCHMARK_MATRIX], s;
+
+    TStack tstack;
+
+    float error[3] = { 0.0f, 0.0f, 0.0f };
+
+    benchmark_build_matrix(m);
+
+    tstack.loadPerspective(45.0f, 0.75f, 0.1f, 100.0f);
+
+    p = tstack.back();
+
+    for (int i=0; i!=BENCHMARK_MATRIX; ++i) {
+        float a = i * 0.1f;
+
+        q[i] = quaternion(cosf(a), sinf(a) * 0.6f, sinf(a) * 0.8f, 0.0f);
+    }
+
+    for (int i=0; i!=BENCHMARK_MATRIX; ++i) {
+        const mat4 &a = m[i],
+                   &b = i & 1 ? p : m[(i + 1) % BENCHMARK_MATRIX];
+
+        const quaternion &c = q[i],
+                         &d = q[(i + 7) % BENCHMARK_MATRIX];
+
+        dmat4 da, db;
+
+        dvec4 dv;
+
+        for (int j=0; j!=4; ++j) {
+            for (int k=0; k!=4; ++k) {
+                da[j][k] = a[j][k];
+                db[j][k] = b[j][k];
+            }
+
+            dv[j] = a[3][j];
+        }
+
+        dmat4 dr = da * db;
+
+        dvec4 du = dv * db;
+
+        dquaternion dq(c->r, dvec3(c->i, c->j, c->k));
+
+        dq *= dquaternion(d->r, dvec3(d->i, d->j, d->k));
+
+        r = a * b;
+
+        v = a[3] * b;
+
+        s = c * d;
+
+        for (int j=0; j!=4; ++j) {
+            for (int k=0; k!=4; ++k)
+                error[0] = std::max(error[0], (float)fabs(r[j][k] - dr[j][k]));
+
+            error[1] = std::max(error[1], (float)fabs(v[j] - du[j]));
+        }
+
+        error[2] = std::max(error[2], (float)fabs(s->r - dq->r));
+        error[2] = std::max(error[2], (float)fabs(s->i - dq->i));
+        error[2] = std::max(error[2], (float)fabs(s->j - dq->j));
+        error[2] = std::max(error[2], (float)fabs(s->k - dq->k));
+    }
+
+    unsigned int time[6];
+
+    time[0] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i)
+        r += m[i % BENCHMARK_MATRIX] * p;
+
+    time[1] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i)
+        v += m[i % BENCHMARK_MATRIX][3] * p;
+
+    time[2] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i)
+        s += q[i % BENCHMARK_MATRIX] * q[(i + 7) % BENCHMARK_MATRIX];
+
+    time[3] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i) {
+        tstack.loadMatrix(m[i % BENCHMARK_MATRIX]);
+
+        tstack.multiplyMatrix(p);
+    }
+
+    time[4] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_LOOP; ++i) {
+        tstack.loadMatrix(m[i % BENCHMARK_MATRIX]);
+
+        tstack.rotate(q[i % BENCHMARK_MATRIX]);
+    }
+
+    time[5] = get_micro_time();
+
+    benchmark_sink = r[0][0] + v[0] + s->r + tstack.back()[0][0];
+
+#ifdef GLML_SIMD
+    console_print("glml backend:       SIMD\n");
+#else
+    console_print("glml backend:       scalar\n");
+#endif
+
+    console_print("mat4 * mat4:        %6.1f ns, error %g\n",
+                  (time[1] - time[0]) * 1000.0f / BENCHMARK_LOOP,
+                  error[0]);
+
+    console_print("vec4 * mat4:        %6.1f ns, error %g\n",
+                  (time[2] - time[1]) * 1000.0f / BENCHMARK_LOOP,
+                  error[1]);
+
+    console_print("quaternion product: %6.1f ns, error %g\n",
+                  (time[3] - time[2]) * 1000.0f / BENCHMARK_LOOP,
+                  error[2]);
+
+    console_print("multiplyMatrix:     %6.1f ns\n",
+                  (time[4] - time[3]) * 1000.0f / BENCHMARK_LOOP);
+
+    console_print("rotate(quaternion): %6.1f ns\n",
+                  (time[5] - time[4]) * 1000.0f / BENCHMARK_LOOP);
+}
+
+
+/* The CPU skinning of set_pose(), the 4-wide streams on one thread then on
+ * MD5_MAX_THREAD, against the scalar MD5MESH::skin() loop they replaced:
+ * vertices skinned per millisecond, and the largest difference between
+ * the two.
+ */
+#define BENCHMARK_POSE 200
+
+void benchmark_skin(void)
+{
+    if (md5->gpu_skin) return;
+
+    const std::vector<MD5JOINT> &pose = idle->pose;
+
+    std::vector<std::vector<unsigned char> > vertex_data(md5->md5mesh.size());
+
+    unsigned int n_vertex = 0,
+                 n_thread = md5->n_thread,
+                 time[4];
+
+    float error = 0.0f;
+
+    md5->compute_pose(pose);
+
+    for (unsigned int i=0; i!=md5->md5mesh.size(); ++i) {
+        MD5MESH *md5mesh = &md5->md5mesh[i];
+
+        vertex_data[i].assign(md5mesh->vertex_data,
+                              md5mesh->vertex_data + md5mesh->size);
+
+        md5mesh->skin(pose);
+
+        n_vertex += md5mesh->md5meshdata->md5vertex.size();
+
+        /* Positions, normals and tangents, the texture coordinates are
+         * not skinned.
+         */
+        for (int j=0; j!=4; ++j) {
+            if (j == 2) continue;
+
+            const float *a = (float *)&vertex_data[i][md5mesh->offset[j]],
+                        *b = (float *)&md5mesh->vertex_data[md5mesh->offset[j]];
+
+            for (unsigned int k=0; k!=md5mesh->offset[1] / sizeof(float); ++k)
+                error = std::max(error, fabsf(a[k] - b[k]));
+        }
+    }
+
+    time[0] = get_micro_time();
+
+    md5->n_thread = 1;
+
+    for (int i=0; i!=BENCHMARK_POSE; ++i) md5->compute_pose(pose);
+
+    time[1] = get_micro_time();
+
+    md5->n_thread = MD5_MAX_THREAD;
+
+    for (int i=0; i!=BENCHMARK_POSE; ++i) md5->compute_pose(pose);
+
+    time[2] = get_micro_time();
+
+    for (int i=0; i!=BENCHMARK_POSE; ++i) {
+        for (auto md5mesh=md5->md5mesh.begin();
+             md5mesh!=md5->md5mesh.end(); ++md5mesh) md5mesh->skin(pose);
+    }
+
+    time[3] = get_micro_time();
+
+    md5->n_thread = n_thread;
+
+    float n = n_vertex * BENCHMARK_POSE * 1000.0f;
+
+    console_print("skinning, %u vertices, error %g\n", n_vertex, error);
+
+    console_print("  streams, 1 thread:  %8.0f vertices/ms\n",
+                  n / (time[1] - time[0]));
+
+    console_print("  streams, %d threads: %8.0f vertices/ms\n",
+                  MD5_MAX_THREAD,
+                  n / (time[2] - time[1]));
+
+    console_print("  MD5MESH::skin():    %8.0f vertices/ms\n",
+                  n / (time[3] - time[2]));
+}
+
+
+/* The bounds update_bound_pose() builds from the joint boxes against the
+ * exact ones, over every frame of the idle animation: no vertex may be
+ * outside, and the extra volume is what the culling loses.
+ */
+void benchmark_bound(void)
+{
+    if (md5->gpu_skin) return;
+
+    const MD5ANIM *md5anim = idle->md5anim;
+
+    std::vector<MD5JOINT> pose = md5->bind_pose;
+
+    vec3 min, max;
+
+    float outside = 0.0f,
+          volume  = 0.0f;
+
+    for (unsigned int i=0; i!=md5anim->n_frame; ++i) {
+        md5anim->get_pose(i, pose);
+
+        md5->compute_pose(pose);
+
+        md5->update_bound_pose(pose);
+
+        md5->get_bound_mesh(min, max);
+
+        for (int j=0; j!=3; ++j) {
+            outside = std::max(outside, md5->min[j] - min[j]);
+            outside = std::max(outside, max[j] - md5->max[j]);
+        }
+
+        vec3 exact = max - min;
+
+        volume += (md5->dimension->x * md5->dimension->y * md5->dimension->z) /
+                  (exact->x * exact->y * exact->z);
+    }
+
+    md5->set_pose(idle->pose);
+
+    console_print("bounds, %u frames: farthest vertex outside %g, volume %.2fx exact\n",
+                  md5anim->n_frame,
+                  outside,
+                  volume / md5anim->n_frame);
+}
+
+
+/* frustum_query() on fields of 1x1x1 boxes that grow with their number,
+ * seen from the middle by a camera whose far plane keeps the visible part
+ * the same size, against box_in_frustum() on every box: the work done by
+ * the tree should grow with its depth, not with the number of boxes.
+ */
+#define BENCHMARK_QUERY 64
+
+void benchmark_bvh(void)
+{
+    static const unsigned int n_box[3] = { 1000, 10000, 100000 };
+
+    std::vector<unsigned int> result;
+
+    vec4 frustum[6];
+
+    console_print("frustum_query, far plane 50, average of %d views:\n",
+                  BENCHMARK_QUERY);
+
+    for (int i=0; i!=3; ++i) {
+        BVH bvh;
+
+        float side = 2.0f * sqrtf(n_box[i]);
+
+        unsigned int n_node_visit = 0,
+                     n_item_test  = 0,
+                     n_early_in   = 0,
+                     n_visible[2] = { 0, 0 },
+                     time[4];
+
+        srand(1);
+
+        for (unsigned int j=0; j!=n_box[i]; ++j) {
+            vec3 location(((float)rand() / RAND_MAX - 0.5f) * side,
+                          ((float)rand() / RAND_MAX - 0.5f) * side,
+                          0.5f);
+
+            bvh.add(location - vec3(0.5f, 0.5f, 0.5f),
+                    location + vec3(0.5f, 0.5f, 0.5f),
+                    NULL);
+        }
+
+        time[0] = get_micro_time();
+
+        bvh.build();
+
+        time[1] = get_micro_time();
+
+        time[2] = time[3] = 0;
+
+        for (int j=0; j!=BENCHMARK_QUERY; ++j) {
+            TStack modelview,
+                   projection;
+
+            float angle = j * 360.0f / BENCHMARK_QUERY * DEG_TO_RAD;
+
+            projection.loadPerspective(80.0f, 1.5f, 1.0f, 50.0f);
+
+            modelview.loadLookAt(vec3(0.0f, 0.0f, 1.8f),
+                                 vec3(cosf(angle), sinf(angle), 1.8f),
+                                 vec3(0.0f, 0.0f, 1.0f));
+
+            build_frustum(frustum, modelview.back(), projection.back());
+
+            result.clear();
+
+            unsigned int start = get_micro_time();
+
+            bvh.frustum_query(frustum, result);
+
+            unsigned int middle = get_micro_time();
+
+            for (unsigned int k=0; k!=n_box[i]; ++k) {
+                vec3 location  = (bvh.bvhitem[k].min + bvh.bvhitem[k].max) * 0.5f,
+                     dimension = (bvh.bvhitem[k].max - bvh.bvhitem[k].min) * 0.5f;
+
+                if (box_in_frustum(frustum, &location, &dimension)) ++n_visible[1];
+            }
+
+            time[2] += middle - start;
+            time[3] += get_micro_time() - middle;
+
+            n_visible[0] += result.size();
+
+            n_node_visit += bvh.n_node_visit;
+            n_item_test  += bvh.n_item_test;
+            n_early_in   += bvh.n_early_in;
+        }
+
+        console_print("  %6u boxes, depth %2u, built in %6.1f ms, %5u visible (%u linear)\n",
+                      n_box[i],
+                      bvh.get_depth(),
+                      (time[1] - time[0]) * 0.001f,
+                      n_visible[0] / BENCHMARK_QUERY,
+                      n_visible[1] / BENCHMARK_QUERY);
+
+        console_print("    tree:   %8.1f us, %5u nodes, %5u items, %4u subtrees in\n",
+                      (float)time[2] / BENCHMARK_QUERY,
+                      n_node_visit / BENCHMARK_QUERY,
+                      n_item_test  / BENCHMARK_QUERY,
+                      n_early_in   / BENCHMARK_QUERY);
+
+        console_print("    linear: %8.1f us\n",
+                      (float)time[3] / BENCHMARK_QUERY);
+    }
+}
+
+
+/* A crowd of bobs, each at its own time in the idle action, animated by
+ * MD5ANIMATOR with 1, 2, 4... worker threads: the milliseconds per frame
+ * of each stage summed over the workers, from the start of a frame to its
+ * last job, and on the GL thread waiting for the workers and uploading,
+ * with the jobs each worker took.  There is no blend tree, so no blend
+ * stage.  Then the same crowd spread over a field in front of the camera
+ * with three LOD bands: what each band and the culling leave to do.
+ */
+#define BENCHMARK_CROWD 128
+
+#define BENCHMARK_FRAME 60
+
+MD5 *benchmark_crowd_member(unsigned int index)
+{
+    MD5 *member = new MD5(MD5_MESH, true);
+
+    member->build();
+
+    member->load_action((char *)"idle",
+                        (char *)"bob_idle.md5anim",
+                        true);
+
+    MD5ACTION *md5action = member->get_action((char *)"idle", false);
+
+    md5action->set_action_fps(24.0f);
+
+    md5action->action_play(MD5_METHOD_SLERP, true);
+
+    member->draw_action(index * 0.05f);
+
+    return member;
+}
+
+
+void benchmark_crowd(void)
+{
+    std::vector<MD5 *> crowd;
+
+    for (unsigned int i=0; i!=BENCHMARK_CROWD; ++i)
+        crowd.push_back(benchmark_crowd_member(i));
+
+    console_print("MD5ANIMATOR, %d bobs, average of %d frames:\n",
+                  BENCHMARK_CROWD,
+                  BENCHMARK_FRAME);
+
+    for (unsigned int n_thread=1; n_thread<=MD5_ANIMATOR_MAX_THREAD; n_thread<<=1) {
+        MD5ANIMATOR md5animator(n_thread);
+
+        float time[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (unsigned int i=0; i!=BENCHMARK_CROWD; ++i)
+            md5animator.add(crowd[i]);
+
+        /* The first update() only starts a frame. */
+        md5animator.update(1.0f / 60.0f);
+
+        for (int i=0; i!=BENCHMARK_FRAME; ++i) {
+            md5animator.update(1.0f / 60.0f);
+
+            time[0] += md5animator.time_sample;
+            time[1] += md5animator.time_skin;
+            time[2] += md5animator.time_frame;
+            time[3] += md5animator.time_wait;
+            time[4] += md5animator.time_upload;
+        }
+
+        md5animator.finish();
+
+        console_print("  %u threads: sample %6.2f skin %6.2f frame %6.2f wait %6.2f upload %5.2f ms, jobs",
+                      md5animator.n_thread,
+                      time[0] / BENCHMARK_FRAME,
+                      time[1] / BENCHMARK_FRAME,
+                      time[2] / BENCHMARK_FRAME,
+                      time[3] / BENCHMARK_FRAME,
+                      time[4] / BENCHMARK_FRAME);
+
+        for (unsigned int i=0; i!=md5animator.n_thread; ++i)
+            console_print(" %u", md5animator.n_job[i]);
+
+        console_print("\n");
+    }
+
+    /* A field of 16 by 8 bobs ahead of an eye at the height of their
+     * heads, wider than the view: the outer columns are culled the way
+     * MD5::draw() would.  The far band holds its vertices between samples
+     * and drops the sword, the sheath and the lamp.
+     */
+    {
+        MD5ANIMATOR md5animator(MD5_ANIMATOR_MAX_THREAD);
+
+        TStack modelview,
+               projection;
+
+        vec4 frustum[6];
+
+        vec3 eye(0.0f, 0.0f, 5.0f);
+
+        unsigned int n[6] = { 0, 0, 0, 0, 0, 0 };
+
+        float time = 0.0f;
+
+        projection.loadPerspective(45.0f,
+                                   (float)viewport_matrix[2] / (float)viewport_matrix[3],
+                                   1.0f,
+                                   200.0f);
+
+        modelview.loadLookAt(eye,
+                             eye + vec3(0.0f, 1.0f, 0.0f),
+                             vec3(0.0f, 0.0f, 1.0f));
+
+        build_frustum(frustum, modelview.back(), projection.back());
+
+        crowd[0]->set_joint_importance((char *)"sword", 64);
+        crowd[0]->set_joint_importance((char *)"sheath", 64);
+        crowd[0]->set_joint_importance((char *)"lamp", 64);
+
+        md5animator.add_lod(150.0f, 40.0f, 1, false, 0);
+        md5animator.add_lod(50.0f, 100.0f, 2, true, 0);
+        md5animator.add_lod(0.0f, FLT_MAX, 4, false, 128);
+
+        md5animator.set_camera(eye, 45.0f, viewport_matrix[3]);
+
+        for (unsigned int i=0; i!=BENCHMARK_CROWD; ++i) {
+            MD5 *member = crowd[i];
+
+            member->location = vec3(((i % 16) - 7.5f) * 8.0f,
+                                    15.0f + (i / 16) * 15.0f,
+                                    0.0f);
+
+            member->distance = sphere_distance_in_frustum(frustum,
+                                                          &member->location,
+                                                          member->radius);
+
+            md5animator.add(member);
+        }
+
+        md5animator.update(1.0f / 60.0f);
+
+        for (int i=0; i!=BENCHMARK_FRAME; ++i) {
+            md5animator.update(1.0f / 60.0f);
+
+            n[0] += md5animator.n_sampled;
+            n[1] += md5animator.n_sample_skipped;
+            n[2] += md5animator.n_skinned;
+            n[3] += md5animator.n_skin_skipped;
+            n[4] += md5animator.n_interpolated;
+            n[5] += md5animator.n_joint_skipped;
+
+            time += md5animator.time_frame;
+        }
+
+        md5animator.finish();
+
+        console_print("  LOD, %u threads: frame %6.2f ms, bands",
+                      md5animator.n_thread,
+                      time / BENCHMARK_FRAME);
+
+        for (unsigned int i=0; i!=md5animator.n_lod.size(); ++i)
+            console_print(" %u", md5animator.n_lod[i]);
+
+        console_print("\n    sampled %5.1f (%5.1f skipped), skinned %5.1f (%5.1f skipped), %5.1f interpolated, %6.1f joints skipped\n",
+                      (float)n[0] / BENCHMARK_FRAME,
+                      (float)n[1] / BENCHMARK_FRAME,
+                      (float)n[2] / BENCHMARK_FRAME,
+                      (float)n[3] / BENCHMARK_FRAME,
+                      (float)n[4] / BENCHMARK_FRAME,
+                      (float)n[5] / BENCHMARK_FRAME);
+
+        crowd[0]->set_joint_importance((char *)"sword", 255);
+        crowd[0]->set_joint_importance((char *)"sheath", 255);
+        crowd[0]->set_joint_importance((char *)"lamp", 255);
+    }
+
+    for (unsigned int i=0; i!=BENCHMARK_CROWD; ++i) delete crowd[i];
+}
+
+
+void run_benchmark(void)
+{
+    benchmark_inverse();
+
+    benchmark_glml();
+
+    benchmark_skin();
+
+    benchmark_bound();
+
+    benchmark_bvh();
+
+    benchmark_crowd();
+}
+
+
 void templateAppInit(int width, int height)
 {
     atexit(templateAppExit);
@@ -229,6 +912,12 @@ void templateAppInit(int width, int height)
         objmaterial->set_draw_callback(material_draw);
     }
 
+    /* Keep the binary form of the MD5 files in the writable directory
+     * the platform code exported as CACHE, so that the next runs load
+     * them instead of parsing the text files again.
+     */
+    RESOURCE::set_cache_path(getenv("CACHE"));
+
     /* Load the MD5 mesh file from disk. */
     md5 = new MD5(MD5_MESH, true);
 
@@ -346,6 +1035,12 @@ void templateAppDraw(void)
     gfx->rotate(quaternion( cosAlpha*cosBeta, sinAlpha*cosBeta,
                            -sinAlpha*sinBeta, cosAlpha*sinBeta));
 
+    if (benchmark) {
+        run_benchmark();
+
+        benchmark = false;
+    }
+
     /* Increase the time step of the animation.  Note that the
      * MD5_drawn_action function will return 1 (in this case, when the
      * current frame number changes) if a new skeleton pose has been
@@ -370,6 +1065,8 @@ void templateAppToucheBegan(float x, float y, unsigned int tap_count)
 {
     if (tap_count == 2) auto_rotate = !auto_rotate;
 
+    if (tap_count == 3) benchmark = true;
+
     touche->x = x;
     touche->y = y;
 }
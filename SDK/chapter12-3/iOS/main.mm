@@ -32,6 +32,9 @@ int main( int argc, char *argv[] ) {
 	setenv( "FILESYSTEM", argv[ 0 ], 1 );
 
     NSAutoreleasePool * pool = [[NSAutoreleasePool alloc] init];
+
+	setenv( "CACHE", [ [ NSSearchPathForDirectoriesInDomains( NSCachesDirectory, NSUserDomainMask, YES ) objectAtIndex: 0 ] UTF8String ], 1 );
+
     int retVal = UIApplicationMain(argc, argv, nil, nil);
     [pool release];
     return retVal;
@@ -103,6 +103,9 @@ void program_bind_attrib_location(void *ptr) {
     glBindAttribLocation(program->pid, VA_Normal,    VA_Normal_String);
     glBindAttribLocation(program->pid, VA_TexCoord0, VA_TexCoord0_String);
     glBindAttribLocation(program->pid, VA_Tangent0,  VA_Tangent0_String);
+    glBindAttribLocation(program->pid, VA_Joint,     VA_Joint_String);
+    glBindAttribLocation(program->pid, VA_Weight,    VA_Weight_String);
+    glBindAttribLocation(program->pid, VA_Morph,     VA_Morph_String);
 }
 
 
@@ -236,16 +239,24 @@ void templateAppInit(int width, int height)
         objmaterial->set_draw_callback(material_draw);
     }
 
+    /* Keep the binary form of the MD5 files in the writable directory
+     * the platform code exported as CACHE, so that the next runs load
+     * them instead of parsing the text files again.
+     */
+    RESOURCE::set_cache_path(getenv("CACHE"));
+
     /* Load the MD5 mesh file from disk. */
     md5 = new MD5(MD5_MESH, true);
 
     /* Convert the triangles to triangle strips. */
     md5->optimize(128);
 
-    /* Build the VBO and VAO and construct the normals and tangents for
-     * each face of the meshes.
+    /* Construct the normals and tangents for each face of the meshes,
+     * and bake the bind pose into static VBOs skinned on the GPU: every
+     * set_pose() only computes the joint palette that lighting.gfx
+     * reads, instead of skinning and sending the vertices again.
      */
-    md5->build();
+    md5->build_skin();
 
     /* Loop while there are some mesh parts. */
     for (auto md5mesh=md5->md5mesh.begin();
@@ -44,6 +44,11 @@ as being the original software.
 PROGRAM *program = NULL;
 OBJ *obj = NULL;
 GFX *gfx = NULL;
+/* The mesh transforms, one entry per mesh of the OBJ, and the entry of the
+ * mesh currently being drawn.
+ */
+TRANSFORMSTORE *transformstore = NULL;
+unsigned int current_transform = 0;
 TEMPLATEAPP templateApp = {
     templateAppInit,
     templateAppDraw
@@ -80,7 +85,7 @@ void material_draw_callback(void *ptr)
             glUniformMatrix4fv(uniform.location,
                                1,
                                GL_FALSE,
-                               gfx->get_modelview_projection_matrix().m());
+                               transformstore->modelview_projection_matrix[current_transform].m());
         }
     }
 }
@@ -125,6 +130,12 @@ void templateAppInit(int width, int height)
                           0.0f);
     }
 
+    /* Copy the mesh locations, rotations and scales into the transform
+     * store; mesh i of the OBJ is entry i.
+     */
+    transformstore = new TRANSFORMSTORE;
+    transformstore->add(obj);
+
     /* Load the global vertex shader that you are going to use for all
      * the material shader programs.
      */
@@ -227,6 +238,12 @@ void templateAppDraw(void)
     
      gfx->look_at(e, c, u);
 
+    /* Build the matrices of every mesh in one pass. Nothing moves in this
+     * scene, so after the first frame this is only a comparison of the
+     * camera matrices.
+     */
+    transformstore->update(gfx);
+
     /* Solid Objects */
     for (auto objmesh=obj->objmesh.begin();
          objmesh!=obj->objmesh.end(); ++objmesh) {
@@ -241,10 +258,8 @@ void templateAppDraw(void)
         OBJMATERIAL *objmaterial = objmesh->objtrianglelist[0].objmaterial;
         /* Is it a solid object? */
         if (objmaterial->dissolve == 1.0f) {
-            gfx->push_matrix();
-            gfx->translate(objmesh->location);
+            current_transform = objmesh - obj->objmesh.begin();
             objmesh->draw();
-            gfx->pop_matrix();
         }
     }
 
@@ -265,13 +280,11 @@ void templateAppDraw(void)
          * be transparent, so draw it onscreen.
          */
         if (objmaterial->dissolve != 1.0f) {
-            gfx->push_matrix();
-            gfx->translate(objmesh->location);
+            current_transform = objmesh - obj->objmesh.begin();
             glCullFace(GL_FRONT);
             objmesh->draw();
             glCullFace(GL_BACK);
             objmesh->draw();
-            gfx->pop_matrix();
         }
     }
 
@@ -284,5 +297,6 @@ void templateAppDraw(void)
 
 void templateAppExit(void)
 {
+    delete transformstore;
     delete obj;
 }
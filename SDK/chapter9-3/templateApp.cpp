@@ -88,8 +88,10 @@ int viewport_matrix[4];
 vec2 touche;
 /* Flag to determine if the player tries to pick something onscreen. */
 unsigned char pick = 0;
-/* Temporary variable to store the color used for picking. */
+/* Temporary variable to store the color of the piano keys and text. */
 vec4 color;
+/* Ray-cast picking against the mesh triangles. */
+PICKER *picker = NULL;
 /* Index of the sound associated with the object that has been picked. */
 unsigned int sound_index = 0;
 
@@ -176,14 +178,23 @@ void templateAppInit(int width, int height) {
 
     obj = new OBJ(OBJ_FILE, true);
 
+    picker = new PICKER;
+
     for (auto objmesh=obj->objmesh.begin();
          objmesh!=obj->objmesh.end(); ++objmesh) {
         objmesh->optimize(128);
 
         objmesh->build();
         
+        /* The picker copies the triangles, so add the mesh before its
+         * vertex data is freed.
+         */
+        picker->add(&(*objmesh));
+
         objmesh->free_vertex_data();
     }
+
+    picker->build();
     
     /* Declare an empty memory pointer to store the sound buffers. */
     MEMORY *memory = NULL;
@@ -374,86 +385,20 @@ void templateAppDraw(void) {
         cur_player_sound = 0;
     } else if (pick) {  // If you receive a signal that the user wants to
                         // pick something.
-        /* Change the DIFFUSE texture channel to be a channel that you do
-         * not use, so the texture color will be black.  With the
-         * modifications you've made to the fragment shader, you will be
-         * able to simple affect the fragment color with a uniform color
-         * passed to the shader, and because black + color = color, your
-         * object will be drawn using this unique color.
-         */
-        glUniform1i(program->get_uniform_location(TM_Diffuse_String), TM_Unused);
-        /* Loop for the maximum amount of piano key avoiding to draw the
-         * curtain (which is the last object recorded in the OBJ file).
+        /* Cast a ray from the camera through the touch location and find
+         * the closest piano key it hits.  This is done on the CPU against
+         * the triangles of the keys, so unlike reading back the color
+         * buffer it doesn't stall the GPU.
          */
-        for (int i=0; i!=obj->objmesh.size(); ++i) {
-            /* Get the current OBJMESH structure pointer, and adjust the
-             * current modelview matrix to render the object onscreen.
-             */
-            OBJMESH *objmesh = &obj->objmesh[i];
-            gfx->push_matrix();
-            gfx->translate(objmesh->location);
-            glUniformMatrix4fv(program->get_uniform_location((char *)"MODELVIEWPROJECTIONMATRIX"),
-                               1,
-                               GL_FALSE,
-                               gfx->get_modelview_projection_matrix().m());
-            /* Use the following helper function to generate a unique RGBA
-             * value for the current loop index.
-             */
-            generate_color_from_index(i, &color);
-            /* Send the color to the fragment shader. */
-            glUniform4fv(program->get_uniform_location((char *)"COLOR"),
-                         1,
-                         color.v());
-            /* Draw the object using the unique color that you have generated
-             * above.
-             */
-            objmesh->draw();
-            gfx->pop_matrix();
-        }
+        PICKHIT pickhit;
 
-        /* Now that you've fully rendered the current scene so that each object
-         * has its own unique color, it's time to ask GLES to identify the
-         * color under the user touch onscreen.  The RGBA result that you
-         * will be requesting will be returned in an unsigned byte form.
-         * You can then easily extract the numbers in their pure form and
-         * associate them with a piano key number.
-         */
-        ucol4 ucolor;
-        /* Be careful with this function, because it requires OpenGLES to
-         * fully process all the commands sent down the pipeline and will
-         * cause the server (in other words, the driver) to stall until the
-         * final color is calculated for the pixels you will be requesting.
-         */
-        glReadPixels(touche->x, // X coordinate of the touch.
-                     viewport_matrix[3]-touche->y,  // Y coordinate transformed to
-                                                    // OpenGLES coordinates.
-                     1, 1,      // width x height of request pixel rectangle.
-                     GL_RGBA,   // The requested pixel format.
-                     GL_UNSIGNED_BYTE,  // The requested pixel type.
-                     &ucolor);  // Result.
-
-        /* By default, you have 13 objects that have been rendered onscreen
-         * (each piano key).  And because the colors generated have been
-         * incremented depending on the current index of the loop counter,
-         * the result (if a piano key is picked) shown never exceeds the
-         * maximum number of the key index (0 to 12).  This means that the
-         * value of the blue (b) component contains the corresponding index
-         * of the piano key.
-         */
-//        if (1<=ucolor.b && ucolor.b<=MAX_PIANO_KEY) {
-//            /* Convert the name of the OBJMESH indexed by the b color
-//             * component to an unsigned int value, which will correspond to
-//             * the index of the piano key sound source in the array.
-//             */
-//            sscanf(obj->objmesh[ucolor.b].name, "%d", &sound_index);
-//
-//            /* Set the volume for the key at the top. */
-//            SOUND_set_volume(soundsource[sound_index], 1.0f);
-//            /* Play the piano key sound. */
-//            SOUND_play(soundsource[sound_index], 0);
-//        }
-        if (1<=ucolor.b && ucolor.b<=MAX_PIANO_KEY) {
-            sscanf(obj->objmesh[ucolor.b].name, "%d", &sound_index);
+        unsigned int index = 0;
+
+        if (picker->pick(gfx, touche->x, touche->y, viewport_matrix, &pickhit))
+            index = pickhit.objmesh - &obj->objmesh[0];
+
+        if (1<=index && index<=MAX_PIANO_KEY) {
+            sscanf(obj->objmesh[index].name, "%d", &sound_index);
 
             if (level[cur_player_sound] != sound_index) {
                 wrong->set_volume(1.0f);
@@ -469,11 +414,6 @@ void templateAppDraw(void) {
                 ++cur_player_sound;
             }
         }
-
-        /* Clear the depth buffer and color buffer, because you are about
-         * to draw the scene again.
-         */
-        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     }
 
     pick = 0;
@@ -607,6 +547,8 @@ void templateAppToucheBegan(float x, float y, unsigned int tap_count)
 
 
 void templateAppExit(void) {
+    delete picker;
+
     delete font_small;
 
     delete font_big;
@@ -69,6 +69,17 @@ THREAD *thread = NULL;
 
 vec4 frustum[6];
 
+FRUSTUMPLANES frustumplanes;
+
+CULLVOLUMES cullvolumes;
+
+std::vector<unsigned int> visibility;
+
+std::vector<float> visible_distance;
+
+// The maze walls hide most of the level from the camera.
+OCCLUSION *occlusion = NULL;
+
 int viewport_matrix[4];
 
 FONT    *font_small = NULL,
@@ -369,12 +380,16 @@ void load_level(void)
 {
     obj = new OBJ(OBJ_FILE, true);
 
+    occlusion = new OCCLUSION;
+
     for (auto objmesh=obj->objmesh.begin();
          objmesh!=obj->objmesh.end(); ++objmesh) {
         objmesh->optimize(128);
 
         objmesh->build();
 
+        if (strstr(objmesh->name, "maze")) occlusion->add(&(*objmesh));
+
         objmesh->free_vertex_data();
     }
 
@@ -627,6 +642,9 @@ void free_level(void)
 
     free_physic_world();
     
+    delete occlusion;
+    occlusion = NULL;
+
     delete obj;
     obj = NULL;
 }
@@ -659,6 +677,9 @@ void templateAppDraw(void) {
         load_level();
     }
 
+    /* Count the matrix requests of this frame only. */
+    gfx->reset_stats();
+
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
@@ -768,18 +789,39 @@ void templateAppDraw(void) {
                  up);
 
     build_frustum(frustum,
+                  &frustumplanes,
                   gfx->get_modelview_matrix(),
                   gfx->get_projection_matrix());
     
     
+    // Cull all the meshes at once, then walk the results.
+    cullvolumes.resize(obj->objmesh.size());
+
+    visibility.resize(cull_get_mask_size(obj->objmesh.size()));
+
+    visible_distance.resize(obj->objmesh.size());
+
+    for (int i=0; i!=obj->objmesh.size(); ++i) {
+        cullvolumes.set_sphere(i,
+                               obj->objmesh[i].location,
+                               obj->objmesh[i].radius);
+    }
+
+    sphere_distance_in_frustum_batch(&frustumplanes,
+                                     &cullvolumes,
+                                     &visibility[0],
+                                     &visible_distance[0]);
+
+    occlusion->update(gfx->get_modelview_matrix(),
+                      gfx->get_projection_matrix());
+
     for (auto objmesh=obj->objmesh.begin();
          objmesh!=obj->objmesh.end(); ++objmesh) {
 
-        objmesh->distance = sphere_distance_in_frustum(frustum,
-                                                       &objmesh->location,
-                                                       objmesh->radius);
+        objmesh->distance = visible_distance[objmesh - obj->objmesh.begin()];
 
-        if (objmesh->distance && objmesh->visible) {
+        if (objmesh->distance && objmesh->visible &&
+            occlusion->is_visible(&(*objmesh))) {
             gfx->push_matrix();
 
             if (strstr(objmesh->name, "gem")) {
@@ -807,6 +849,16 @@ void templateAppDraw(void) {
     }
     
     dynamicsworld->stepSimulation(1.0f / 60.0f);
+
+    /* The model view projection and normal matrices the scene asked for,
+     * and how many of them GFX had to rebuild; the others came from its
+     * cache.  Read before the text below adds its own.
+     */
+    char    matrix_str[MAX_CHAR] = {""};
+
+    sprintf(matrix_str, "Matrices:%u/%u",
+            gfx->n_modelview_projection_update + gfx->n_normal_update,
+            gfx->n_modelview_projection_request + gfx->n_normal_request);
     
     
     gfx->set_matrix_mode(PROJECTION_MATRIX);
@@ -834,7 +886,8 @@ void templateAppDraw(void) {
     
     char    gem_str  [MAX_CHAR] = {""},
             time_str [MAX_CHAR] = {""},
-            level_str[MAX_CHAR] = {""};
+            level_str[MAX_CHAR] = {""},
+            occlusion_str[MAX_CHAR] = {""};
 
     if (game_state) {
         sprintf(level_str, "Level Clear!");
@@ -864,6 +917,12 @@ void templateAppDraw(void) {
     sprintf(gem_str, "Gem Points:%02d", gem_points);
     sprintf(time_str, "Game Time:%02.2f", game_time * 0.1f);
 
+    /* Meshes in the frustum this frame, and how many of them the maze
+     * hid.
+     */
+    sprintf(occlusion_str, "Occluded:%u/%u",
+            occlusion->n_culled, occlusion->n_tested);
+
     font_small->print(gfx,
                       viewport_matrix[3] - font_small->length(gem_str) - 6.0f,
                       (font_small->font_size * 0.5f),
@@ -876,6 +935,18 @@ void templateAppDraw(void) {
                       time_str,
                       &font_color);
 
+    font_small->print(gfx,
+                      8.0f,
+                      viewport_matrix[2] - font_small->font_size * 1.5f,
+                      occlusion_str,
+                      &font_color);
+
+    font_small->print(gfx,
+                      8.0f,
+                      viewport_matrix[2] - font_small->font_size * 2.5f,
+                      matrix_str,
+                      &font_color);
+
     font_color->x = 1.0f;
     font_color->y = 1.0f;
     font_color->z = 0.0f;
@@ -892,6 +963,18 @@ void templateAppDraw(void) {
                       time_str,
                       &font_color);
 
+    font_small->print(gfx,
+                      6.0f,
+                      viewport_matrix[2] - font_small->font_size * 1.5f,
+                      occlusion_str,
+                      &font_color);
+
+    font_small->print(gfx,
+                      6.0f,
+                      viewport_matrix[2] - font_small->font_size * 2.5f,
+                      matrix_str,
+                      &font_color);
+
     if (!game_state) game_time += background_sound->get_time();
 }
 
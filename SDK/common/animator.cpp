@@ -0,0 +1,501 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+MD5ANIMATOR::MD5ANIMATOR(unsigned int max_thread) :
+    n_thread(0), time_sample(0.0f), time_blend(0.0f), time_skin(0.0f),
+    time_frame(0.0f), time_wait(0.0f), time_upload(0.0f), n_frame(0),
+    n_sampled(0), n_sample_skipped(0), n_skinned(0), n_skin_skipped(0),
+    n_interpolated(0), n_joint_skipped(0), eye(0,0,0), pixel_scale(0.0f),
+    time_step(0.0f), next(0), n_done(0), n_entry(0), time_start(0),
+    time_end(0), pending(false), quit(false)
+{
+    pthread_mutex_init(&this->mutex, NULL);
+
+    pthread_cond_init(&this->start_cond, NULL);
+
+    pthread_cond_init(&this->done_cond, NULL);
+
+    memset(this->n_job, 0, sizeof(this->n_job));
+
+    memset(this->worker, 0, sizeof(this->worker));
+
+    max_thread = std::min(max_thread, (unsigned int)MD5_ANIMATOR_MAX_THREAD);
+
+    // Only count the workers that actually started; with none the jobs
+    // run on the GL thread.
+    for (unsigned int i=0; i!=max_thread; ++i) {
+        MD5ANIMATORWORKER *md5animatorworker = &this->worker[this->n_thread];
+
+        md5animatorworker->md5animator = this;
+
+        md5animatorworker->started = !pthread_create(&md5animatorworker->thread,
+                                                      NULL,
+                                                      MD5ANIMATOR::run,
+                                                      (void *)md5animatorworker);
+
+        if (md5animatorworker->started) ++this->n_thread;
+    }
+}
+
+
+MD5ANIMATOR::~MD5ANIMATOR()
+{
+    this->finish();
+
+    pthread_mutex_lock(&this->mutex);
+
+    this->quit = true;
+
+    pthread_cond_broadcast(&this->start_cond);
+
+    pthread_mutex_unlock(&this->mutex);
+
+    for (unsigned int i=0; i!=this->n_thread; ++i)
+        pthread_join(this->worker[i].thread, NULL);
+
+    pthread_cond_destroy(&this->done_cond);
+
+    pthread_cond_destroy(&this->start_cond);
+
+    pthread_mutex_destroy(&this->mutex);
+}
+
+
+int MD5ANIMATOR::add(MD5 *md5, MD5BLENDTREE *md5blendtree)
+{
+    assert(md5blendtree == NULL || md5blendtree->md5 == md5);
+
+    this->finish();
+
+    MD5ANIMATORENTRY md5animatorentry;
+
+    md5animatorentry.md5          = md5;
+    md5animatorentry.md5blendtree = md5blendtree;
+    md5animatorentry.pose         = md5->bind_pose;
+    md5animatorentry.time         = 0.0f;
+    md5animatorentry.n_frame      = 0;
+    md5animatorentry.lod          = -1;
+    md5animatorentry.on_screen    = true;
+    md5animatorentry.dirty        = false;
+    md5animatorentry.sampled      = false;
+    md5animatorentry.skinned      = false;
+    md5animatorentry.ready        = false;
+
+    this->entry.push_back(md5animatorentry);
+
+    return this->entry.size() - 1;
+}
+
+
+void MD5ANIMATOR::remove(MD5 *md5)
+{
+    this->finish();
+
+    for (auto md5animatorentry = this->entry.begin();
+         md5animatorentry != this->entry.end(); ++md5animatorentry) {
+
+        if (md5animatorentry->md5 == md5) {
+            this->entry.erase(md5animatorentry);
+
+            return;
+        }
+    }
+}
+
+
+// Bands are tried in the order they were added: add the most detailed
+// first.  An MD5 fitting none gets the last one.
+int MD5ANIMATOR::add_lod(float size,
+                         float distance,
+                         unsigned int interval,
+                         bool interpolate,
+                         unsigned char joint_lod)
+{
+    this->finish();
+
+    MD5ANIMATORLOD md5animatorlod;
+
+    md5animatorlod.size        = size;
+    md5animatorlod.distance    = distance;
+    md5animatorlod.interval    = interval ? interval : 1;
+    md5animatorlod.interpolate = interpolate;
+    md5animatorlod.joint_lod   = joint_lod;
+
+    this->lod.push_back(md5animatorlod);
+
+    return this->lod.size() - 1;
+}
+
+
+// The eye, the vertical field of view in degrees and the height of the
+// viewport in pixels the LOD bands are measured with.
+void MD5ANIMATOR::set_camera(const vec3 &eye, float fovy, float viewport_height)
+{
+    this->eye = eye;
+
+    this->pixel_scale = viewport_height / tanf(fovy * DEG_TO_RAD_DIV_2);
+}
+
+
+// The band of an MD5 from its bounding sphere, -1 without bands or camera.
+int MD5ANIMATOR::get_lod(const MD5 *md5) const
+{
+    if (this->lod.empty() || !this->pixel_scale) return -1;
+
+    float distance = (md5->location - this->eye).length(),
+          radius   = md5->radius * std::max(md5->scale->x,
+                                            std::max(md5->scale->y, md5->scale->z)),
+          size     = distance > radius ? radius * this->pixel_scale / distance : FLT_MAX;
+
+    for (unsigned int i=0; i!=this->lod.size(); ++i) {
+        if (size >= this->lod[i].size && distance <= this->lod[i].distance)
+            return i;
+    }
+
+    return this->lod.size() - 1;
+}
+
+
+// Run once per frame on the GL thread, before drawing the MD5s.  Their
+// VBOs and palettes end up holding the frame started by the previous
+// call, while the workers compute the next one.
+void MD5ANIMATOR::update(float time_step)
+{
+    unsigned int time = get_micro_time();
+
+    this->finish();
+
+    this->time_wait = (get_micro_time() - time) / 1000.0f;
+
+    time = get_micro_time();
+
+    // The bounds and palettes are built from the poses before the workers
+    // overwrite them.
+    for (auto md5animatorentry = this->entry.begin();
+         md5animatorentry != this->entry.end(); ++md5animatorentry) {
+
+        // Off screen MD5s are only sampled, but the culling that keeps
+        // them from being skinned tests these bounds.
+        if (!md5animatorentry->ready) {
+            if (md5animatorentry->sampled)
+                md5animatorentry->md5->update_bound_pose(md5animatorentry->sample[1]);
+
+            md5animatorentry->sampled = false;
+
+            continue;
+        }
+
+        md5animatorentry->sampled = false;
+
+        md5animatorentry->md5->update_bound_pose(md5animatorentry->pose);
+
+        if (md5animatorentry->md5->gpu_skin) {
+            md5animatorentry->md5->compute_pose(md5animatorentry->pose);
+
+            md5animatorentry->md5->upload_pose();
+
+            md5animatorentry->ready = false;
+        }
+    }
+
+    unsigned int time_upload = get_micro_time() - time;
+
+    if (!this->entry.empty()) {
+        this->time_step = time_step;
+
+        for (unsigned int i=0; i!=MD5_ANIMATOR_MAX_THREAD; ++i) {
+            this->worker[i].time_sample =
+            this->worker[i].time_blend  =
+            this->worker[i].time_skin   =
+            this->worker[i].n_job           =
+            this->worker[i].n_sampled       =
+            this->worker[i].n_skinned       =
+            this->worker[i].n_interpolated  =
+            this->worker[i].n_joint_skipped = 0;
+        }
+
+        // Read from the MD5s here rather than by the workers, as the
+        // application is free to move them while the frame runs.
+        for (auto md5animatorentry = this->entry.begin();
+             md5animatorentry != this->entry.end(); ++md5animatorentry) {
+
+            MD5 *md5 = md5animatorentry->md5;
+
+            md5animatorentry->lod       = this->get_lod(md5);
+            md5animatorentry->on_screen = md5->visible && md5->distance;
+        }
+
+        this->time_start = get_micro_time();
+
+        this->pending = true;
+
+        // The workers test next against n_entry: both change under the
+        // mutex.
+        if (this->n_thread) {
+            pthread_mutex_lock(&this->mutex);
+
+            this->n_entry = this->entry.size();
+            this->next    = 0;
+            this->n_done  = 0;
+
+            pthread_cond_broadcast(&this->start_cond);
+
+            pthread_mutex_unlock(&this->mutex);
+        } else {
+            this->n_entry = this->entry.size();
+
+            for (unsigned int i=0; i!=this->n_entry; ++i)
+                this->run_job(&this->worker[0], i);
+
+            this->next     =
+            this->n_done   = this->n_entry;
+            this->time_end = get_micro_time();
+        }
+    }
+
+    // Then the vertices, while the workers skin into the other buffers.
+    time = get_micro_time();
+
+    for (auto md5animatorentry = this->entry.begin();
+         md5animatorentry != this->entry.end(); ++md5animatorentry) {
+
+        if (md5animatorentry->ready) {
+            md5animatorentry->md5->upload_pose(true);
+
+            md5animatorentry->ready = false;
+        }
+    }
+
+    this->time_upload = (time_upload + get_micro_time() - time) / 1000.0f;
+}
+
+
+// Wait for the frame in progress, if any, and flip the vertex buffers of
+// the MD5s it skinned so the workers are free to start another one.
+void MD5ANIMATOR::finish()
+{
+    if (!this->pending) return;
+
+    pthread_mutex_lock(&this->mutex);
+
+    while (this->n_done != this->n_entry)
+        pthread_cond_wait(&this->done_cond, &this->mutex);
+
+    pthread_mutex_unlock(&this->mutex);
+
+    this->pending = false;
+
+    this->n_lod.assign(this->lod.size(), 0);
+
+    for (unsigned int i=0; i!=this->n_entry; ++i) {
+        MD5ANIMATORENTRY *md5animatorentry = &this->entry[i];
+
+        if (md5animatorentry->lod != -1) ++this->n_lod[md5animatorentry->lod];
+
+        if (!md5animatorentry->skinned) continue;
+
+        if (!md5animatorentry->md5->gpu_skin)
+            md5animatorentry->md5->swap_vertex_data();
+
+        md5animatorentry->ready = true;
+    }
+
+    unsigned int time_sample = 0,
+                 time_blend  = 0,
+                 time_skin   = 0;
+
+    this->n_sampled       =
+    this->n_skinned       =
+    this->n_interpolated  =
+    this->n_joint_skipped = 0;
+
+    for (unsigned int i=0; i!=MD5_ANIMATOR_MAX_THREAD; ++i) {
+        time_sample += this->worker[i].time_sample;
+        time_blend  += this->worker[i].time_blend;
+        time_skin   += this->worker[i].time_skin;
+
+        this->n_job[i] = this->worker[i].n_job;
+
+        this->n_sampled       += this->worker[i].n_sampled;
+        this->n_skinned       += this->worker[i].n_skinned;
+        this->n_interpolated  += this->worker[i].n_interpolated;
+        this->n_joint_skipped += this->worker[i].n_joint_skipped;
+    }
+
+    this->n_sample_skipped = this->n_entry - this->n_sampled;
+    this->n_skin_skipped   = this->n_entry - this->n_skinned;
+
+    this->time_sample = time_sample / 1000.0f;
+    this->time_blend  = time_blend  / 1000.0f;
+    this->time_skin   = time_skin   / 1000.0f;
+    this->time_frame  = (this->time_end - this->time_start) / 1000.0f;
+
+    ++this->n_frame;
+}
+
+
+// Worker loop: take the next entry of the frame until there is none left,
+// then sleep until the next frame.
+void *MD5ANIMATOR::run(void *ptr)
+{
+    MD5ANIMATORWORKER *md5animatorworker = (MD5ANIMATORWORKER *)ptr;
+
+    MD5ANIMATOR *md5animator = md5animatorworker->md5animator;
+
+    pthread_mutex_lock(&md5animator->mutex);
+
+    while (true) {
+        while (!md5animator->quit && md5animator->next >= md5animator->n_entry)
+            pthread_cond_wait(&md5animator->start_cond, &md5animator->mutex);
+
+        if (md5animator->quit) break;
+
+        unsigned int index = md5animator->next++;
+
+        pthread_mutex_unlock(&md5animator->mutex);
+
+        md5animator->run_job(md5animatorworker, index);
+
+        pthread_mutex_lock(&md5animator->mutex);
+
+        if (++md5animator->n_done == md5animator->n_entry) {
+            md5animator->time_end = get_micro_time();
+
+            pthread_cond_signal(&md5animator->done_cond);
+        }
+    }
+
+    pthread_mutex_unlock(&md5animator->mutex);
+
+    return NULL;
+}
+
+
+void MD5ANIMATOR::run_job(MD5ANIMATORWORKER *md5animatorworker, unsigned int index)
+{
+    MD5ANIMATORENTRY *md5animatorentry = &this->entry[index];
+
+    MD5 *md5 = md5animatorentry->md5;
+
+    MD5BLENDTREE *md5blendtree = md5animatorentry->md5blendtree;
+
+    const MD5ANIMATORLOD *md5animatorlod = md5animatorentry->lod == -1 ?
+                                           NULL : &this->lod[md5animatorentry->lod];
+
+    unsigned int interval = md5animatorlod ? md5animatorlod->interval : 1,
+                 time = get_micro_time(),
+                 time_sample,
+                 time_blend;
+
+    md5animatorentry->time += this->time_step;
+
+    ++md5animatorentry->n_frame;
+
+    bool sample = md5animatorentry->n_frame >= interval ||
+                  md5animatorentry->sample[1].empty();
+
+    md5animatorentry->sampled = sample;
+
+    if (sample) {
+        if (md5animatorlod) md5->joint_lod = md5animatorlod->joint_lod;
+
+        md5->draw_action(md5animatorentry->time);
+
+        if (md5blendtree) md5blendtree->update(md5animatorentry->time);
+    }
+
+    time_sample = get_micro_time();
+
+    if (sample) {
+        std::vector<MD5JOINT> *pose = md5animatorentry->sample;
+
+        pose[0].swap(pose[1]);
+
+        if (md5blendtree)
+            pose[1] = md5blendtree->evaluate();
+        else {
+            pose[1] = md5->bind_pose;
+
+            for (auto md5action = md5->md5action.begin();
+                 md5action != md5->md5action.end(); ++md5action) {
+
+                if (md5action->state == PLAY) {
+                    pose[1] = md5action->pose;
+
+                    break;
+                }
+            }
+        }
+
+        if (pose[0].empty()) pose[0] = pose[1];
+
+        md5animatorentry->time    = 0.0f;
+        md5animatorentry->n_frame = 0;
+        md5animatorentry->dirty   = true;
+
+        ++md5animatorworker->n_sampled;
+
+        md5animatorworker->n_joint_skipped += md5->get_attached_joint_count();
+    }
+
+    // Held poses are skinned once, when they come on screen; interpolated
+    // ones trail the last sample by one interval.
+    bool interpolate = md5animatorlod && md5animatorlod->interpolate && interval > 1;
+
+    md5animatorentry->skinned = md5animatorentry->on_screen &&
+                                (md5animatorentry->dirty || interpolate);
+
+    if (md5animatorentry->skinned) {
+        if (interpolate) {
+            md5->blend_pose(md5animatorentry->pose,
+                            md5animatorentry->sample[0],
+                            md5animatorentry->sample[1],
+                            MD5_METHOD_LERP,
+                            (float)md5animatorentry->n_frame / (float)interval);
+
+            ++md5animatorworker->n_interpolated;
+        } else
+            md5animatorentry->pose = md5animatorentry->sample[1];
+    }
+
+    time_blend = get_micro_time();
+
+    // MD5s skinned on the GPU only need a palette, built on the GL thread
+    // where it is drawn from.
+    if (md5animatorentry->skinned) {
+        if (!md5->gpu_skin) md5->compute_pose(md5animatorentry->pose);
+
+        md5animatorentry->dirty = false;
+
+        ++md5animatorworker->n_skinned;
+    }
+
+    md5animatorworker->time_sample += time_sample - time;
+    md5animatorworker->time_blend  += time_blend - time_sample;
+    md5animatorworker->time_skin   += get_micro_time() - time_blend;
+
+    ++md5animatorworker->n_job;
+}
@@ -0,0 +1,251 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Frame pipeline for a crowd of animated MD5 characters.  Every MD5 added
+ * is one job per frame: advance its actions (sample), evaluate its blend
+ * tree if it has one (blend), then skin its vertices on the CPU (skin).
+ * The jobs of a frame are handed out to a pool of worker threads that
+ * live as long as the animator.
+ *
+ * The results are double buffered.  update() is called once per frame on
+ * the GL thread: it waits for the frame the workers were computing,
+ * swaps its vertex buffers, starts the next frame on the workers, then
+ * uploads the finished one while they run.  What gets drawn is therefore
+ * one frame behind the animation, and the GL thread only ever blocks on
+ * the workers when they are slower than the rest of the frame.
+ *
+ * Between two update() calls the workers own the actions, blend trees
+ * and vertex_data of the MD5s added: only draw them, and call finish()
+ * first to change them.  MD5s skinned on the GPU get their palette built
+ * on the GL thread from the pose the workers left, and every MD5 its
+ * bounds, see MD5::update_bound_pose().
+ *
+ * The timings of the last frame completed are kept per stage, summed over
+ * the workers, to see how the work scales with the number of threads.
+ *
+ * Level of detail: with LOD bands added and a camera set, each MD5 gets
+ * the first band its height on screen and distance to the eye fit in.
+ * A band samples the MD5 every interval frames only, with the time of
+ * the frames in between, and either holds its vertices in between or
+ * skins every frame a pose interpolated from the last two samples, which
+ * shows the animation one interval late.  A band can also skip the
+ * joints of low importance, see MD5::joint_lod.  MD5s off screen, not
+ * visible or with a distance of 0 as MD5::draw() tests it, keep being
+ * sampled at the rate of their band but are never skinned; their bounds
+ * follow the last sample, so that they can come back on screen.
+ * Counters of the work done and skipped are kept with the timings.
+ */
+
+#ifndef ANIMATOR_H
+#define ANIMATOR_H
+
+
+#define MD5_ANIMATOR_MAX_THREAD 8
+
+
+struct MD5ANIMATOR;
+
+
+struct MD5ANIMATORENTRY {
+    MD5				*md5;
+
+    // NULL to use the pose of the first action playing.
+    MD5BLENDTREE		*md5blendtree;
+
+    // Pose left by the last job of this entry.
+    std::vector<MD5JOINT>	pose;
+
+    // The two last poses sampled, the latest second.
+    std::vector<MD5JOINT>	sample[ 2 ];
+
+    // Time and frames since the last sample.
+    float			time;
+
+    unsigned int		n_frame;
+
+    // Chosen by update() for the frame in progress: the LOD band, -1
+    // without bands, and whether the MD5 can be seen.
+    int				lod;
+
+    bool			on_screen;
+
+    // Sampled since it was last skinned.
+    bool			dirty;
+
+    // Sampled by the last job, for the bounds of the MD5s not skinned.
+    bool			sampled;
+
+    // Skinned by the last job, to swap and upload.
+    bool			skinned;
+
+    // Computed by the workers, not handed to the GL yet.
+    bool			ready;
+};
+
+
+struct MD5ANIMATORWORKER {
+    MD5ANIMATOR			*md5animator;
+
+    pthread_t			thread;
+
+    bool			started;
+
+    // Microseconds spent in each stage by this worker, this frame.
+    unsigned int		time_sample;
+
+    unsigned int		time_blend;
+
+    unsigned int		time_skin;
+
+    unsigned int		n_job;
+
+    unsigned int		n_sampled;
+
+    unsigned int		n_skinned;
+
+    unsigned int		n_interpolated;
+
+    unsigned int		n_joint_skipped;
+};
+
+
+struct MD5ANIMATORLOD {
+    // The band applies from this height on screen, in pixels, and up to
+    // this distance from the eye.
+    float			size;
+
+    float			distance;
+
+    // Frames between two samples.
+    unsigned int		interval;
+
+    // Skin every frame from interpolated poses, instead of only when
+    // sampled.
+    bool			interpolate;
+
+    // MD5::joint_lod while in the band.
+    unsigned char		joint_lod;
+};
+
+
+struct MD5ANIMATOR {
+    std::vector<MD5ANIMATORENTRY> entry;
+
+    // Worker threads, 0 to run the jobs on the GL thread inside update().
+    unsigned int		n_thread;
+
+    // Milliseconds, for the last frame completed: each stage summed over
+    // the workers, and from the start of the frame to its last job.
+    float			time_sample;
+
+    float			time_blend;
+
+    float			time_skin;
+
+    float			time_frame;
+
+    // Milliseconds the last update() spent on the GL thread waiting for
+    // the workers, and building palettes and uploading vertices.
+    float			time_wait;
+
+    float			time_upload;
+
+    // Jobs run by each worker in the last frame completed.
+    unsigned int		n_job[ MD5_ANIMATOR_MAX_THREAD ];
+
+    unsigned int		n_frame;
+
+    std::vector<MD5ANIMATORLOD>	lod;
+
+    // Work of the last frame completed, in MD5s (joints for the last),
+    // and MD5s per LOD band.
+    unsigned int		n_sampled;
+
+    unsigned int		n_sample_skipped;
+
+    unsigned int		n_skinned;
+
+    unsigned int		n_skin_skipped;
+
+    unsigned int		n_interpolated;
+
+    unsigned int		n_joint_skipped;
+
+    std::vector<unsigned int>	n_lod;
+
+    // See set_camera().
+    vec3			eye;
+
+    float			pixel_scale;
+
+private:
+    MD5ANIMATORWORKER		worker[ MD5_ANIMATOR_MAX_THREAD ];
+
+    pthread_mutex_t		mutex;
+
+    // Signaled when a frame starts or the workers have to quit, and when
+    // the last job of a frame is done.
+    pthread_cond_t		start_cond;
+
+    pthread_cond_t		done_cond;
+
+    float			time_step;
+
+    // Next entry to hand out, entries done, and entries in this frame.
+    unsigned int		next;
+
+    unsigned int		n_done;
+
+    unsigned int		n_entry;
+
+    unsigned int		time_start;
+
+    unsigned int		time_end;
+
+    // A frame was started and not waited for yet.
+    bool			pending;
+
+    bool			quit;
+
+public:
+    MD5ANIMATOR(unsigned int max_thread);
+    ~MD5ANIMATOR();
+    int add(MD5 *md5, MD5BLENDTREE *md5blendtree=NULL);
+    void remove(MD5 *md5);
+    int add_lod(float size,
+                float distance,
+                unsigned int interval,
+                bool interpolate,
+                unsigned char joint_lod);
+    void set_camera(const vec3 &eye, float fovy, float viewport_height);
+    void update(float time_step);
+    void finish();
+    static void *run(void *ptr);
+private:
+    void run_job(MD5ANIMATORWORKER *md5animatorworker, unsigned int index);
+    int get_lod(const MD5 *md5) const;
+    MD5ANIMATOR(const MD5ANIMATOR &src);
+    MD5ANIMATOR &operator=(const MD5ANIMATOR &rhs);
+};
+
+#endif
@@ -0,0 +1,420 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+MD5BLENDTREE::MD5BLENDTREE(MD5 *md5) : md5(md5), root(-1),
+                                       n_node_evaluated(0),
+                                       n_joint_blended(0)
+{
+}
+
+
+// A leaf playing the action called name, -1 if the MD5 has none.
+int MD5BLENDTREE::add_action(char *name)
+{
+    MD5ACTION *md5action = this->md5->get_action(name, true);
+
+    if (!md5action) return -1;
+
+    MD5BLENDNODE md5blendnode(MD5_BLEND_ACTION);
+
+    md5blendnode.action = md5action - &this->md5->md5action[0];
+
+    this->node.push_back(md5blendnode);
+
+    return this->node.size() - 1;
+}
+
+
+int MD5BLENDTREE::add_mix()
+{
+    this->node.push_back(MD5BLENDNODE(MD5_BLEND_MIX));
+
+    return this->node.size() - 1;
+}
+
+
+// The first child added is the base pose, the weight it is given is not
+// used.  The next ones are layers.
+int MD5BLENDTREE::add_additive(int reference)
+{
+    MD5BLENDNODE md5blendnode(MD5_BLEND_ADDITIVE);
+
+    md5blendnode.reference = reference;
+
+    this->node.push_back(md5blendnode);
+
+    return this->node.size() - 1;
+}
+
+
+// Returns the slot of child within node, for set_weight() and fade().
+int MD5BLENDTREE::add_child(int node, int child, float weight, int mask)
+{
+    MD5BLENDNODE &md5blendnode = this->node[node];
+
+    assert(md5blendnode.type != MD5_BLEND_ACTION);
+
+    md5blendnode.child.push_back(child);
+
+    md5blendnode.weight.push_back(weight);
+
+    md5blendnode.mask.push_back(mask);
+
+    md5blendnode.target.push_back(weight);
+
+    md5blendnode.speed.push_back(0.0f);
+
+    return md5blendnode.child.size() - 1;
+}
+
+
+// A mask weighting joint, and with descendants the joints below it too,
+// by weight; every other joint gets 0.  Returns -1 if the skeleton has no
+// such joint.
+int MD5BLENDTREE::add_mask(char *joint, float weight, bool descendants)
+{
+    const std::vector<MD5JOINT> &bind_pose = this->md5->bind_pose;
+
+    std::vector<float> mask(bind_pose.size(), 0.0f);
+
+    int first = -1;
+
+    // The .md5mesh names keep their quotes, accept the name with or
+    // without them.
+    char quoted[MAX_CHAR] = {""};
+
+    snprintf(quoted, sizeof(quoted), "\"%s\"", joint);
+
+    for (unsigned int i=0; i!=bind_pose.size(); ++i) {
+        if (!strcmp(bind_pose[i].name, joint) ||
+            !strcmp(bind_pose[i].name, quoted)) {
+            first = i;
+
+            break;
+        }
+    }
+
+    if (first == -1) return -1;
+
+    mask[first] = weight;
+
+    // Parents always come before their children in an .md5mesh.
+    for (unsigned int i=first+1; descendants && i!=bind_pose.size(); ++i) {
+        int parent = bind_pose[i].parent;
+
+        if (parent >= first && mask[parent] > 0.0f) mask[i] = weight;
+    }
+
+    this->mask.push_back(mask);
+
+    return this->mask.size() - 1;
+}
+
+
+void MD5BLENDTREE::set_weight(int node, int slot, float weight)
+{
+    MD5BLENDNODE &md5blendnode = this->node[node];
+
+    md5blendnode.weight[slot] =
+    md5blendnode.target[slot] = weight;
+
+    md5blendnode.speed[slot] = 0.0f;
+}
+
+
+// Move the weight of slot to weight over duration seconds.
+void MD5BLENDTREE::fade(int node, int slot, float weight, float duration)
+{
+    MD5BLENDNODE &md5blendnode = this->node[node];
+
+    if (duration <= 0.0f) {
+        this->set_weight(node, slot, weight);
+
+        return;
+    }
+
+    md5blendnode.target[slot] = weight;
+
+    md5blendnode.speed[slot] = fabsf(weight - md5blendnode.weight[slot]) / duration;
+}
+
+
+// Fade slot in and every other child of node out, all over duration
+// seconds.
+void MD5BLENDTREE::crossfade(int node, int slot, float duration)
+{
+    for (unsigned int i=0; i!=this->node[node].child.size(); ++i)
+        this->fade(node, i, i == (unsigned int)slot ? 1.0f : 0.0f, duration);
+}
+
+
+void MD5BLENDTREE::update(float time_step)
+{
+    for (auto md5blendnode=this->node.begin();
+         md5blendnode!=this->node.end(); ++md5blendnode) {
+
+        for (unsigned int i=0; i!=md5blendnode->weight.size(); ++i) {
+            float &weight = md5blendnode->weight[i],
+                  target  = md5blendnode->target[i],
+                  step    = md5blendnode->speed[i] * time_step;
+
+            if (weight == target) continue;
+
+            if (fabsf(target - weight) <= step)
+                weight = target;
+            else
+                weight += target > weight ? step : -step;
+        }
+    }
+}
+
+
+const std::vector<MD5JOINT> &MD5BLENDTREE::evaluate()
+{
+    unsigned int n_joint = this->md5->bind_pose.size();
+
+    this->n_node_evaluated =
+    this->n_joint_blended  = 0;
+
+    this->pose.resize(n_joint);
+
+    // Sized once for the deepest possible graph, so that no buffer moves
+    // while a parent node still refers to it.
+    if (this->scratch.size() < this->node.size() * 2) {
+        this->scratch.resize(this->node.size() * 2);
+
+        this->total.resize(this->node.size());
+    }
+
+    if (this->root == -1) {
+        for (unsigned int i=0; i!=n_joint; ++i) {
+            this->pose[i].location = this->md5->bind_pose[i].location;
+            this->pose[i].rotation = this->md5->bind_pose[i].rotation;
+        }
+    } else
+        this->evaluate(this->root, this->pose, 0);
+
+    return this->pose;
+}
+
+
+std::vector<MD5JOINT> &MD5BLENDTREE::get_scratch(unsigned int depth,
+                                                 unsigned int i)
+{
+    std::vector<MD5JOINT> &buffer = this->scratch[depth * 2 + i];
+
+    buffer.resize(this->md5->bind_pose.size());
+
+    return buffer;
+}
+
+
+void MD5BLENDTREE::evaluate(int node, std::vector<MD5JOINT> &dst,
+                            unsigned int depth)
+{
+    const MD5BLENDNODE &md5blendnode = this->node[node];
+
+    // Deeper than there are nodes means the graph has a cycle.
+    assert(depth < this->node.size());
+
+    ++this->n_node_evaluated;
+
+    switch (md5blendnode.type) {
+        case MD5_BLEND_ACTION:
+        {
+            const std::vector<MD5JOINT> &pose =
+                this->md5->md5action[md5blendnode.action].pose;
+
+            for (unsigned int i=0; i!=dst.size(); ++i) {
+                dst[i].location = pose[i].location;
+                dst[i].rotation = pose[i].rotation;
+            }
+
+            break;
+        }
+
+        case MD5_BLEND_MIX:
+        {
+            this->evaluate_mix(md5blendnode, dst, depth);
+
+            break;
+        }
+
+        case MD5_BLEND_ADDITIVE:
+        {
+            this->evaluate_additive(md5blendnode, dst, depth);
+
+            break;
+        }
+    }
+}
+
+
+// Weighted average of the children, normalized per joint.  Joints no
+// child weighs in on keep the bind pose.
+void MD5BLENDTREE::evaluate_mix(const MD5BLENDNODE &md5blendnode,
+                                std::vector<MD5JOINT> &dst,
+                                unsigned int depth)
+{
+    const std::vector<MD5JOINT> &bind_pose = this->md5->bind_pose;
+
+    unsigned int n_joint = dst.size(),
+                 n_active = 0,
+                 active = 0;
+
+    for (unsigned int i=0; i!=md5blendnode.child.size(); ++i) {
+        if (md5blendnode.weight[i] > 0.0f) {
+            ++n_active;
+
+            active = i;
+        }
+    }
+
+    // A single child over every joint normalizes to itself.
+    if (n_active == 1 && md5blendnode.mask[active] == -1) {
+        this->evaluate(md5blendnode.child[active], dst, depth + 1);
+
+        return;
+    }
+
+    std::vector<float> &total = this->total[depth];
+
+    total.assign(n_joint, 0.0f);
+
+    for (unsigned int i=0; i!=n_joint; ++i) {
+        dst[i].location = vec3(0.0f, 0.0f, 0.0f);
+        dst[i].rotation = quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    for (unsigned int c=0; c!=md5blendnode.child.size(); ++c) {
+        if (md5blendnode.weight[c] <= 0.0f) continue;
+
+        std::vector<MD5JOINT> &src = this->get_scratch(depth, 0);
+
+        this->evaluate(md5blendnode.child[c], src, depth + 1);
+
+        const float *mask = md5blendnode.mask[c] == -1 ?
+                            NULL : &this->mask[md5blendnode.mask[c]][0];
+
+        for (unsigned int i=0; i!=n_joint; ++i) {
+            float weight = md5blendnode.weight[c] * (mask ? mask[i] : 1.0f);
+
+            if (weight <= 0.0f) continue;
+
+            // Accumulate rotations on the side of the sum so far.
+            float sign = dst[i].rotation.dotProduct(src[i].rotation) < 0.0f ?
+                         -weight : weight;
+
+            dst[i].location += src[i].location * weight;
+            dst[i].rotation += src[i].rotation * sign;
+
+            total[i] += weight;
+        }
+
+        this->n_joint_blended += n_joint;
+    }
+
+    for (unsigned int i=0; i!=n_joint; ++i) {
+        if (total[i] > 0.0f) {
+            dst[i].location /= total[i];
+            dst[i].rotation = dst[i].rotation.normalize();
+        } else {
+            dst[i].location = bind_pose[i].location;
+            dst[i].rotation = bind_pose[i].rotation;
+        }
+    }
+}
+
+
+// The base pose plus, for every layer weighted in, its offset from the
+// reference pose scaled by the weight.
+void MD5BLENDTREE::evaluate_additive(const MD5BLENDNODE &md5blendnode,
+                                     std::vector<MD5JOINT> &dst,
+                                     unsigned int depth)
+{
+    static const quaternion identity(1.0f, 0.0f, 0.0f, 0.0f);
+
+    unsigned int n_joint = dst.size();
+
+    if (md5blendnode.child.empty()) {
+        for (unsigned int i=0; i!=n_joint; ++i) {
+            dst[i].location = this->md5->bind_pose[i].location;
+            dst[i].rotation = this->md5->bind_pose[i].rotation;
+        }
+
+        return;
+    }
+
+    this->evaluate(md5blendnode.child[0], dst, depth + 1);
+
+    const std::vector<MD5JOINT> *reference = &this->md5->bind_pose;
+
+    bool evaluated = false;
+
+    for (unsigned int c=1; c!=md5blendnode.child.size(); ++c) {
+        if (md5blendnode.weight[c] <= 0.0f) continue;
+
+        // Only evaluate the reference once a layer needs it.
+        if (md5blendnode.reference != -1 && !evaluated) {
+            std::vector<MD5JOINT> &buffer = this->get_scratch(depth, 1);
+
+            this->evaluate(md5blendnode.reference, buffer, depth + 1);
+
+            reference = &buffer;
+
+            evaluated = true;
+        }
+
+        std::vector<MD5JOINT> &src = this->get_scratch(depth, 0);
+
+        this->evaluate(md5blendnode.child[c], src, depth + 1);
+
+        const float *mask = md5blendnode.mask[c] == -1 ?
+                            NULL : &this->mask[md5blendnode.mask[c]][0];
+
+        for (unsigned int i=0; i!=n_joint; ++i) {
+            float weight = md5blendnode.weight[c] * (mask ? mask[i] : 1.0f);
+
+            if (weight <= 0.0f) continue;
+
+            const MD5JOINT &md5joint = (*reference)[i];
+
+            dst[i].location += (src[i].location - md5joint.location) * weight;
+
+            // The rotation taking the reference to the layer, scaled
+            // toward identity by the weight.
+            quaternion delta(src[i].rotation * md5joint.rotation.conjugate());
+
+            if (delta->r < 0.0f) delta = -delta;
+
+            delta = (identity * (1.0f - weight) + delta * weight).normalize();
+
+            dst[i].rotation = (delta * dst[i].rotation).normalize();
+        }
+
+        this->n_joint_blended += n_joint;
+    }
+}
@@ -0,0 +1,137 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Animation graph for MD5 characters.  Leaves are the MD5ACTIONs of the
+ * MD5, as advanced by MD5::draw_action(); inner nodes either mix their
+ * children with N normalized weights, or add layers on top of a base
+ * pose.  Every child of an inner node has a weight and an optional
+ * per-joint mask, and weights can be faded over time to cross-fade from
+ * one child to another.
+ *
+ * evaluate() walks the graph from the root into a single pose.  Each node
+ * makes one pass over the joints per child it uses, children whose
+ * weight is zero are not evaluated at all, and the intermediate poses
+ * come from scratch buffers kept between calls, one per level of the
+ * graph.  The cost is bounded by the nodes currently weighted in, not by
+ * the size of the graph.
+ *
+ * Poses are in model space, like MD5::set_pose() expects.  A layer of an
+ * additive node adds, weighted, how far its pose moved away from a
+ * reference pose (the bind pose unless another node is given): its
+ * location offset, and its rotation offset applied in model space.
+ */
+
+#ifndef BLENDTREE_H
+#define BLENDTREE_H
+
+
+enum MD5BlendNodeType {
+    MD5_BLEND_ACTION   = 0,
+    MD5_BLEND_MIX      = 1,
+    MD5_BLEND_ADDITIVE = 2
+};
+
+
+struct MD5BLENDNODE {
+    MD5BlendNodeType		type;
+
+    // MD5_BLEND_ACTION: index in MD5::md5action.
+    int				action;
+
+    // MD5_BLEND_ADDITIVE: the node deltas are taken against, -1 for the
+    // bind pose.
+    int				reference;
+
+    // MD5_BLEND_MIX: the nodes mixed.  MD5_BLEND_ADDITIVE: the base pose
+    // first, then the layers.
+    std::vector<int>		child;
+
+    std::vector<float>		weight;
+
+    // Index in MD5BLENDTREE::mask, or -1 for every joint.
+    std::vector<int>		mask;
+
+    // Fades in progress: where each weight is heading, and how fast, in
+    // weight per second.
+    std::vector<float>		target;
+
+    std::vector<float>		speed;
+
+    MD5BLENDNODE(MD5BlendNodeType type) : type(type), action(-1),
+                                          reference(-1) {}
+};
+
+
+struct MD5BLENDTREE {
+    MD5				*md5;
+
+    std::vector<MD5BLENDNODE>	node;
+
+    // Per-joint weights, from 0 to 1.
+    std::vector< std::vector<float> > mask;
+
+    int				root;
+
+    // Result of the last evaluate(), ready for MD5::set_pose().
+    std::vector<MD5JOINT>	pose;
+
+    // Work done by the last evaluate().
+    unsigned int		n_node_evaluated;
+
+    unsigned int		n_joint_blended;
+
+private:
+    // Two buffers per level of the graph: one for the child being
+    // evaluated, one for the reference pose of an additive node.
+    std::vector< std::vector<MD5JOINT> > scratch;
+
+    // Weight gathered per joint by a mix node.
+    std::vector< std::vector<float> > total;
+
+public:
+    MD5BLENDTREE(MD5 *md5);
+    ~MD5BLENDTREE() {}
+    int add_action(char *name);
+    int add_mix();
+    int add_additive(int reference=-1);
+    int add_child(int node, int child, float weight, int mask=-1);
+    int add_mask(char *joint, float weight, bool descendants);
+    void set_weight(int node, int slot, float weight);
+    void fade(int node, int slot, float weight, float duration);
+    void crossfade(int node, int slot, float duration);
+    void update(float time_step);
+    const std::vector<MD5JOINT> &evaluate();
+private:
+    void evaluate(int node, std::vector<MD5JOINT> &dst, unsigned int depth);
+    void evaluate_mix(const MD5BLENDNODE &md5blendnode,
+                      std::vector<MD5JOINT> &dst,
+                      unsigned int depth);
+    void evaluate_additive(const MD5BLENDNODE &md5blendnode,
+                           std::vector<MD5JOINT> &dst,
+                           unsigned int depth);
+    std::vector<MD5JOINT> &get_scratch(unsigned int depth, unsigned int i);
+    MD5BLENDTREE(const MD5BLENDTREE &src);
+    MD5BLENDTREE &operator=(const MD5BLENDTREE &rhs);
+};
+
+#endif
@@ -0,0 +1,742 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+static inline float bvh_area(const vec3 &min, const vec3 &max)
+{
+    vec3 d = max - min;
+
+    return d->x * d->y + d->y * d->z + d->z * d->x;
+}
+
+
+static inline void bvh_grow(vec3 &min, vec3 &max,
+                            const vec3 &item_min, const vec3 &item_max)
+{
+    for (int i=0; i!=3; ++i) {
+        if (item_min[i] < min[i]) min[i] = item_min[i];
+        if (item_max[i] > max[i]) max[i] = item_max[i];
+    }
+}
+
+
+// Slab test; return the distance at which the ray enters the box, or a
+// negative value if it misses it or only hits it past max_distance.
+static inline float bvh_ray_box(const vec3 &origin, const vec3 &inv_direction,
+                                const vec3 &min, const vec3 &max,
+                                float max_distance)
+{
+    float tmin = 0.0f,
+          tmax = max_distance;
+
+    for (int i=0; i!=3; ++i) {
+        float t0 = (min[i] - origin[i]) * inv_direction[i],
+              t1 = (max[i] - origin[i]) * inv_direction[i];
+
+        if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+
+        if (t0 > tmin) tmin = t0;
+        if (t1 < tmax) tmax = t1;
+
+        if (tmin > tmax) return -1.0f;
+    }
+
+    return tmin;
+}
+
+
+static inline bool bvh_sphere_box(const vec3 &location, float radius,
+                                  const vec3 &min, const vec3 &max)
+{
+    float d = 0.0f;
+
+    for (int i=0; i!=3; ++i) {
+        float e = location[i] < min[i] ? min[i] - location[i] :
+                  location[i] > max[i] ? location[i] - max[i] : 0.0f;
+
+        d += e * e;
+    }
+
+    return d <= radius * radius;
+}
+
+
+BVH::BVH() :
+    n_node_visit(0), n_item_test(0), n_early_in(0)
+{}
+
+
+unsigned int BVH::add(const vec3 &min, const vec3 &max, void *userdata)
+{
+    BVHITEM bvhitem;
+
+    bvhitem.min      = min;
+    bvhitem.max      = max;
+    bvhitem.userdata = userdata;
+    bvhitem.type     = BVH_ITEM_BOX;
+
+    this->bvhitem.push_back(bvhitem);
+
+    return this->bvhitem.size() - 1;
+}
+
+
+unsigned int BVH::add(OBJMESH *objmesh)
+{
+    unsigned int index = this->add(vec3(0.0f, 0.0f, 0.0f),
+                                   vec3(0.0f, 0.0f, 0.0f),
+                                   objmesh);
+
+    this->bvhitem[index].type = BVH_ITEM_OBJMESH;
+
+    this->update_bounds(index);
+
+    return index;
+}
+
+
+unsigned int BVH::add(MD5 *md5)
+{
+    unsigned int index = this->add(vec3(0.0f, 0.0f, 0.0f),
+                                   vec3(0.0f, 0.0f, 0.0f),
+                                   md5);
+
+    this->bvhitem[index].type = BVH_ITEM_MD5;
+
+    this->update_bounds(index);
+
+    return index;
+}
+
+
+void BVH::set_bounds(unsigned int index, const vec3 &min, const vec3 &max)
+{
+    assert(index < this->bvhitem.size());
+
+    this->bvhitem[index].min = min;
+    this->bvhitem[index].max = max;
+}
+
+
+// Fetch the current bounds of an OBJMESH or MD5 item.  OBJMESH::location
+// is the center of the mesh and dimension its extent, as computed by
+// update_bounds().  MD5 bounds are in model space, so they are turned into
+// a sphere around location that stays valid whatever the rotation.
+void BVH::update_bounds(unsigned int index)
+{
+    BVHITEM *bvhitem = &this->bvhitem[index];
+
+    switch (bvhitem->type) {
+        case BVH_ITEM_OBJMESH:
+        {
+            OBJMESH *objmesh = (OBJMESH *)bvhitem->userdata;
+
+            vec3 half = objmesh->dimension * 0.5f;
+
+            bvhitem->min = objmesh->location - half;
+            bvhitem->max = objmesh->location + half;
+
+            break;
+        }
+
+        case BVH_ITEM_MD5:
+        {
+            MD5 *md5 = (MD5 *)bvhitem->userdata;
+
+            float s = fabsf(md5->scale->x);
+
+            if (fabsf(md5->scale->y) > s) s = fabsf(md5->scale->y);
+            if (fabsf(md5->scale->z) > s) s = fabsf(md5->scale->z);
+
+            float r = (((md5->min + md5->max) * 0.5f).length() + md5->radius) * s;
+
+            bvhitem->min = md5->location - vec3(r, r, r);
+            bvhitem->max = md5->location + vec3(r, r, r);
+
+            break;
+        }
+    }
+}
+
+
+void BVH::build()
+{
+    unsigned int n_item = this->bvhitem.size();
+
+    this->order.resize(n_item);
+
+    for (unsigned int i=0; i!=n_item; ++i) this->order[i] = i;
+
+    this->bvhnode.clear();
+
+    if (!n_item) return;
+
+    // A binary tree with at least one item per leaf never has more nodes
+    // than this, so the vector never reallocates while the children are
+    // being appended.
+    this->bvhnode.reserve(n_item * 2 - 1);
+
+    this->bvhnode.resize(1);
+
+    // Nodes left to build, as (node, first, count) triples.  The left child
+    // is pushed last so that it pops next, which keeps every node after its
+    // parent, as refit() expects, and the stack as deep as the tree.
+    this->stack.clear();
+
+    this->stack.push_back(0);
+    this->stack.push_back(0);
+    this->stack.push_back(n_item);
+
+    while (!this->stack.empty()) {
+        unsigned int count = this->stack.back(); this->stack.pop_back();
+        unsigned int first = this->stack.back(); this->stack.pop_back();
+        unsigned int node  = this->stack.back(); this->stack.pop_back();
+
+        this->build_node(node, first, count);
+    }
+}
+
+
+// Split the items [first, first + count) of order at the cheapest of the
+// BVH_BIN - 1 planes along each axis, as estimated by the surface area
+// heuristic, or make a leaf if that is cheaper.  The two children are
+// pushed on the stack for build() to process.
+void BVH::build_node(unsigned int node,
+                     unsigned int first,
+                     unsigned int count)
+{
+    vec3 min( FLT_MAX,  FLT_MAX,  FLT_MAX),
+         max(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+         cmin = min,
+         cmax = max;
+
+    for (unsigned int i=first; i!=first+count; ++i) {
+        const BVHITEM &bvhitem = this->bvhitem[this->order[i]];
+
+        vec3 center = (bvhitem.min + bvhitem.max) * 0.5f;
+
+        bvh_grow(min, max, bvhitem.min, bvhitem.max);
+
+        bvh_grow(cmin, cmax, center, center);
+    }
+
+    this->bvhnode[node].min   = min;
+    this->bvhnode[node].max   = max;
+    this->bvhnode[node].first = first;
+    this->bvhnode[node].count = count;
+
+    if (count <= BVH_MIN_LEAF) return;
+
+    int best_axis = -1,
+        best_split = 0;
+
+    float best_cost = count * bvh_area(min, max);
+
+    // Always split large leaves, however bad the split.
+    if (count > BVH_MAX_LEAF) best_cost = FLT_MAX;
+
+    for (int axis=0; axis!=3; ++axis) {
+        float extent = cmax[axis] - cmin[axis];
+
+        if (extent <= 0.0f) continue;
+
+        vec3 bmin[BVH_BIN],
+             bmax[BVH_BIN];
+
+        unsigned int bcount[BVH_BIN] = { 0 };
+
+        float scale = BVH_BIN / extent;
+
+        for (int i=0; i!=BVH_BIN; ++i) {
+            bmin[i] = vec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+            bmax[i] = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        }
+
+        for (unsigned int i=first; i!=first+count; ++i) {
+            const BVHITEM &bvhitem = this->bvhitem[this->order[i]];
+
+            int b = ((bvhitem.min[axis] + bvhitem.max[axis]) * 0.5f - cmin[axis]) * scale;
+
+            if (b >= BVH_BIN) b = BVH_BIN - 1;
+
+            ++bcount[b];
+
+            bvh_grow(bmin[b], bmax[b], bvhitem.min, bvhitem.max);
+        }
+
+        // Sweep from the right to get the area and count of every suffix,
+        // then from the left to evaluate each plane.
+        float right_area[BVH_BIN];
+
+        unsigned int right_count[BVH_BIN];
+
+        vec3 rmin = bmin[BVH_BIN-1],
+             rmax = bmax[BVH_BIN-1];
+
+        unsigned int n = bcount[BVH_BIN-1];
+
+        for (int i=BVH_BIN-1; i!=0; --i) {
+            right_area [i] = n ? bvh_area(rmin, rmax) : 0.0f;
+            right_count[i] = n;
+
+            bvh_grow(rmin, rmax, bmin[i-1], bmax[i-1]);
+
+            n += bcount[i-1];
+        }
+
+        vec3 lmin = bmin[0],
+             lmax = bmax[0];
+
+        n = bcount[0];
+
+        for (int i=1; i!=BVH_BIN; ++i) {
+            if (n && right_count[i]) {
+                float cost = n * bvh_area(lmin, lmax) +
+                             right_count[i] * right_area[i];
+
+                if (cost < best_cost) {
+                    best_cost  = cost;
+                    best_axis  = axis;
+                    best_split = i;
+                }
+            }
+
+            bvh_grow(lmin, lmax, bmin[i], bmax[i]);
+
+            n += bcount[i];
+        }
+    }
+
+    unsigned int mid;
+
+    if (best_axis == -1) {
+        if (count <= BVH_MAX_LEAF) return;
+
+        // Every center is in the same spot; any split is as good as
+        // another.
+        mid = first + count / 2;
+    } else {
+        float scale = BVH_BIN / (cmax[best_axis] - cmin[best_axis]);
+
+        unsigned int *begin = &this->order[first],
+                     *end   = begin + count;
+
+        while (begin != end) {
+            const BVHITEM &bvhitem = this->bvhitem[*begin];
+
+            int b = ((bvhitem.min[best_axis] + bvhitem.max[best_axis]) * 0.5f - cmin[best_axis]) * scale;
+
+            if (b >= BVH_BIN) b = BVH_BIN - 1;
+
+            if (b < best_split) ++begin;
+            else {
+                --end;
+
+                unsigned int t = *begin; *begin = *end; *end = t;
+            }
+        }
+
+        mid = begin - &this->order[0];
+    }
+
+    unsigned int child = this->bvhnode.size();
+
+    this->bvhnode.resize(child + 2);
+
+    this->bvhnode[node].first = child;
+    this->bvhnode[node].count = 0;
+
+    this->stack.push_back(child + 1);
+    this->stack.push_back(mid);
+    this->stack.push_back(first + count - mid);
+
+    this->stack.push_back(child);
+    this->stack.push_back(first);
+    this->stack.push_back(mid - first);
+}
+
+
+// Refresh the bounds of the OBJMESH and MD5 items, then recompute every
+// node bottom up.  Children are always stored after their parent, so one
+// backward pass over the nodes is enough.  The tree keeps its topology,
+// so call build() again when objects moved too far for it to stay tight.
+void BVH::refit()
+{
+    for (unsigned int i=0; i!=this->bvhitem.size(); ++i) {
+        if (this->bvhitem[i].type != BVH_ITEM_BOX) this->update_bounds(i);
+    }
+
+    for (int i=(int)this->bvhnode.size()-1; i>=0; --i) {
+        BVHNODE *bvhnode = &this->bvhnode[i];
+
+        if (bvhnode->count) {
+            bvhnode->min = this->bvhitem[this->order[bvhnode->first]].min;
+            bvhnode->max = this->bvhitem[this->order[bvhnode->first]].max;
+
+            for (unsigned int j=1; j!=bvhnode->count; ++j) {
+                const BVHITEM &bvhitem = this->bvhitem[this->order[bvhnode->first + j]];
+
+                bvh_grow(bvhnode->min, bvhnode->max, bvhitem.min, bvhitem.max);
+            }
+        } else {
+            const BVHNODE &left  = this->bvhnode[bvhnode->first],
+                          &right = this->bvhnode[bvhnode->first + 1];
+
+            bvhnode->min = left.min;
+            bvhnode->max = left.max;
+
+            bvh_grow(bvhnode->min, bvhnode->max, right.min, right.max);
+        }
+    }
+}
+
+
+void BVH::clear()
+{
+    this->bvhitem.clear();
+    this->bvhnode.clear();
+    this->order.clear();
+}
+
+
+// build() splits a range of order into two adjacent ones, so the items of
+// a subtree are contiguous: from the first item of its leftmost leaf to
+// the last item of its rightmost one.
+void BVH::add_subtree(unsigned int node, std::vector<unsigned int> &result)
+{
+    unsigned int left  = node,
+                 right = node;
+
+    while (!this->bvhnode[left].count) left = this->bvhnode[left].first;
+
+    while (!this->bvhnode[right].count) right = this->bvhnode[right].first + 1;
+
+    result.insert(result.end(),
+                  this->order.begin() + this->bvhnode[left].first,
+                  this->order.begin() + this->bvhnode[right].first +
+                                        this->bvhnode[right].count);
+}
+
+
+// Append to result every item whose box is at least partially inside the
+// frustum built by build_frustum().  Each stack entry carries the planes
+// its parent was not already entirely in front of, so deeper nodes are
+// tested against fewer and fewer planes; a node in front of all of them is
+// accepted with its whole subtree.
+void BVH::frustum_query(vec4 *frustum, std::vector<unsigned int> &result)
+{
+    this->reset_stats();
+
+    if (this->bvhnode.empty()) return;
+
+    this->stack.clear();
+
+    this->stack.push_back(0);
+    this->stack.push_back(0x3F);
+
+    while (!this->stack.empty()) {
+        unsigned int mask = this->stack.back(); this->stack.pop_back();
+        unsigned int node = this->stack.back(); this->stack.pop_back();
+
+        const BVHNODE &bvhnode = this->bvhnode[node];
+
+        ++this->n_node_visit;
+
+        vec3 center = (bvhnode.min + bvhnode.max) * 0.5f,
+             half   = (bvhnode.max - bvhnode.min) * 0.5f;
+
+        bool outside = false;
+
+        for (int i=0; i!=6; ++i) {
+            if (!(mask & (1 << i))) continue;
+
+            float d = frustum[i]->x * center->x +
+                      frustum[i]->y * center->y +
+                      frustum[i]->z * center->z +
+                      frustum[i]->w,
+                  r = fabsf(frustum[i]->x) * half->x +
+                      fabsf(frustum[i]->y) * half->y +
+                      fabsf(frustum[i]->z) * half->z;
+
+            if (d + r <= 0.0f) { outside = true; break; }
+
+            if (d - r > 0.0f) mask &= ~(1 << i);
+        }
+
+        if (outside) continue;
+
+        if (!mask) {
+            ++this->n_early_in;
+
+            this->add_subtree(node, result);
+        } else if (bvhnode.count) {
+            for (unsigned int i=0; i!=bvhnode.count; ++i) {
+                unsigned int index = this->order[bvhnode.first + i];
+
+                const BVHITEM &bvhitem = this->bvhitem[index];
+
+                vec3 c = (bvhitem.min + bvhitem.max) * 0.5f,
+                     h = (bvhitem.max - bvhitem.min) * 0.5f;
+
+                ++this->n_item_test;
+
+                bool visible = true;
+
+                for (int j=0; j!=6; ++j) {
+                    if (!(mask & (1 << j))) continue;
+
+                    if (frustum[j]->x * c->x +
+                        frustum[j]->y * c->y +
+                        frustum[j]->z * c->z +
+                        frustum[j]->w +
+                        fabsf(frustum[j]->x) * h->x +
+                        fabsf(frustum[j]->y) * h->y +
+                        fabsf(frustum[j]->z) * h->z <= 0.0f) {
+                        visible = false;
+
+                        break;
+                    }
+                }
+
+                if (visible) result.push_back(index);
+            }
+        } else {
+            this->stack.push_back(bvhnode.first);
+            this->stack.push_back(mask);
+            this->stack.push_back(bvhnode.first + 1);
+            this->stack.push_back(mask);
+        }
+    }
+}
+
+
+void BVH::sphere_query(const vec3 &location, float radius,
+                       std::vector<unsigned int> &result)
+{
+    this->reset_stats();
+
+    if (this->bvhnode.empty()) return;
+
+    this->stack.clear();
+
+    this->stack.push_back(0);
+
+    while (!this->stack.empty()) {
+        const BVHNODE &bvhnode = this->bvhnode[this->stack.back()];
+
+        this->stack.pop_back();
+
+        ++this->n_node_visit;
+
+        if (!bvh_sphere_box(location, radius, bvhnode.min, bvhnode.max))
+            continue;
+
+        if (bvhnode.count) {
+            for (unsigned int i=0; i!=bvhnode.count; ++i) {
+                unsigned int index = this->order[bvhnode.first + i];
+
+                ++this->n_item_test;
+
+                if (bvh_sphere_box(location, radius,
+                                   this->bvhitem[index].min,
+                                   this->bvhitem[index].max))
+                    result.push_back(index);
+            }
+        } else {
+            this->stack.push_back(bvhnode.first);
+            this->stack.push_back(bvhnode.first + 1);
+        }
+    }
+}
+
+
+// Append every item whose box the ray crosses within distance, in no
+// particular order.
+void BVH::ray_query(const vec3 &origin, const vec3 &direction,
+                    float distance, std::vector<unsigned int> &result)
+{
+    vec3 inv_direction(1.0f / direction->x,
+                       1.0f / direction->y,
+                       1.0f / direction->z);
+
+    this->reset_stats();
+
+    if (this->bvhnode.empty()) return;
+
+    this->stack.clear();
+
+    this->stack.push_back(0);
+
+    while (!this->stack.empty()) {
+        const BVHNODE &bvhnode = this->bvhnode[this->stack.back()];
+
+        this->stack.pop_back();
+
+        ++this->n_node_visit;
+
+        if (bvh_ray_box(origin, inv_direction,
+                        bvhnode.min, bvhnode.max, distance) < 0.0f)
+            continue;
+
+        if (bvhnode.count) {
+            for (unsigned int i=0; i!=bvhnode.count; ++i) {
+                unsigned int index = this->order[bvhnode.first + i];
+
+                ++this->n_item_test;
+
+                if (bvh_ray_box(origin, inv_direction,
+                                this->bvhitem[index].min,
+                                this->bvhitem[index].max,
+                                distance) >= 0.0f)
+                    result.push_back(index);
+            }
+        } else {
+            this->stack.push_back(bvhnode.first);
+            this->stack.push_back(bvhnode.first + 1);
+        }
+    }
+}
+
+
+// Return the index of the closest item hit by the ray before *distance, and
+// update *distance, or -1 if there is none.  Without a callback the item
+// boxes count as the hit surface; with one, a box hit only makes the
+// callback run the exact test.  Nodes are visited nearest child first so
+// that the closest hit found so far prunes as much as possible.
+int BVH::ray_cast(const vec3 &origin, const vec3 &direction, float *distance,
+                  BVHRAYCALLBACK *bvhraycallback)
+{
+    vec3 inv_direction(1.0f / direction->x,
+                       1.0f / direction->y,
+                       1.0f / direction->z);
+
+    int hit = -1;
+
+    this->reset_stats();
+
+    if (this->bvhnode.empty()) return -1;
+
+    this->stack.clear();
+
+    this->stack.push_back(0);
+
+    while (!this->stack.empty()) {
+        const BVHNODE &bvhnode = this->bvhnode[this->stack.back()];
+
+        this->stack.pop_back();
+
+        ++this->n_node_visit;
+
+        if (bvh_ray_box(origin, inv_direction,
+                        bvhnode.min, bvhnode.max, *distance) < 0.0f)
+            continue;
+
+        if (bvhnode.count) {
+            for (unsigned int i=0; i!=bvhnode.count; ++i) {
+                unsigned int index = this->order[bvhnode.first + i];
+
+                BVHITEM *bvhitem = &this->bvhitem[index];
+
+                float t = bvh_ray_box(origin, inv_direction,
+                                      bvhitem->min, bvhitem->max, *distance);
+
+                ++this->n_item_test;
+
+                if (t < 0.0f) continue;
+
+                if (bvhraycallback) {
+                    if (bvhraycallback(bvhitem->userdata, origin, direction, distance))
+                        hit = index;
+                } else {
+                    *distance = t;
+
+                    hit = index;
+                }
+            }
+        } else {
+            const BVHNODE &left  = this->bvhnode[bvhnode.first],
+                          &right = this->bvhnode[bvhnode.first + 1];
+
+            float tl = bvh_ray_box(origin, inv_direction, left.min,  left.max,  *distance),
+                  tr = bvh_ray_box(origin, inv_direction, right.min, right.max, *distance);
+
+            // Push the farther child first so the nearer one pops next.
+            if (tl >= 0.0f && tr >= 0.0f) {
+                if (tl < tr) {
+                    this->stack.push_back(bvhnode.first + 1);
+                    this->stack.push_back(bvhnode.first);
+                } else {
+                    this->stack.push_back(bvhnode.first);
+                    this->stack.push_back(bvhnode.first + 1);
+                }
+            }
+            else if (tl >= 0.0f) this->stack.push_back(bvhnode.first);
+            else if (tr >= 0.0f) this->stack.push_back(bvhnode.first + 1);
+        }
+    }
+
+    return hit;
+}
+
+
+// Walk the subtree with a local stack of (node, depth) pairs, since a const
+// method cannot use the traversal stack.
+unsigned int BVH::get_depth(unsigned int node) const
+{
+    std::vector<unsigned int> stack;
+
+    unsigned int depth = 0;
+
+    if (this->bvhnode.empty()) return 0;
+
+    stack.push_back(node);
+    stack.push_back(1);
+
+    while (!stack.empty()) {
+        unsigned int d = stack.back(); stack.pop_back();
+        unsigned int n = stack.back(); stack.pop_back();
+
+        const BVHNODE &bvhnode = this->bvhnode[n];
+
+        if (bvhnode.count) {
+            if (d > depth) depth = d;
+        } else {
+            stack.push_back(bvhnode.first);
+            stack.push_back(d + 1);
+            stack.push_back(bvhnode.first + 1);
+            stack.push_back(d + 1);
+        }
+    }
+
+    return depth;
+}
+
+
+void BVH::reset_stats()
+{
+    this->n_node_visit = 0;
+    this->n_item_test  = 0;
+    this->n_early_in   = 0;
+}
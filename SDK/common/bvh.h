@@ -0,0 +1,138 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Bounding volume hierarchy over axis aligned boxes, typically the bounds
+ * of the OBJMESH and MD5 of a scene.  The tree is built once with the
+ * surface area heuristic and, when objects move, refit() updates the node
+ * bounds in place without changing the topology.  It answers frustum,
+ * ray and sphere queries and keeps counters of the work done by the last
+ * one.
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+
+// Items per leaf below which a node is never split, and above which it
+// is always split, whatever the heuristic says.
+#define BVH_MIN_LEAF 2
+
+#define BVH_MAX_LEAF 8
+
+// Number of buckets used to evaluate the surface area heuristic.
+#define BVH_BIN 12
+
+
+enum {
+    BVH_ITEM_BOX     = 0,
+    BVH_ITEM_OBJMESH = 1,
+    BVH_ITEM_MD5     = 2
+};
+
+
+struct BVHITEM {
+    vec3		min;
+
+    vec3		max;
+
+    void		*userdata;
+
+    // What userdata points to, so that refit() can fetch the current
+    // bounds of OBJMESH and MD5 items by itself.
+    unsigned char	type;
+};
+
+
+struct BVHNODE {
+    vec3		min;
+
+    vec3		max;
+
+    // For a leaf, the position of its first item in BVH::order, otherwise
+    // the index of its first child, the second one following it.
+    unsigned int	first;
+
+    // Number of items of a leaf; 0 for an inner node.
+    unsigned int	count;
+};
+
+
+// Exact intersection test for ray_cast(): return true and set *distance
+// when the ray (origin + t * direction) hits the item closer than
+// *distance.
+typedef bool(BVHRAYCALLBACK(void *userdata, const vec3 &origin,
+                            const vec3 &direction, float *distance));
+
+
+struct BVH {
+    std::vector<BVHITEM>	bvhitem;
+
+    std::vector<BVHNODE>	bvhnode;
+
+    // Item indices, grouped per leaf.
+    std::vector<unsigned int>	order;
+
+    // Work done by the last query: nodes whose bounds were tested, and
+    // items tested on their own.
+    unsigned int		n_node_visit;
+
+    unsigned int		n_item_test;
+
+    // Subtrees accepted whole, without testing any of their items, by the
+    // last frustum_query().
+    unsigned int		n_early_in;
+
+private:
+    // Work stack shared by build() and the queries.
+    std::vector<unsigned int>	stack;
+
+public:
+    BVH();
+    ~BVH() {}
+    unsigned int add(const vec3 &min, const vec3 &max, void *userdata);
+    unsigned int add(OBJMESH *objmesh);
+    unsigned int add(MD5 *md5);
+    void set_bounds(unsigned int index, const vec3 &min, const vec3 &max);
+    void update_bounds(unsigned int index);
+    void build();
+    void refit();
+    void clear();
+    void frustum_query(vec4 *frustum, std::vector<unsigned int> &result);
+    void sphere_query(const vec3 &location, float radius,
+                      std::vector<unsigned int> &result);
+    void ray_query(const vec3 &origin, const vec3 &direction,
+                   float distance, std::vector<unsigned int> &result);
+    int ray_cast(const vec3 &origin, const vec3 &direction, float *distance,
+                 BVHRAYCALLBACK *bvhraycallback=NULL);
+    void *get_userdata(unsigned int index) { return this->bvhitem[index].userdata; }
+    unsigned int get_depth(unsigned int node=0) const;
+    void reset_stats();
+private:
+    void build_node(unsigned int node, unsigned int first,
+                    unsigned int count);
+    void add_subtree(unsigned int node, std::vector<unsigned int> &result);
+    BVH(const BVH &src);
+    BVH &operator=(const BVH &rhs);
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+enum {
+    CULL_SPHERE_DISTANCE  = 0,
+    CULL_SPHERE_INTERSECT = 1,
+    CULL_BOX_INTERSECT    = 2
+};
+
+
+typedef struct
+{
+    unsigned char	type;
+
+    const FRUSTUMPLANES	*frustumplanes;
+
+    const CULLVOLUMES	*cullvolumes;
+
+    unsigned int	*visibility;
+
+    unsigned int	*inside;
+
+    float		*distance;
+
+    // Always a multiple of 32, so that no two threads share a mask word.
+    unsigned int	start;
+
+    unsigned int	end;
+
+} CULLRANGE;
+
+
+// Read four consecutive values, padding past the end of the array with
+// zeros; the results for the padding lanes are thrown away.
+static inline SIMDFLOAT4 cull_fetch(const std::vector<float> &a,
+                                    unsigned int i, unsigned int n)
+{
+    if (n == 4) return simd_load(&a[i]);
+
+    float f[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (unsigned int j=0; j!=n; ++j) f[j] = a[i+j];
+
+    return simd_load(f);
+}
+
+
+static void *cull_range(void *ptr)
+{
+    CULLRANGE *range = (CULLRANGE *)ptr;
+
+    const FRUSTUMPLANES *p = range->frustumplanes;
+
+    const CULLVOLUMES *v = range->cullvolumes;
+
+    if (range->start == range->end) return NULL;
+
+    // Box extents get projected on the plane normals, so the test only
+    // needs their absolute values.
+    float ax[6], ay[6], az[6];
+
+    for (int j=0; j!=6; ++j) {
+        ax[j] = fabsf(p->x[j]);
+        ay[j] = fabsf(p->y[j]);
+        az[j] = fabsf(p->z[j]);
+    }
+
+    for (unsigned int w=range->start >> 5; w!=(range->end + 31) >> 5; ++w) {
+        range->visibility[w] = 0;
+
+        if (range->inside) range->inside[w] = 0;
+    }
+
+    for (unsigned int i=range->start; i<range->end; i+=4) {
+        unsigned int n = range->end - i < 4 ? range->end - i : 4;
+
+        SIMDFLOAT4 x = cull_fetch(v->x, i, n),
+                   y = cull_fetch(v->y, i, n),
+                   z = cull_fetch(v->z, i, n),
+                   zero = simd_splat(0.0f),
+                   d = zero,
+                   e;
+
+        SIMDMASK4 outside   = simd_none(),
+                  notinside = simd_none();
+
+        if (range->type == CULL_BOX_INTERSECT) {
+            SIMDFLOAT4 dx = cull_fetch(v->dx, i, n),
+                       dy = cull_fetch(v->dy, i, n),
+                       dz = cull_fetch(v->dz, i, n);
+
+            for (int j=0; j!=6; ++j) {
+                d = simd_madd(x, simd_splat(p->x[j]),
+                    simd_madd(y, simd_splat(p->y[j]),
+                    simd_madd(z, simd_splat(p->z[j]), simd_splat(p->w[j]))));
+
+                e = simd_madd(dx, simd_splat(ax[j]),
+                    simd_madd(dy, simd_splat(ay[j]),
+                    simd_madd(dz, simd_splat(az[j]), zero)));
+
+                // Every corner is behind the plane, respectively in front
+                // of it, exactly when the nearest, respectively farthest,
+                // one is.
+                outside   = simd_or(outside,   simd_le(simd_add(d, e), zero));
+                notinside = simd_or(notinside, simd_le(simd_sub(d, e), zero));
+            }
+        } else {
+            e = cull_fetch(v->radius, i, n);
+
+            SIMDFLOAT4 ne = simd_sub(zero, e);
+
+            for (int j=0; j!=6; ++j) {
+                d = simd_madd(x, simd_splat(p->x[j]),
+                    simd_madd(y, simd_splat(p->y[j]),
+                    simd_madd(z, simd_splat(p->z[j]), simd_splat(p->w[j]))));
+
+                outside   = simd_or(outside,   simd_lt(d, ne));
+                notinside = simd_or(notinside, simd_le(d, e));
+            }
+        }
+
+        unsigned int lanes = (1 << n) - 1,
+                     shift = i & 31;
+
+        range->visibility[i >> 5] |= (~simd_bits(outside) & lanes) << shift;
+
+        if (range->inside)
+            range->inside[i >> 5] |= (~simd_bits(notinside) & lanes) << shift;
+
+        if (range->distance) {
+            // Like sphere_distance_in_frustum(), the distance to the last
+            // plane plus the radius.
+            float f[4];
+
+            simd_store(f, simd_select(outside, zero, simd_add(d, e)));
+
+            for (unsigned int j=0; j!=n; ++j) range->distance[i+j] = f[j];
+        }
+    }
+
+    return NULL;
+}
+
+
+static void cull_batch(unsigned char       type,
+                       const FRUSTUMPLANES *frustumplanes,
+                       const CULLVOLUMES   *cullvolumes,
+                       unsigned int        *visibility,
+                       unsigned int        *inside,
+                       float               *distance,
+                       unsigned int        n_thread)
+{
+    CULLRANGE range[CULL_MAX_THREAD];
+
+    pthread_t thread[CULL_MAX_THREAD];
+
+    bool started[CULL_MAX_THREAD];
+
+    unsigned int count = cullvolumes->size(),
+                 n     = n_thread > CULL_MAX_THREAD ? CULL_MAX_THREAD : n_thread,
+                 chunk;
+
+    if (!count) return;
+
+    if (!n) n = 1;
+
+    // Not worth waking up a thread for less than a few hundred objects.
+    while (n > 1 && count / n < 256) --n;
+
+    chunk = ((count + n - 1) / n + 31) & ~31;
+
+    for (unsigned int i=0; i!=n; ++i) {
+        range[i].type          = type;
+        range[i].frustumplanes = frustumplanes;
+        range[i].cullvolumes   = cullvolumes;
+        range[i].visibility    = visibility;
+        range[i].inside        = inside;
+        range[i].distance      = distance;
+        range[i].start         = i * chunk < count ? i * chunk : count;
+        range[i].end           = (i + 1) * chunk < count ? (i + 1) * chunk : count;
+    }
+
+    // The calling thread takes the first range itself.
+    for (unsigned int i=1; i!=n; ++i) {
+        started[i] = !pthread_create(&thread[i],
+                                     NULL,
+                                     cull_range,
+                                     (void *)&range[i]);
+
+        if (!started[i]) cull_range(&range[i]);
+    }
+
+    cull_range(&range[0]);
+
+    for (unsigned int i=1; i!=n; ++i) {
+        if (started[i]) pthread_join(thread[i], NULL);
+    }
+}
+
+
+void CULLVOLUMES::resize(unsigned int size)
+{
+    this->x.resize(size);
+    this->y.resize(size);
+    this->z.resize(size);
+    this->radius.resize(size);
+    this->dx.resize(size);
+    this->dy.resize(size);
+    this->dz.resize(size);
+}
+
+
+void CULLVOLUMES::set_sphere(unsigned int index, const vec3 &location, float radius)
+{
+    assert(index < this->size());
+
+    this->x[index]      = location->x;
+    this->y[index]      = location->y;
+    this->z[index]      = location->z;
+    this->radius[index] = radius;
+}
+
+
+void CULLVOLUMES::set_box(unsigned int index, const vec3 &location, const vec3 &dimension)
+{
+    assert(index < this->size());
+
+    this->x[index]  = location->x;
+    this->y[index]  = location->y;
+    this->z[index]  = location->z;
+    this->dx[index] = dimension->x;
+    this->dy[index] = dimension->y;
+    this->dz[index] = dimension->z;
+}
+
+
+void sphere_distance_in_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                      const CULLVOLUMES   *cullvolumes,
+                                      unsigned int        *visibility,
+                                      float               *distance,
+                                      unsigned int        n_thread)
+{
+    cull_batch(CULL_SPHERE_DISTANCE, frustumplanes, cullvolumes,
+               visibility, NULL, distance, n_thread);
+}
+
+
+void sphere_intersect_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                    const CULLVOLUMES   *cullvolumes,
+                                    unsigned int        *visibility,
+                                    unsigned int        *inside,
+                                    unsigned int        n_thread)
+{
+    cull_batch(CULL_SPHERE_INTERSECT, frustumplanes, cullvolumes,
+               visibility, inside, NULL, n_thread);
+}
+
+
+void box_intersect_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                 const CULLVOLUMES   *cullvolumes,
+                                 unsigned int        *visibility,
+                                 unsigned int        *inside,
+                                 unsigned int        n_thread)
+{
+    cull_batch(CULL_BOX_INTERSECT, frustumplanes, cullvolumes,
+               visibility, inside, NULL, n_thread);
+}
@@ -0,0 +1,99 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Batch frustum culling.  Instead of testing one object at a time against
+ * the six planes, as sphere_distance_in_frustum() and friends in utils.h
+ * do, these functions take the bounding volumes of many objects in
+ * structure of arrays form and test four objects at once against each
+ * plane, using the glml SIMD backend when GLML_USE_SIMD is defined.  Large
+ * batches can be split over several threads.
+ *
+ * The results are written as visibility bitmasks, bit i of word i/32 being
+ * set when object i is at least partially inside the frustum; see
+ * cull_get_bit().
+ */
+
+#ifndef CULL_H
+#define CULL_H
+
+
+#define CULL_MAX_THREAD 8
+
+
+// x, y and z are the centers of the volumes.  radius is used by the sphere
+// tests, and dx, dy and dz, the half extents of the boxes, by the box test,
+// so only the arrays needed by the test run have to be filled in.
+struct CULLVOLUMES {
+    std::vector<float>	x;
+
+    std::vector<float>	y;
+
+    std::vector<float>	z;
+
+    std::vector<float>	radius;
+
+    std::vector<float>	dx;
+
+    std::vector<float>	dy;
+
+    std::vector<float>	dz;
+
+public:
+    void resize(unsigned int size);
+    unsigned int size() const { return (unsigned int)this->x.size(); }
+    void set_sphere(unsigned int index, const vec3 &location, float radius);
+    void set_box(unsigned int index, const vec3 &location, const vec3 &dimension);
+};
+
+
+// Number of unsigned int needed for the bitmask of count objects.
+inline unsigned int cull_get_mask_size(unsigned int count)
+{ return (count + 31) >> 5; }
+
+inline bool cull_get_bit(const unsigned int *mask, unsigned int index)
+{ return (mask[index >> 5] >> (index & 31)) & 1; }
+
+// Same as sphere_distance_in_frustum() for every volume: distance receives
+// 0 for culled objects.
+void sphere_distance_in_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                      const CULLVOLUMES *cullvolumes,
+                                      unsigned int *visibility,
+                                      float *distance,
+                                      unsigned int n_thread=1);
+
+// Same as sphere_intersect_frustum() and box_intersect_frustum(); inside,
+// when not NULL, receives the mask of the objects entirely inside the
+// frustum (IF_Inside).
+void sphere_intersect_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                    const CULLVOLUMES *cullvolumes,
+                                    unsigned int *visibility,
+                                    unsigned int *inside,
+                                    unsigned int n_thread=1);
+
+void box_intersect_frustum_batch(const FRUSTUMPLANES *frustumplanes,
+                                 const CULLVOLUMES *cullvolumes,
+                                 unsigned int *visibility,
+                                 unsigned int *inside,
+                                 unsigned int n_thread=1);
+
+#endif
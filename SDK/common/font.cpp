@@ -53,41 +53,31 @@ FONT::FONT(char *name) : character_data(NULL), font_size(0), texture_width(0),
     assert(name==NULL || strlen(name)<sizeof(this->name));
     strcpy(this->name, name ? name : "");
 
-    this->program = new PROGRAM(name);
-
-    this->program->vertex_shader = new SHADER(name, GL_VERTEX_SHADER);
-
-    this->program->vertex_shader->compile("uniform mediump mat4 MODELVIEWPROJECTIONMATRIX;"
-                                          "attribute mediump vec2 POSITION;"
-                                          "attribute lowp vec2 TEXCOORD0;"
-                                          "varying lowp vec2 texcoord0;"
-                                          "void main( void ) {"
-                                          "texcoord0 = TEXCOORD0;"
-                                          "gl_Position = MODELVIEWPROJECTIONMATRIX * vec4( POSITION.x, POSITION.y, 0.0, 1.0 ); }",
-                                          false);
-
-    this->program->fragment_shader = new SHADER(name, GL_FRAGMENT_SHADER);
-
-    this->program->fragment_shader->compile("uniform sampler2D DIFFUSE;"
-                                            "uniform lowp vec4 COLOR;"
-                                            "varying lowp vec2 texcoord0;"
-                                            "void main( void ) {"
-                                            "lowp vec4 color = texture2D( DIFFUSE, texcoord0 );"
-                                            "color.x = COLOR.x;"
-                                            "color.y = COLOR.y;"
-                                            "color.z = COLOR.z;"
-                                            "color.w *= COLOR.w;"
-                                            "gl_FragColor = color; }",
-                                            false);
-    
-    this->program->link(false);
+    this->program = RESOURCE::acquire_program("FONT",
+                                              "uniform mediump mat4 MODELVIEWPROJECTIONMATRIX;"
+                                              "attribute mediump vec2 POSITION;"
+                                              "attribute lowp vec2 TEXCOORD0;"
+                                              "varying lowp vec2 texcoord0;"
+                                              "void main( void ) {"
+                                              "texcoord0 = TEXCOORD0;"
+                                              "gl_Position = MODELVIEWPROJECTIONMATRIX * vec4( POSITION.x, POSITION.y, 0.0, 1.0 ); }",
+                                              "uniform sampler2D DIFFUSE;"
+                                              "uniform lowp vec4 COLOR;"
+                                              "varying lowp vec2 texcoord0;"
+                                              "void main( void ) {"
+                                              "lowp vec4 color = texture2D( DIFFUSE, texcoord0 );"
+                                              "color.x = COLOR.x;"
+                                              "color.y = COLOR.y;"
+                                              "color.z = COLOR.z;"
+                                              "color.w *= COLOR.w;"
+                                              "gl_FragColor = color; }");
 }
 
 
 FONT::~FONT()
 {
     if (this->program)
-        delete this->program;
+        RESOURCE::release_program(this->program);
 
     if (this->character_data)
         free(this->character_data);
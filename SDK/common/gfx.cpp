@@ -53,8 +53,14 @@ as being the original software.
 #endif
 
 GFX::GFX() :
-    matrix_mode(MODELVIEW_MATRIX)
+    matrix_mode(MODELVIEW_MATRIX),
+    normal_serial(0)
 {
+    modelview_projection_serial[ 0 ] =
+    modelview_projection_serial[ 1 ] = 0;
+
+    reset_stats();
+
 #ifdef __IPHONE_4_0
 
     printf("\nGL_VENDOR:      %s\n", ( char * )glGetString( GL_VENDOR     ) );
@@ -481,8 +487,19 @@ mat4 &GFX::get_texture_matrix( void )
 
 mat4 &GFX::get_modelview_projection_matrix( void )
 {
-    modelview_projection_matrix =
-        modelview_matrix.back() * projection_matrix.back();
+    ++n_modelview_projection_request;
+
+    if( modelview_projection_serial[ 0 ] != modelview_matrix.serial() ||
+        modelview_projection_serial[ 1 ] != projection_matrix.serial() )
+    {
+        modelview_projection_matrix =
+            modelview_matrix.back() * projection_matrix.back();
+
+        modelview_projection_serial[ 0 ] = modelview_matrix.serial();
+        modelview_projection_serial[ 1 ] = projection_matrix.serial();
+
+        ++n_modelview_projection_update;
+    }
 
     return modelview_projection_matrix;
 }
@@ -490,12 +507,30 @@ mat4 &GFX::get_modelview_projection_matrix( void )
 
 mat3 &GFX::get_normal_matrix( void )
 {
-    normal_matrix = modelview_matrix.getNormalMatrix();
+    ++n_normal_request;
+
+    if( normal_serial != modelview_matrix.serial() )
+    {
+        normal_matrix = modelview_matrix.getNormalMatrix();
+
+        normal_serial = modelview_matrix.serial();
+
+        ++n_normal_update;
+    }
 
     return normal_matrix;
 }
 
 
+void GFX::reset_stats( void )
+{
+    n_modelview_projection_request =
+    n_modelview_projection_update  =
+    n_normal_request               =
+    n_normal_update                = 0;
+}
+
+
 void GFX::ortho(const float left, const float right,
                 const float bottom, const float top,
                 const float clip_start, const float clip_end)
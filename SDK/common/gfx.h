@@ -136,6 +136,7 @@ as being the original software.
 #include <vector>
 #include <map>
 #include <memory>
+#include <algorithm>
 #include <string>
 
 #include <pthread.h>
@@ -146,6 +147,9 @@ as being the original software.
 #include <cctype>
 #include <cstdarg>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "glml.h"
@@ -172,7 +176,25 @@ struct GFX {
     
     mat3		normal_matrix;
 
+    // Serials of the matrices the two cached values above were built
+    // from, see TStack::serial().
+    unsigned int	modelview_projection_serial[ 2 ];
+
+    unsigned int	normal_serial;
+
 public:
+    // Number of get_modelview_projection_matrix()/get_normal_matrix()
+    // calls since the last reset_stats(), and how many of them actually
+    // had to recompute the matrix.  Reset them once per frame.
+    unsigned int	n_modelview_projection_request;
+
+    unsigned int	n_modelview_projection_update;
+
+    unsigned int	n_normal_request;
+
+    unsigned int	n_normal_update;
+
+
     GFX();
     ~GFX() {}
     void error( void );
@@ -193,6 +215,7 @@ public:
     mat4 &get_texture_matrix( void );
     mat4 &get_modelview_projection_matrix( void );
     mat3 &get_normal_matrix( void );
+    void reset_stats( void );
     void ortho(const float left, const float right,
                const float bottom, const float top,
                const float clip_start, const float clip_end);
@@ -236,10 +259,14 @@ private:
 #include "types.h"
 #include "thread.h"
 #include "utils.h"
+#include "simd.h"
+#include "cull.h"
 #include "memory.h"
 #include "shader.h"
 #include "program.h"
 #include "texture.h"
+#include "resource.h"
+#include "rendertarget.h"
 #include "obj.h"
 #include "navigation.h"
 #include "font.h"
@@ -247,5 +274,13 @@ private:
 #include "sound.h"
 #include "light.h"
 #include "md5.h"
+#include "blendtree.h"
+#include "animator.h"
+#include "shadow.h"
+#include "transform.h"
+#include "bvh.h"
+#include "picker.h"
+#include "occlusion.h"
+#include "portal.h"
 
 #endif
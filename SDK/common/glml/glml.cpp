@@ -27,6 +27,13 @@
 // be suitable in his problem space.  Worse than that, I have *no* empirical
 // data to support my choice of where to draw the line.
 //
+// affineInverse() is a faster inverse() for matrices whose last column is
+// (0, 0, 0, 1), i.e., any product of rotations, scales, and translations
+// such as a model view matrix.  Only the upper 3x3 submatrix needs a real
+// inverse; the translation row is then just transformed by it.  The caller
+// is responsible for knowing the matrix really is affine; a projection
+// matrix will give wrong results.
+//
 // The 5x5 and all higher order cases for the determinant(), adjoint(), and
 // inverse() rely on recursion for their computation.  Of course, that recursion
 // will get short circuited at the 4x4 case because of the methods below.  If
@@ -383,6 +390,34 @@ const mat<4,4> matNxN<4>::inverse(void) const {
                 ( bg_cf*_m[2][0] - ag_ce*_m[2][1] + af_be*_m[2][2]) * oneOverDet);
 }
 
+template <>
+const mat<4,4> matNxN<4>::affineInverse(void) const {
+    vec3    r0(_m[0], true);
+    vec3    r1(_m[1], true);
+    vec3    r2(_m[2], true);
+    vec3    c2(r0.crossProduct(r1));
+    float   det = c2.dotProduct(r2);
+
+#ifndef NDEBUG
+    if (det == 0.0f)
+        throw std::runtime_error("Divide by zero");
+#endif
+
+    float   oneOverDet = 1.0f / det;
+    vec3    c0(r1.crossProduct(r2) * oneOverDet);
+    vec3    c1(r2.crossProduct(r0) * oneOverDet);
+
+    c2 *= oneOverDet;
+
+    return mat4(c0[0], c1[0], c2[0], 0.0f,
+                c0[1], c1[1], c2[1], 0.0f,
+                c0[2], c1[2], c2[2], 0.0f,
+                -(_m[3][0]*c0[0] + _m[3][1]*c0[1] + _m[3][2]*c0[2]),
+                -(_m[3][0]*c1[0] + _m[3][1]*c1[1] + _m[3][2]*c1[2]),
+                -(_m[3][0]*c2[0] + _m[3][1]*c2[1] + _m[3][2]*c2[2]),
+                1.0f);
+}
+
 template <>
 const double matNxN<4,double>::determinant(void) const {
     double   det=0.0f;
@@ -732,3 +767,31 @@ const mat<4,4,double> matNxN<4,double>::inverse(void) const {
                  (-bg_cf*_m[3][0] + ag_ce*_m[3][1] - af_be*_m[3][2]) * oneOverDet,
                  ( bg_cf*_m[2][0] - ag_ce*_m[2][1] + af_be*_m[2][2]) * oneOverDet);
 }
+
+template <>
+const mat<4,4,double> matNxN<4,double>::affineInverse(void) const {
+    dvec3    r0(_m[0], true);
+    dvec3    r1(_m[1], true);
+    dvec3    r2(_m[2], true);
+    dvec3    c2(r0.crossProduct(r1));
+    double  det = c2.dotProduct(r2);
+
+#ifndef NDEBUG
+    if (det == 0.0)
+        throw std::runtime_error("Divide by zero");
+#endif
+
+    double  oneOverDet = 1.0 / det;
+    dvec3    c0(r1.crossProduct(r2) * oneOverDet);
+    dvec3    c1(r2.crossProduct(r0) * oneOverDet);
+
+    c2 *= oneOverDet;
+
+    return dmat4(c0[0], c1[0], c2[0], 0.0,
+                 c0[1], c1[1], c2[1], 0.0,
+                 c0[2], c1[2], c2[2], 0.0,
+                 -(_m[3][0]*c0[0] + _m[3][1]*c0[1] + _m[3][2]*c0[2]),
+                 -(_m[3][0]*c1[0] + _m[3][1]*c1[1] + _m[3][2]*c1[2]),
+                 -(_m[3][0]*c2[0] + _m[3][1]*c2[1] + _m[3][2]*c2[2]),
+                 1.0);
+}
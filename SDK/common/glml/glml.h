@@ -27,6 +27,65 @@
 #define constexpr
 #endif  /* __cplusplus < 201103L */
 
+// Optional SIMD backend.  Define GLML_USE_SIMD to replace the float vec4 and
+// mat4 arithmetic with SSE or NEON code.  The scalar templates below remain
+// the reference implementation and are what every other size and type,
+// the quaternions included, uses.  Loads and stores are unaligned
+// since mat4 and vec4 objects live in std::vector and in structures that
+// do not guarantee 16 byte alignment.
+#ifdef GLML_USE_SIMD
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GLML_SIMD_SSE
+#include <xmmintrin.h>
+typedef __m128  glml_float4;
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define GLML_SIMD_NEON
+#include <arm_neon.h>
+typedef float32x4_t glml_float4;
+#endif
+#endif  /* GLML_USE_SIMD */
+
+#if defined(GLML_SIMD_SSE) || defined(GLML_SIMD_NEON)
+#define GLML_SIMD
+
+#ifdef GLML_SIMD_SSE
+inline glml_float4 glml_load(const float *p) { return _mm_loadu_ps(p); }
+inline void glml_store(float *p, const glml_float4 a) { _mm_storeu_ps(p, a); }
+inline glml_float4 glml_splat(const float f) { return _mm_set1_ps(f); }
+inline glml_float4 glml_add(const glml_float4 a, const glml_float4 b) { return _mm_add_ps(a, b); }
+inline glml_float4 glml_sub(const glml_float4 a, const glml_float4 b) { return _mm_sub_ps(a, b); }
+inline glml_float4 glml_mul(const glml_float4 a, const glml_float4 b) { return _mm_mul_ps(a, b); }
+// a*b + c
+inline glml_float4 glml_madd(const glml_float4 a, const glml_float4 b, const glml_float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline float glml_hsum(const glml_float4 a) {
+    __m128  t = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+}
+#else
+inline glml_float4 glml_load(const float *p) { return vld1q_f32(p); }
+inline void glml_store(float *p, const glml_float4 a) { vst1q_f32(p, a); }
+inline glml_float4 glml_splat(const float f) { return vdupq_n_f32(f); }
+inline glml_float4 glml_add(const glml_float4 a, const glml_float4 b) { return vaddq_f32(a, b); }
+inline glml_float4 glml_sub(const glml_float4 a, const glml_float4 b) { return vsubq_f32(a, b); }
+inline glml_float4 glml_mul(const glml_float4 a, const glml_float4 b) { return vmulq_f32(a, b); }
+// a*b + c
+inline glml_float4 glml_madd(const glml_float4 a, const glml_float4 b, const glml_float4 c) { return vmlaq_f32(c, a, b); }
+inline float glml_hsum(const glml_float4 a) {
+    float32x2_t t = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpadd_f32(t, t), 0);
+}
+#endif
+
+// Row vector times the 4x4 matrix whose rows start at m: a linear
+// combination of the rows, so no transpose or horizontal add is needed.
+inline glml_float4 glml_row_mul(const float *v, const float *m) {
+    glml_float4 r = glml_mul(glml_splat(v[0]), glml_load(m));
+    r = glml_madd(glml_splat(v[1]), glml_load(m+4),  r);
+    r = glml_madd(glml_splat(v[2]), glml_load(m+8),  r);
+    return glml_madd(glml_splat(v[3]), glml_load(m+12), r);
+}
+#endif  /* GLML_SIMD_SSE || GLML_SIMD_NEON */
+
 // Create math library to emulate GLSL vector and matrix capabilities
 // For all classes created we need
 // - constructor,
@@ -226,6 +285,31 @@ public:
     }
 };
 
+#ifdef GLML_SIMD
+template <>
+inline vec<4,float> &vec<4,float>::operator+=(const vec<4,float> &rhs) {
+    glml_store(_v, glml_add(glml_load(_v), glml_load(rhs._v)));
+    return *this;
+}
+
+template <>
+inline vec<4,float> &vec<4,float>::operator-=(const vec<4,float> &rhs) {
+    glml_store(_v, glml_sub(glml_load(_v), glml_load(rhs._v)));
+    return *this;
+}
+
+template <>
+inline vec<4,float> &vec<4,float>::operator*=(const float rhs) {
+    glml_store(_v, glml_mul(glml_load(_v), glml_splat(rhs)));
+    return *this;
+}
+
+template <>
+inline const float vec<4,float>::dotProduct(const vec<4,float> &rhs) const {
+    return glml_hsum(glml_mul(glml_load(_v), glml_load(rhs._v)));
+}
+#endif  /* GLML_SIMD */
+
 // This implementation of withinEpsilon for vector types is experimental.
 // I'm not sure if this is the correct way to determine if each of the
 // elements of the vectors a, and b are within epsilon WRT to the scale
@@ -500,6 +584,36 @@ inline const mat<nrows,ncols,Type> operator*(const mat<nrows,nrc,Type> &lhs, con
     }
     return tmp;
 }
+
+#ifdef GLML_SIMD
+template <>
+inline vec<4,float> &vec<4,float>::operator*=(const mat<4,4,float> &rhs)
+{
+    glml_store(_v, glml_row_mul(_v, rhs.m()));
+    return *this;
+}
+
+inline const vec<4,float> operator*(const vec<4,float> &lhs, const mat<4,4,float> &rhs)
+{
+    vec<4,float>    tmp;
+    glml_store(tmp.v(), glml_row_mul(lhs.v(), rhs.m()));
+    return tmp;
+}
+
+// Each row of the product is the matching row of lhs times rhs.
+inline const mat<4,4,float> operator*(const mat<4,4,float> &lhs, const mat<4,4,float> &rhs)
+{
+    mat<4,4,float>  tmp;
+    const float     *a = lhs.m();
+    const float     *b = rhs.m();
+    float           *c = tmp.m();
+    glml_store(c,    glml_row_mul(a,    b));
+    glml_store(c+4,  glml_row_mul(a+4,  b));
+    glml_store(c+8,  glml_row_mul(a+8,  b));
+    glml_store(c+12, glml_row_mul(a+12, b));
+    return tmp;
+}
+#endif  /* GLML_SIMD */
     
 template <int nrows, int ncols, typename Type>
 inline std::ostream &operator<<(std::ostream &os, const mat<nrows,ncols,Type> &rhs)
@@ -532,6 +646,8 @@ public:
     const Type determinant(void) const;
     const mat<nrc,nrc,Type> adjoint(void) const;
     const mat<nrc,nrc,Type> inverse(void) const;
+    // Only defined for the 4x4 case.  See the comment in glml.cpp.
+    const mat<nrc,nrc,Type> affineInverse(void) const;
 };
 
 template <>
@@ -680,6 +796,11 @@ inline const mat<nrc, nrc, Type> inverse(const mat<nrc, nrc, Type> &m) {
     return ((matNxN<nrc, Type> *)(&m))->inverse();
 }
 
+template <int nrc, typename Type>
+inline const mat<nrc, nrc, Type> affineInverse(const mat<nrc, nrc, Type> &m) {
+    return ((matNxN<nrc, Type> *)(&m))->affineInverse();
+}
+
 template <int nelems, typename Type>
 inline vec<nelems,Type> &vec<nelems,Type>::operator/=(const matNxN<nelems,Type> &rhs)
 {
@@ -1676,6 +1797,12 @@ const mat<4,4,double> matNxN<4,double>::adjoint(void) const;
     
 template <>
 const mat<4,4,double> matNxN<4,double>::inverse(void) const;
+
+template <>
+const mat<4,4> matNxN<4>::affineInverse(void) const;
+
+template <>
+const mat<4,4,double> matNxN<4,double>::affineInverse(void) const;
     
 // I constructed a quaternion class to do 3D rotations.  For this reason
 // the default constructor sets the quaternion to the value of the
@@ -13,9 +13,13 @@ TStack &TStack::push()
     if (mStack.size()) {
         mStack.resize(mStack.size()+1);
         *(mStack.end()-1) = *(mStack.end()-2);
+        mFlags.push_back(mFlags.back());
+        mSerial.push_back(mSerial.back());
     } else {
         // The stack is empty.  Push on the identity matrix.
         mStack.push_back(mat4(1));
+        mFlags.push_back(AFFINE | CONFORMAL);
+        mSerial.push_back(++mNextSerial);
     }
 
     return *this;
@@ -27,10 +31,34 @@ TStack &TStack::pop()
         throw stack_bottom("Already at bottom of transformation stack");
 
     mStack.pop_back();
+    mFlags.pop_back();
+    mSerial.pop_back();
 
     return *this;
 }
 
+// Work out the flags for a matrix handed in from outside the stack.
+static unsigned char matrixFlags(const mat4 &m)
+{
+    if (m[0][3] != 0.0f || m[1][3] != 0.0f || m[2][3] != 0.0f || m[3][3] != 1.0f)
+        return 0;
+
+    vec3    r0(m[0], true);
+    vec3    r1(m[1], true);
+    vec3    r2(m[2], true);
+    float   s = r0.dotProduct(r0);
+    float   e = s * 1.0e-5f;
+
+    if (fabsf(r1.dotProduct(r1) - s) > e ||
+        fabsf(r2.dotProduct(r2) - s) > e ||
+        fabsf(r0.dotProduct(r1)) > e ||
+        fabsf(r0.dotProduct(r2)) > e ||
+        fabsf(r1.dotProduct(r2)) > e)
+        return TStack::AFFINE;
+
+    return TStack::AFFINE | TStack::CONFORMAL;
+}
+
 // Create rotation matrix from a quaternion
 static void rotationMatrix(mat4 &m, const quaternion &q)
 {
@@ -58,6 +86,9 @@ static void rotationMatrix(mat4 &m, const quaternion &q)
 TStack &TStack::loadRotation(const quaternion &q)
 {
     rotationMatrix(mStack.back(), q);
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -90,6 +121,9 @@ static void rotationMatrix(mat4 &m, const float theta, const vec3 &v)
 TStack &TStack::loadRotation(const float degrees, const vec3 &v)
 {
     rotationMatrix(mStack.back(), DegreesToRadians(degrees), v);
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -105,16 +139,22 @@ static void rotationMatrix(mat4 &m, const vec4 &r)
 TStack &TStack::loadRotation(const vec4 &v)
 {
     rotationMatrix(mStack.back(), v);
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
 
-static void rotateMultiply(mat4 &m, const mat4 &r)
+// When m is affine the last column of its first three rows is zero and
+// stays zero, so only three columns need to be computed.
+static void rotateMultiply(mat4 &m, const mat4 &r, const bool affine)
 {
     mat3x4  a(m[0], m[1], m[2]);
+    int     nCols = affine ? 3 : a.nCols();
 
     for (int i=0; i!=a.nRows(); ++i) {
-        for (int j=0; j!=a.nCols(); ++j) {
+        for (int j=0; j!=nCols; ++j) {
             m[i][j] = r[i][0] * a[0][j];
             for (int k=1; k!=a.nRows(); ++k)
                 m[i][j] += r[i][k] * a[k][j];
@@ -128,7 +168,9 @@ TStack &TStack::rotate(const quaternion &q)
 
     rotationMatrix(r, q);
 
-    rotateMultiply(mStack.back(), r);
+    rotateMultiply(mStack.back(), r, isAffine());
+
+    touch();
 
     return *this;
 }
@@ -139,7 +181,9 @@ TStack &TStack::rotate(const float degrees, const vec3 &v)
 
     rotationMatrix(r, DegreesToRadians(degrees), v);
 
-    rotateMultiply(mStack.back(), r);
+    rotateMultiply(mStack.back(), r, isAffine());
+
+    touch();
 
     return *this;
 }
@@ -150,7 +194,9 @@ TStack &TStack::rotate(const vec4 &v)
 
     rotationMatrix(r, v);
 
-    rotateMultiply(mStack.back(), r);
+    rotateMultiply(mStack.back(), r, isAffine());
+
+    touch();
 
     return *this;
 }
@@ -171,6 +217,9 @@ TStack &TStack::loadScaleFactors(const vec3 &s)
     }
     M[3][0] = M[3][1] = M[3][2] = 0.0;
     M[3][3] = 1.0;
+    mFlags.back() = (s[0] == s[1] && s[1] == s[2]) ? AFFINE | CONFORMAL : AFFINE;
+
+    touch();
 
     return *this;
 }
@@ -183,6 +232,9 @@ TStack &TStack::loadScaleFactors(const float sx, const float sy, const float sz)
     M[1][0] = 0.0f; M[1][1] = sy;   M[1][2] = 0.0f; M[1][3] = 0.0f;
     M[2][0] = 0.0f; M[2][1] = 0.0f; M[2][2] = sz;   M[2][3] = 0.0f;
     M[3][0] = 0.0f; M[3][1] = 0.0f; M[3][2] = 0.0f; M[3][3] = 1.0f;
+    mFlags.back() = (sx == sy && sy == sz) ? AFFINE | CONFORMAL : AFFINE;
+
+    touch();
 
     return *this;
 }
@@ -191,6 +243,10 @@ TStack &TStack::scale(const vec3 &s)
 {
     for (int i=0; i!=s.nElems(); ++i)
         mStack.back()[i] *= s[i];
+    if (s[0] != s[1] || s[1] != s[2])
+        mFlags.back() &= ~CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -200,6 +256,10 @@ TStack &TStack::scale(const float sx, const float sy, const float sz)
     mStack.back()[0] *= sx;
     mStack.back()[1] *= sy;
     mStack.back()[2] *= sz;
+    if (sx != sy || sy != sz)
+        mFlags.back() &= ~CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -219,6 +279,9 @@ TStack &TStack::loadTranslation(const vec3 &t)
         }
     }
     M[3] = vec4(t, 1.0);
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -231,44 +294,74 @@ TStack &TStack::loadTranslation(const float tx, const float ty, const float tz)
     M[1][0] = 0.0f; M[1][1] = 1.0f; M[1][2] = 0.0f; M[1][3] = 0.0f;
     M[2][0] = 0.0f; M[2][1] = 0.0f; M[2][2] = 1.0f; M[2][3] = 0.0f;
     M[3][0] = tx;   M[3][1] = ty;   M[3][2] = tz;   M[3][3] = 1.0f;
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
 
+// The translation only changes the last row.  For an affine matrix its
+// last element, 1, is unaffected since the first three rows end in 0.
 TStack &TStack::translate(const vec3 &t)
 {
     mat4    &M = mStack.back();
+    int     nCols = isAffine() ? 3 : 4;
 
-    for (int j=0; j<4; j++)
+    for (int j=0; j<nCols; j++)
         for (int i=0; i<3; i++)
             M[3][j] += t[i] * M[i][j];
 
+    touch();
+
     return *this;
 }
 
 TStack &TStack::translate(const float tx, const float ty, const float tz)
 {
     mat4    &M = mStack.back();
+    int     nCols = isAffine() ? 3 : 4;
 
-    for (int j=0; j<4; j++) {
+    for (int j=0; j<nCols; j++) {
         M[3][j] += tx * M[0][j];
         M[3][j] += ty * M[1][j];
         M[3][j] += tz * M[2][j];
     }
 
+    touch();
+
     return *this;
 }
 
 TStack &TStack::loadMatrix(const mat4 &a)
 {
     mStack.back() = a;
+    mFlags.back() = matrixFlags(a);
+
+    touch();
 
     return *this;
 }
 
+// When a is affine each of its first three rows is a combination of only
+// the first three rows of M, and its last row adds M's last row to that.
 TStack &TStack::multiplyMatrix(const mat4 &a)
 {
-    mStack.back() = a * mStack.back();
+    mat4            &M = mStack.back();
+    unsigned char   flags = matrixFlags(a);
+
+    if (flags & AFFINE) {
+        mat3x4  tmp(M[0], M[1], M[2]);
+
+        for (int i=0; i!=3; ++i)
+            M[i] = a[i][0]*tmp[0] + a[i][1]*tmp[1] + a[i][2]*tmp[2];
+        M[3] += a[3][0]*tmp[0] + a[3][1]*tmp[1] + a[3][2]*tmp[2];
+    } else {
+        M = a * M;
+    }
+    mFlags.back() &= flags;
+
+    touch();
 
     return *this;
 }
@@ -302,12 +395,17 @@ TStack &TStack::lookAt(const vec3 &eye, const vec3 &center, const vec3 &up)
         M[3] += m[3][i]*tmp[i];
     }
     
+    touch();
+
     return *this;
 }
 
 TStack &TStack::loadLookAt(const vec3 &eye, const vec3 &center, const vec3 &up)
 {
     lookAtMatrix(mStack.back(), eye, center, up);
+    mFlags.back() = AFFINE | CONFORMAL;
+
+    touch();
 
     return *this;
 }
@@ -344,6 +442,9 @@ TStack &TStack::frustum(const float l, const float r,
     M[0] *= m[0][0];
     M[1] *= m[1][1];
     M[3] =  m[3][2]*tmp;
+    mFlags.back() = 0;
+
+    touch();
 
     return *this;
 }
@@ -353,6 +454,9 @@ TStack &TStack::loadFrustum(const float l, const float r,
                             const float n, const float f)
 {
     frustumMatrix(mStack.back(), l, r, b, t, n, f);
+    mFlags.back() = 0;
+
+    touch();
 
     return *this;
 }
@@ -387,6 +491,9 @@ TStack &TStack::ortho(const float l, const float r,
     M[0] *= m[0][0];
     M[1] *= m[1][1];
     M[2] *= m[2][2];
+    mFlags.back() &= AFFINE;
+
+    touch();
 
     return *this;
 }
@@ -396,6 +503,9 @@ TStack &TStack::loadOrtho(const float l, const float r,
                           const float n, const float f)
 {
     orthoMatrix(mStack.back(), l, r, b, t, n, f);
+    mFlags.back() = AFFINE;
+
+    touch();
 
     return *this;
 }
@@ -427,6 +537,9 @@ TStack &TStack::perspective(const float fovy, const float aspect,
     M[1] *= m[1][1];
     M[2] =  m[2][2]*tmp - M[3];
     M[3] =  m[3][2]*tmp;
+    mFlags.back() = 0;
+
+    touch();
 
     return *this;
 }
@@ -435,6 +548,9 @@ TStack &TStack::loadPerspective(const float fovy, const float aspect,
                                 const float near, const float far)
 {
     perspectiveMatrix(mStack.back(), fovy, aspect, near, far);
+    mFlags.back() = 0;
+
+    touch();
 
     return *this;
 }
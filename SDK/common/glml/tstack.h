@@ -26,12 +26,42 @@ public:
 #define mglTEXTURE      2
 #define mglCOLOR        3
 
+// Each matrix on the stack carries flags describing its shape so that the
+// common model view case can skip work:
+// - AFFINE: the last column is (0, 0, 0, 1), i.e., no projection has been
+//   applied.  Compositions then only touch the upper 3x4 part.
+// - CONFORMAL: additionally the upper 3x3 is a rotation times a uniform
+//   scale, so the normal matrix is just that 3x3 divided by the squared
+//   scale.
+// Each level also has a serial number that changes whenever its matrix
+// does, so that callers can cache values derived from the matrix, e.g.,
+// GFX's model view projection matrix, and know when to recompute them.
+// Serials are unique within a TStack, so popping back to a level brings
+// back that level's serial as well.
+//
+// The flags and serials are maintained by the TStack operations.  Code that
+// writes directly into back() or operator[]() should use loadMatrix()
+// instead so they stay correct.
 class TStack {
-    std::vector<mat4>   mStack;
+    std::vector<mat4>           mStack;
+    std::vector<unsigned char>  mFlags;
+    std::vector<unsigned int>   mSerial;
+    unsigned int                mNextSerial;
+
+    void touch(void) {
+        mSerial.back() = ++mNextSerial;
+    }
 
 public:
-    TStack(void) {
+    enum {
+        AFFINE      = 1 << 0,
+        CONFORMAL   = 1 << 1
+    };
+
+    TStack(void) : mNextSerial(1) {
         mStack.push_back(mat4(1));
+        mFlags.push_back(AFFINE | CONFORMAL);
+        mSerial.push_back(mNextSerial);
     }
     ~TStack(void) {}
     TStack &push(void);
@@ -59,8 +89,22 @@ public:
     }
     TStack &loadIdentity(void) {
         mStack.back().loadIdentity();
+        mFlags.back() = AFFINE | CONFORMAL;
+        touch();
         return *this;
     }
+    unsigned char flags(void) const {
+        return mFlags.back();
+    }
+    unsigned int serial(void) const {
+        return mSerial.back();
+    }
+    bool isAffine(void) const {
+        return mFlags.back() & AFFINE;
+    }
+    const mat4 getInverse(void) const {
+        return isAffine() ? affineInverse(mStack.back()) : inverse(mStack.back());
+    }
     TStack &loadRotation(const vec4 &);
     TStack &loadRotation(const float, const vec3 &);
     TStack &loadRotation(const quaternion &);
@@ -110,9 +154,18 @@ public:
 // the transpose of the upper 3x3 submatrix and taking its inverse.  This
 // avoids 3 conversions from vec4 to vec3, and the transpose operation.  It's
 // a small optimization but every little bit helps.
+//
+// For a conformal matrix, s*R, the inverse transpose is R/s, which is the
+// upper 3x3 submatrix scaled by 1/s^2; no inverse is needed at all.
 inline const mat3 TStack::getNormalMatrix(void) const
 {
     const mat4  &m = this->mStack.back();
+    if (mFlags.back() & CONFORMAL) {
+        float   s = 1.0f / (m[0][0]*m[0][0] + m[0][1]*m[0][1] + m[0][2]*m[0][2]);
+        return mat3(m[0][0]*s, m[0][1]*s, m[0][2]*s,
+                    m[1][0]*s, m[1][1]*s, m[1][2]*s,
+                    m[2][0]*s, m[2][1]*s, m[2][2]*s);
+    }
     return mat3(m[0][0], m[1][0], m[2][0],
                 m[0][1], m[1][1], m[2][1],
                 m[0][2], m[1][2], m[2][2]).inverse();
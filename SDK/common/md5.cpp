@@ -55,6 +55,142 @@ static void vec3_rotate_quat(vec3 &dst, const vec3 &v0, const quaternion &v1)
 }
 
 
+typedef struct
+{
+    MD5			*md5;
+
+    // Range of blocks, counted over all the streams of all the meshes.
+    unsigned int	start;
+
+    unsigned int	end;
+
+} MD5SKINRANGE;
+
+
+// Skin the 4 vertices of a block of a stream into vertex_data.
+static void MD5_skin_block(MD5MESH                *md5mesh,
+                           const MD5SKINSTREAM    &md5skinstream,
+                           unsigned int           block,
+                           const float            *joint_matrix)
+{
+    SIMDFLOAT4  zero = simd_splat(0.0f),
+                px = zero, py = zero, pz = zero,
+                nx = zero, ny = zero, nz = zero,
+                tx = zero, ty = zero, tz = zero;
+
+    unsigned int n_weight = md5skinstream.n_weight;
+
+    const unsigned short *joint = &md5skinstream.joint[block * n_weight * 4];
+
+    const float *weight = &md5skinstream.weight[block * n_weight * 40];
+
+    for (unsigned int i=0; i!=n_weight; ++i, joint += 4, weight += 40) {
+        // Load the rows of the 4 joint matrices and transpose them, so
+        // that mRC holds element R, C of the matrix of every lane.
+        const float *m0 = &joint_matrix[joint[0] * 12],
+                    *m1 = &joint_matrix[joint[1] * 12],
+                    *m2 = &joint_matrix[joint[2] * 12],
+                    *m3 = &joint_matrix[joint[3] * 12];
+
+        SIMDFLOAT4  m00 = simd_load(m0),     m01 = simd_load(m1),     m02 = simd_load(m2),     m03 = simd_load(m3),
+                    m10 = simd_load(m0 + 4), m11 = simd_load(m1 + 4), m12 = simd_load(m2 + 4), m13 = simd_load(m3 + 4),
+                    m20 = simd_load(m0 + 8), m21 = simd_load(m1 + 8), m22 = simd_load(m2 + 8), m23 = simd_load(m3 + 8);
+
+        simd_transpose(m00, m01, m02, m03);
+        simd_transpose(m10, m11, m12, m13);
+        simd_transpose(m20, m21, m22, m23);
+
+        SIMDFLOAT4  bias = simd_load(weight);
+
+        SIMDFLOAT4  x = simd_load(&weight[4]),
+                    y = simd_load(&weight[8]),
+                    z = simd_load(&weight[12]);
+
+        px = simd_madd(bias, simd_madd(m00, x, simd_madd(m01, y, simd_madd(m02, z, m03))), px);
+        py = simd_madd(bias, simd_madd(m10, x, simd_madd(m11, y, simd_madd(m12, z, m13))), py);
+        pz = simd_madd(bias, simd_madd(m20, x, simd_madd(m21, y, simd_madd(m22, z, m23))), pz);
+
+        x = simd_load(&weight[16]);
+        y = simd_load(&weight[20]);
+        z = simd_load(&weight[24]);
+
+        nx = simd_madd(bias, simd_madd(m00, x, simd_madd(m01, y, simd_mul(m02, z))), nx);
+        ny = simd_madd(bias, simd_madd(m10, x, simd_madd(m11, y, simd_mul(m12, z))), ny);
+        nz = simd_madd(bias, simd_madd(m20, x, simd_madd(m21, y, simd_mul(m22, z))), nz);
+
+        x = simd_load(&weight[28]);
+        y = simd_load(&weight[32]);
+        z = simd_load(&weight[36]);
+
+        tx = simd_madd(bias, simd_madd(m00, x, simd_madd(m01, y, simd_mul(m02, z))), tx);
+        ty = simd_madd(bias, simd_madd(m10, x, simd_madd(m11, y, simd_mul(m12, z))), ty);
+        tz = simd_madd(bias, simd_madd(m20, x, simd_madd(m21, y, simd_mul(m22, z))), tz);
+    }
+
+    float out[9][4];
+
+    simd_store(out[0], px); simd_store(out[1], py); simd_store(out[2], pz);
+    simd_store(out[3], nx); simd_store(out[4], ny); simd_store(out[5], nz);
+    simd_store(out[6], tx); simd_store(out[7], ty); simd_store(out[8], tz);
+
+    float   *vertex_array  = (float *)md5mesh->vertex_data,
+            *normal_array  = (float *)&md5mesh->vertex_data[md5mesh->offset[1]],
+            *tangent_array = (float *)&md5mesh->vertex_data[md5mesh->offset[3]];
+
+    const unsigned int *vertex = &md5skinstream.vertex[block * 4];
+
+    for (int i=0; i!=4; ++i) {
+        unsigned int v = vertex[i] * 3;
+
+        vertex_array [v] = out[0][i]; vertex_array [v + 1] = out[1][i]; vertex_array [v + 2] = out[2][i];
+        normal_array [v] = out[3][i]; normal_array [v + 1] = out[4][i]; normal_array [v + 2] = out[5][i];
+        tangent_array[v] = out[6][i]; tangent_array[v + 1] = out[7][i]; tangent_array[v + 2] = out[8][i];
+    }
+}
+
+
+static void *MD5_skin_range(void *ptr)
+{
+    MD5SKINRANGE *range = (MD5SKINRANGE *)ptr;
+
+    MD5 *md5 = range->md5;
+
+    unsigned int first = 0;
+
+    for (auto md5mesh=md5->md5mesh.begin();
+         md5mesh!=md5->md5mesh.end(); ++md5mesh) {
+        if (md5mesh->gpu_skin) continue;
+
+        for (auto md5skinstream=md5mesh->md5meshdata->md5skinstream.begin();
+             md5skinstream!=md5mesh->md5meshdata->md5skinstream.end(); ++md5skinstream) {
+
+            unsigned int n_block = md5skinstream->vertex.size() / 4,
+                         start   = std::max(range->start, first),
+                         end     = std::min(range->end, first + n_block);
+
+            for (unsigned int i=start; i<end; ++i)
+                MD5_skin_block(&(*md5mesh), *md5skinstream, i - first,
+                               &md5->joint_matrix[0]);
+
+            first += n_block;
+
+            if (first >= range->end) return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Bind pose of an MD5 whose model failed to load.
+static const std::vector<MD5JOINT> no_joint;
+
+static const std::vector<MD5JOINT> &MD5_get_bind_pose(const MD5MODEL *md5model)
+{
+    return md5model ? md5model->bind_pose : no_joint;
+}
+
+
 static void quat_build_r(quaternion &q)
 {
     float l = 1.0f - (q->i * q->i) -
@@ -65,16 +201,21 @@ static void quat_build_r(quaternion &q)
 }
 
 
-MD5::MD5(char *filename, const bool relative_path) :
-    visible(true), location(0,0,0), rotation(0,0,0), scale(1,1,1),
-    min(FLT_MAX,FLT_MAX,FLT_MAX), max(-FLT_MAX,-FLT_MAX,-FLT_MAX),
-    dimension(0,0,0), radius(0.0f), distance(1.0f), btrigidbody(NULL)
+// An empty model, for load_cache().
+MD5MODEL::MD5MODEL() : optimized(false), built(false),
+                       joint_importance_serial(0)
+{
+}
+
+
+MD5MODEL::MD5MODEL(const char *filename, const bool relative_path) :
+    optimized(false), built(false), joint_importance_serial(0)
 {
     MEMORY  *m = new MEMORY(filename, relative_path);
 
     if (!m) return;
 
-    get_file_name(filename, this->name);
+    get_file_name((char *)filename, this->name);
 
     char *line = strtok((char *)m->buffer, "\n");
 
@@ -89,7 +230,7 @@ MD5::MD5(char *filename, const bool relative_path) :
         } else if (sscanf(line, "numJoints %d", &n_joint) == 1) {
             this->bind_pose.resize(n_joint);
         } else if (sscanf(line, "numMeshes %d", &n_mesh) == 1) {
-            this->md5mesh.resize(n_mesh);
+            this->md5meshdata.resize(n_mesh);
         } else if (!strncmp(line, "joints {", 8)) {
             unsigned int i = 0;
 
@@ -129,10 +270,10 @@ MD5::MD5(char *filename, const bool relative_path) :
             unsigned int    n_triangle;
 
             while (line[0] != '}') {
-                if (sscanf(line, " shader \"%[^\"]", this->md5mesh[mesh_index].shader) == 1) {
+                if (sscanf(line, " shader \"%[^\"]", this->md5meshdata[mesh_index].shader) == 1) {
                     goto next_mesh_line;
                 } else if (sscanf(line, " numverts %d", &n_vertex) == 1) {
-                    this->md5mesh[mesh_index].md5vertex.resize(n_vertex);
+                    this->md5meshdata[mesh_index].md5vertex.resize(n_vertex);
                 } else if (sscanf(line,
                                   " vert %d ( %f %f ) %d %d",
                                   &int_val,
@@ -140,20 +281,20 @@ MD5::MD5(char *filename, const bool relative_path) :
                                   &md5vertex.uv->y,
                                   &md5vertex.start,
                                   &md5vertex.count) == 5) {
-                    this->md5mesh[mesh_index].md5vertex[int_val] = md5vertex;
+                    this->md5meshdata[mesh_index].md5vertex[int_val] = md5vertex;
                 } else if (sscanf(line, " numtris %d", &n_triangle) == 1) {
-                    this->md5mesh[mesh_index].n_indice = n_triangle * 3;
+                    this->md5meshdata[mesh_index].n_indice = n_triangle * 3;
 
-                    this->md5mesh[mesh_index].md5triangle.resize(n_triangle);
+                    this->md5meshdata[mesh_index].md5triangle.resize(n_triangle);
                 } else if (sscanf(line,
                                   " tri %d %hu %hu %hu",
                                   &int_val,
                                   &md5triangle.indice[2],
                                   &md5triangle.indice[1],
                                   &md5triangle.indice[0]) == 4) {
-                    this->md5mesh[mesh_index].md5triangle[int_val] = md5triangle;
+                    this->md5meshdata[mesh_index].md5triangle[int_val] = md5triangle;
                 } else if (sscanf(line, " numweights %d", &n_weight) == 1) {
-                    this->md5mesh[mesh_index].md5weight.resize(n_weight);
+                    this->md5meshdata[mesh_index].md5weight.resize(n_weight);
                 } else if (sscanf(line,
                                   " weight %d %d %f ( %f %f %f )",
                                   &int_val,
@@ -162,7 +303,7 @@ MD5::MD5(char *filename, const bool relative_path) :
                                   &md5weight.location->x,
                                   &md5weight.location->y,
                                   &md5weight.location->z) == 6) {
-                    this->md5mesh[mesh_index].md5weight[int_val] = md5weight;
+                    this->md5meshdata[mesh_index].md5weight[int_val] = md5weight;
 
                 }
 
@@ -174,9 +315,9 @@ MD5::MD5(char *filename, const bool relative_path) :
             // the constructor for MD5MESH already created it with 0
             // elements.  Here the code uses reserve() to short circuit
             // the need to do multiple reallocations, copies, and frees.
-            this->md5mesh[mesh_index].indice.reserve(this->md5mesh[mesh_index].n_indice);
+            this->md5meshdata[mesh_index].indice.reserve(this->md5meshdata[mesh_index].n_indice);
 
-            auto    &md5mesh = this->md5mesh[mesh_index];
+            auto    &md5mesh = this->md5meshdata[mesh_index];
             for (int j=0; j!=md5mesh.md5triangle.size(); ++j) {
                 // CRL -- When this code is converted to C++ 11 and
                 // md5triangle.indice is declared as "array<unsigned short,3>"
@@ -198,6 +339,8 @@ MD5::MD5(char *filename, const bool relative_path) :
         
         line = strtok(NULL, "\n");
     }
+
+    this->build_joint_bound();
     
 cleanup:
     
@@ -205,47 +348,90 @@ cleanup:
 }
 
 
-int MD5::load_action(char *name, char *filename, const bool relative_path)
+// A vertex is its weights moved by their joint and averaged by bias, so
+// it stays within the boxes of the weights of its joints once they are
+// posed, as long as its biases add up to one, as the format requires.
+void MD5MODEL::build_joint_bound()
 {
-    MEMORY *m = new MEMORY(filename, relative_path);
+    this->joint_min.assign(this->bind_pose.size(), vec3( FLT_MAX,  FLT_MAX,  FLT_MAX));
 
-    if (!m) return -1;
+    this->joint_max.assign(this->bind_pose.size(), vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
 
-    MD5ACTION *md5action;
+    for (auto md5meshdata=this->md5meshdata.begin();
+         md5meshdata!=this->md5meshdata.end(); ++md5meshdata) {
 
-    this->md5action.push_back(MD5ACTION(name));
+        for (auto md5weight=md5meshdata->md5weight.begin();
+             md5weight!=md5meshdata->md5weight.end(); ++md5weight) {
+
+            vec3 &min = this->joint_min[md5weight->joint],
+                 &max = this->joint_max[md5weight->joint];
+
+            for (int i=0; i!=3; ++i) {
+                min[i] = std::min(min[i], md5weight->location[i]);
+                max[i] = std::max(max[i], md5weight->location[i]);
+            }
+        }
+    }
+}
+
+
+// An empty animation, for load_cache().
+MD5ANIM::MD5ANIM() :
+    n_frame(0), fps(0.0f), location_error(0.0f), rotation_error(0.0f)
+{
+}
 
-    md5action = &this->md5action.back();
 
+MD5ANIM::MD5ANIM(const char *filename, const bool relative_path) :
+    n_frame(0), fps(0.0f), location_error(0.0f), rotation_error(0.0f)
+{
+    MEMORY *m = new MEMORY(filename, relative_path);
+
+    if (!m) return;
+
+    get_file_name((char *)filename, this->name);
+
+    std::vector<int> parent;
+
+    // Uncompressed until the whole file is read.
+    std::vector<std::vector<MD5JOINT> > frame;
 
     char *line = strtok((char *)m->buffer, "\n");
 
     int int_val = 0;
 
     while (line) {
-        unsigned int    n_frame;
         if (sscanf(line, "MD5Version %d", &int_val) == 1) {
             if (int_val != 10) goto cleanup;
-        } else if (sscanf(line, "numFrames %d", &n_frame) == 1) {
-            md5action->frame.resize(n_frame);
-
-            for (int i=0; i != n_frame; ++i)
-                md5action->frame[i].resize(this->bind_pose.size());
+        } else if (sscanf(line, "numFrames %d", &this->n_frame) == 1) {
+            // The joint count that follows sizes the frames.
         } else if (sscanf(line, "numJoints %d", &int_val) == 1) {
-            if (this->bind_pose.size() != int_val) goto cleanup;
+            parent.resize(int_val, -1);
 
-            md5action->pose.resize(this->bind_pose.size());
+            frame.resize(this->n_frame);
 
-            for (int i=0; i != this->bind_pose.size(); ++i)
-                strcpy(md5action->pose[i].name, this->bind_pose[i].name);
+            for (int i=0; i != this->n_frame; ++i)
+                frame[i].resize(parent.size());
         } else if (sscanf(line, "frameRate %d", &int_val) == 1) {
-            md5action->fps = 1.0f / (float)int_val;
-        } else if (sscanf(line, "frame %d", &int_val)) {
-            auto &md5joint = md5action->frame[int_val];
+            this->fps = 1.0f / (float)int_val;
+        } else if (!strncmp(line, "hierarchy {", 11)) {
+            line = strtok(NULL, "\n");
+
+            for (unsigned int i=0; line && line[0] != '}'; ++i) {
+                char name[ MAX_CHAR ] = "";
+
+                // Only the parents matter, the MD5 names the joints.
+                if (i < parent.size())
+                    sscanf(line, " \"%[^\"]\" %d", name, &parent[i]);
+
+                line = strtok(NULL, "\n");
+            }
+        } else if (sscanf(line, "frame %d", &int_val) == 1 && int_val < this->n_frame) {
+            auto &md5joint = frame[int_val];
 
             line = strtok(NULL, "\n");
 
-            for (int i=0; i != this->bind_pose.size(); ++i) {
+            for (int i=0; i != parent.size(); ++i) {
                 if (sscanf(line,
                            " %f %f %f %f %f %f",
                            &md5joint[i].location->x,
@@ -254,7 +440,7 @@ int MD5::load_action(char *name, char *filename, const bool relative_path)
                            &md5joint[i].rotation->i,
                            &md5joint[i].rotation->j,
                            &md5joint[i].rotation->k) == 6) {
-                    strcpy(md5joint[i].name, this->bind_pose[i].name);
+                    md5joint[i].parent = parent[i];
 
                     quat_build_r(md5joint[i].rotation);
                 }
@@ -265,302 +451,1975 @@ int MD5::load_action(char *name, char *filename, const bool relative_path)
 
             vec3 location;
 
-            quaternion rotation;
-
-            for (int i=0; i != this->bind_pose.size(); ++i) {
-                if (this->bind_pose[i].parent > -1) {
-                    MD5JOINT *md5joint = &md5action->frame[int_val][this->bind_pose[i].parent];
+            for (int i=0; i != parent.size(); ++i) {
+                if (parent[i] > -1) {
+                    MD5JOINT *md5parent = &md5joint[parent[i]];
 
                     vec3_rotate_quat(location,
-                                     md5action->frame[int_val][i].location,
-                                     md5joint->rotation);
+                                     md5joint[i].location,
+                                     md5parent->rotation);
 
-                    md5action->frame[int_val][i].location = location + md5joint->location;
-                    
-                    md5action->frame[int_val][i].rotation =
-                        (md5joint->rotation * md5action->frame[int_val][i].rotation).normalize();
+                    md5joint[i].location = location + md5parent->location;
+
+                    md5joint[i].rotation =
+                        (md5parent->rotation * md5joint[i].rotation).normalize();
                 }
             }
         }
-        
-    next_line:
-        
-        line = strtok(NULL, "\n");	
+
+        line = strtok(NULL, "\n");
     }
-    
+
     delete m;
-    
-    return (this->md5action.size() - 1);
-    
-    
+
+    // Key frames are indexed with 16 bits.
+    assert(this->n_frame <= USHRT_MAX);
+
+    if (frame.empty() || parent.empty())
+        this->n_frame = 0;
+    else
+        this->compress(frame, MD5_ANIM_LOCATION_ERROR, MD5_ANIM_ROTATION_ERROR);
+
+    return;
+
+
 cleanup:
-    
-    
-    this->md5action.resize(this->md5action.size() - 1);
+
+    this->n_frame = 0;
+
     delete m;
-    
-    return -1;
 }
 
 
-void MD5::free_mesh_data()
+// Smallest-three: the largest component of a unit quaternion follows
+// from the other three, which all lie within +/-1/sqrt(2).  They get 15
+// bits each and the index of the dropped one goes in the top bits of the
+// first two shorts.
+static void MD5_pack_rotation(const float *q, unsigned short *key)
 {
-    for (auto md5mesh=this->md5mesh.begin();
-         md5mesh != this->md5mesh.end(); ++md5mesh) {
+    int largest = 0;
 
-        md5mesh->indice.clear();
+    for (int i=1; i!=4; ++i)
+        if (fabsf(q[i]) > fabsf(q[largest])) largest = i;
 
-        md5mesh->md5triangle.clear();
-    }
-}
+    // q and -q are the same rotation, keep the dropped component positive.
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
 
+    for (int i=0, j=0; i!=4; ++i) {
+        if (i == largest) continue;
 
-MD5ACTION *MD5::get_action(char *name, const bool exact_name)
-{
-    if (exact_name) {
-        for (int i=0; i != this->md5action.size(); ++i) {
-            if (!strcmp(this->md5action[i].name, name))
-                return &this->md5action[i];
-        }
-    } else {
-        for (int i=0; i != this->md5action.size(); ++i) {
-            if (strstr(this->md5action[i].name, name))
-                return &this->md5action[i];
-        }
+        float v = CLAMP(q[i] * sign * 0.70710678f + 0.5f, 0.0f, 1.0f);
+
+        key[j++] = (unsigned short)(v * 32767.0f + 0.5f);
     }
 
-    return NULL;
+    key[0] |= (largest & 1) << 15;
+    key[1] |= (largest & 2) << 14;
 }
 
 
-MD5MESH *MD5::get_mesh(char *name, const bool exact_name)
+static void MD5_unpack_rotation(const unsigned short *key, float *q)
 {
-    if (exact_name) {
-        for (auto md5mesh=this->md5mesh.begin();
-             md5mesh != this->md5mesh.end(); ++md5mesh) {
-            if (!strcmp(md5mesh->shader, name))
-                return &(*md5mesh);
-        }
-    } else {
-        for (auto md5mesh=this->md5mesh.begin();
-             md5mesh != this->md5mesh.end(); ++md5mesh) {
-            if (strstr(md5mesh->shader, name))
-                return &(*md5mesh);
-        }
+    int largest = (key[0] >> 15) | ((key[1] >> 14) & 2);
+
+    float sum = 0.0f;
+
+    for (int i=0, j=0; i!=4; ++i) {
+        if (i == largest) continue;
+
+        q[i] = ((key[j++] & 0x7FFF) / 32767.0f - 0.5f) * 1.41421356f;
+
+        sum += q[i] * q[i];
     }
 
-    return NULL;
+    q[largest] = sqrtf(std::max(0.0f, 1.0f - sum));
 }
 
 
-MD5ACTION::MD5ACTION(const char *name) : curr_frame(0), next_frame(1),
-                                         state(STOP), method(MD5_METHOD_FRAME),
-                                         loop(false), frame_time(0), fps(0)
+static void MD5_dequantize_location(const MD5TRACK &md5track,
+                                    const unsigned short *key,
+                                    float *location)
 {
-    assert(name==NULL || strlen(name)<sizeof(this->name));
-    strcpy(this->name, name ? name : "");
+    for (int i=0; i!=3; ++i)
+        location[i] = md5track.min[i] + key[i] * md5track.scale[i];
 }
 
-void MD5ACTION::action_play(const MD5Method frame_interpolation_method,
-                            const bool loop)
+
+// A frame between two keys: lerp for locations, normalized lerp on the
+// shorter arc for rotations.
+static void MD5_interpolate_key(const float *a,
+                                const float *b,
+                                const float t,
+                                const bool rotation,
+                                float *dst)
 {
-    this->method = frame_interpolation_method;
-    this->loop   = loop;
-    this->state  = PLAY;
+    float s = 1.0f;
 
-    if (!this->frame_time && frame_interpolation_method == MD5_METHOD_FRAME) {
-        this->frame_time =
-        this->fps;
+    if (rotation && a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3] < 0.0f)
+        s = -1.0f;
+
+    for (int i=0; i!=(rotation ? 4 : 3); ++i)
+        dst[i] = a[i] + (b[i] * s - a[i]) * t;
+
+    if (rotation) {
+        float l = sqrtf(dst[0]*dst[0] + dst[1]*dst[1] + dst[2]*dst[2] + dst[3]*dst[3]);
+
+        for (int i=0; i!=4; ++i) dst[i] /= l;
     }
 }
 
 
-void MD5ACTION::action_pause()
+// Distance between two locations, or about the angle between two
+// rotations.
+static float MD5_key_error(const float *a, const float *b, const bool rotation)
 {
-    this->state = PAUSE;
-}
+    float s = 1.0f, e = 0.0f;
 
+    if (rotation && a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3] < 0.0f)
+        s = -1.0f;
 
-void MD5ACTION::action_stop()
-{
-    this->curr_frame = 0;
-    this->next_frame = 1;
-    this->state = STOP;
-    this->frame_time = 0.0f;
+    for (int i=0; i!=(rotation ? 4 : 3); ++i)
+        e += (a[i] - b[i] * s) * (a[i] - b[i] * s);
+
+    // |a - b| is 2 sin(angle / 4) for unit quaternions.
+    return rotation ? 2.0f * sqrtf(e) : sqrtf(e);
 }
 
 
-void MD5ACTION::set_action_fps(float fps)
+static bool MD5_segment_fits(const std::vector<float> &value,
+                             const std::vector<float> &exact,
+                             const bool rotation,
+                             const float tolerance,
+                             const unsigned int a,
+                             const unsigned int b)
 {
-    this->fps = 1.0f / fps;
-}
+    float v[4];
 
-MD5MESH::MD5MESH(const char *name) :
-    vbo(0), size(0), stride(0), vertex_data(NULL),
-    mode(GL_TRIANGLES), n_indice(0), vbo_indice(0),
-    vao(0), visible(true), objmaterial(NULL)
-{
-    assert(name==NULL || strlen(name)<sizeof(shader));
-    strcpy(shader, name ? name : "");
+    for (unsigned int f=a+1; f!=b; ++f) {
+        MD5_interpolate_key(&value[a * 4], &value[b * 4],
+                            (float)(f - a) / (float)(b - a),
+                            rotation, v);
+
+        if (MD5_key_error(v, &exact[f * 4], rotation) > tolerance)
+            return false;
+    }
+
+    return true;
 }
 
-MD5MESH::MD5MESH(const MD5MESH &src) :
-    md5vertex(src.md5vertex), vbo(src.vbo), size(src.size),
-    stride(src.stride), md5triangle(src.md5triangle), mode(src.mode),
-    n_indice(src.n_indice), indice(src.indice),
-    vbo_indice(src.vbo_indice), md5weight(src.md5weight), vao(src.vao),
-    visible(src.visible), objmaterial(src.objmaterial)
+
+// Pick the frames of a track to keep as keys: stretch every segment as
+// far as interpolating its two ends stays within tolerance of the frames
+// it spans.  value holds the quantized frames, exact the ones from the
+// file, 4 floats each.
+static void MD5_reduce_keys(const std::vector<float> &value,
+                            const std::vector<float> &exact,
+                            const bool rotation,
+                            const float tolerance,
+                            std::vector<unsigned int> &key)
 {
-    strcpy(shader, src.shader);
+    unsigned int n_frame = exact.size() / 4;
 
-    vertex_data = (unsigned char *) calloc(1, size);
-    memcpy(vertex_data, src.vertex_data, size);
+    key.assign(1, 0);
 
-    memcpy(offset, src.offset, sizeof(offset));
+    // A joint that does not move needs a single key.
+    bool constant = true;
+
+    for (unsigned int f=1; f<n_frame && constant; ++f)
+        constant = MD5_key_error(&value[0], &exact[f * 4], rotation) <= tolerance;
+
+    if (constant) return;
+
+    for (unsigned int a=0; a != n_frame - 1;) {
+        unsigned int b = a + 1;
+
+        while (b + 1 < n_frame &&
+               MD5_segment_fits(value, exact, rotation, tolerance, a, b + 1))
+            ++b;
+
+        key.push_back(b);
+
+        a = b;
+    }
 }
 
-void MD5MESH::set_mesh_attributes()
+
+void MD5ANIM::compress(const std::vector<std::vector<MD5JOINT> > &frame,
+                       const float max_location_error,
+                       const float max_rotation_error)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+    unsigned int n_joint = frame[0].size();
 
-    glEnableVertexAttribArray(0);
+    std::vector<float> exact(this->n_frame * 4),
+                       value(this->n_frame * 4);
 
-    glVertexAttribPointer(0,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          0,
-                          (void *)NULL);
+    std::vector<unsigned short> quantized(this->n_frame * 3);
 
+    std::vector<unsigned int> key;
 
-    glEnableVertexAttribArray(1);
+    this->track.assign(n_joint, MD5TRACK());
 
-    glVertexAttribPointer(1,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          0,
-                          BUFFER_OFFSET(this->offset[1]));
+    for (unsigned int j=0; j!=n_joint; ++j) {
+        MD5TRACK &md5track = this->track[j];
 
+        // Locations, 16 bits per component over the range of the track.
+        vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-    glEnableVertexAttribArray(2);
+        md5track.min = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
 
-    glVertexAttribPointer(2,
-                          2,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          0,
-                          BUFFER_OFFSET(this->offset[2]));
+        for (unsigned int f=0; f!=this->n_frame; ++f) {
+            for (int i=0; i!=3; ++i) {
+                md5track.min[i] = std::min(md5track.min[i], frame[f][j].location[i]);
+
+                max[i] = std::max(max[i], frame[f][j].location[i]);
+            }
+        }
 
+        md5track.scale = (max - md5track.min) / 65535.0f;
 
-    glEnableVertexAttribArray(3);
+        for (unsigned int f=0; f!=this->n_frame; ++f) {
+            for (int i=0; i!=3; ++i) {
+                float v = frame[f][j].location[i];
 
-    glVertexAttribPointer(3,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          0,
-                          BUFFER_OFFSET(this->offset[3]));
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbo_indice);
-}
+                exact[f * 4 + i] = v;
 
+                quantized[f * 3 + i] = md5track.scale[i] > 0.0f ?
+                    (unsigned short)((v - md5track.min[i]) / md5track.scale[i] + 0.5f) : 0;
+            }
 
-void MD5MESH::set_mesh_visibility(const bool visible)
-{
-    this->visible = visible;
-}
+            MD5_dequantize_location(md5track, &quantized[f * 3], &value[f * 4]);
+        }
 
+        MD5_reduce_keys(value, exact, false, max_location_error, key);
 
-void MD5MESH::set_mesh_material(OBJMATERIAL *objmaterial)
-{
-    this->objmaterial = objmaterial;
-}
+        md5track.location = this->location_frame.size();
+        md5track.n_location = key.size();
 
+        for (unsigned int k=0; k!=key.size(); ++k) {
+            this->location_frame.push_back(key[k]);
 
-void MD5::optimize(unsigned int vertex_cache_size)
-{
-    unsigned int s;
+            for (int i=0; i!=3; ++i)
+                this->location_key.push_back(quantized[key[k] * 3 + i]);
+        }
+
+        // Rotations, smallest-three.
+        for (unsigned int f=0; f!=this->n_frame; ++f) {
+            const quaternion &rotation = frame[f][j].rotation;
+
+            float *q = &exact[f * 4];
+
+            q[0] = rotation->r; q[1] = rotation->i; q[2] = rotation->j; q[3] = rotation->k;
+
+            MD5_pack_rotation(q, &quantized[f * 3]);
+
+            MD5_unpack_rotation(&quantized[f * 3], &value[f * 4]);
+        }
+
+        MD5_reduce_keys(value, exact, true, max_rotation_error, key);
+
+        md5track.rotation = this->rotation_frame.size();
+        md5track.n_rotation = key.size();
+
+        for (unsigned int k=0; k!=key.size(); ++k) {
+            this->rotation_frame.push_back(key[k]);
+
+            for (int i=0; i!=3; ++i)
+                this->rotation_key.push_back(quantized[key[k] * 3 + i]);
+        }
+    }
+
+    // What the tolerances above and the quantization add up to.
+    this->location_error =
+    this->rotation_error = 0.0f;
+
+    for (unsigned int f=0; f!=this->n_frame; ++f) {
+        for (unsigned int j=0; j!=n_joint; ++j) {
+            vec3 location;
+
+            quaternion rotation;
+
+            this->get_joint(f, j, location, rotation);
+
+            const MD5JOINT &md5joint = frame[f][j];
+
+            float a[4] = { rotation->r, rotation->i, rotation->j, rotation->k },
+                  b[4] = { md5joint.rotation->r, md5joint.rotation->i,
+                           md5joint.rotation->j, md5joint.rotation->k };
+
+            this->location_error = std::max(this->location_error,
+                                            (location - md5joint.location).length());
+
+            this->rotation_error = std::max(this->rotation_error,
+                                            MD5_key_error(a, b, true));
+        }
+    }
+}
+
+
+// Bytes held by the keys, for comparison with n_frame * joint count *
+// sizeof(MD5JOINT).
+unsigned int MD5ANIM::get_size() const
+{
+    return this->track.size() * sizeof(MD5TRACK) +
+           (this->location_frame.size() +
+            this->location_key.size() +
+            this->rotation_frame.size() +
+            this->rotation_key.size()) * sizeof(unsigned short);
+}
+
+
+void MD5ANIM::get_joint(const unsigned int frame,
+                        const unsigned int joint,
+                        vec3 &location,
+                        quaternion &rotation) const
+{
+    const MD5TRACK &md5track = this->track[joint];
+
+    float a[4], b[4], v[4];
+
+    // The last key at or before frame, and the one after it if any.
+    const unsigned short *key_frame = &this->location_frame[md5track.location];
+
+    unsigned int k = std::upper_bound(key_frame,
+                                      key_frame + md5track.n_location,
+                                      frame) - key_frame - 1;
+
+    MD5_dequantize_location(md5track,
+                            &this->location_key[(md5track.location + k) * 3],
+                            a);
+
+    if (k + 1 < md5track.n_location && key_frame[k] != frame) {
+        MD5_dequantize_location(md5track,
+                                &this->location_key[(md5track.location + k + 1) * 3],
+                                b);
+
+        MD5_interpolate_key(a, b,
+                            (float)(frame - key_frame[k]) /
+                            (float)(key_frame[k + 1] - key_frame[k]),
+                            false, v);
+
+        location = vec3(v[0], v[1], v[2]);
+    } else
+        location = vec3(a[0], a[1], a[2]);
+
+    key_frame = &this->rotation_frame[md5track.rotation];
+
+    k = std::upper_bound(key_frame,
+                         key_frame + md5track.n_rotation,
+                         frame) - key_frame - 1;
+
+    MD5_unpack_rotation(&this->rotation_key[(md5track.rotation + k) * 3], a);
+
+    if (k + 1 < md5track.n_rotation && key_frame[k] != frame) {
+        MD5_unpack_rotation(&this->rotation_key[(md5track.rotation + k + 1) * 3], b);
+
+        MD5_interpolate_key(a, b,
+                            (float)(frame - key_frame[k]) /
+                            (float)(key_frame[k + 1] - key_frame[k]),
+                            true, v);
+
+        rotation = quaternion(v[0], v[1], v[2], v[3]);
+    } else
+        rotation = quaternion(a[0], a[1], a[2], a[3]);
+}
+
+
+// Decode a frame, or only the joints listed when joint is given.
+void MD5ANIM::get_pose(const unsigned int frame,
+                       std::vector<MD5JOINT> &pose,
+                       const std::vector<unsigned int> *joint) const
+{
+    if (joint) {
+        for (auto i=joint->begin(); i!=joint->end(); ++i)
+            this->get_joint(frame, *i, pose[*i].location, pose[*i].rotation);
+
+        return;
+    }
+
+    for (unsigned int i=0; i!=this->track.size(); ++i)
+        this->get_joint(frame, i, pose[i].location, pose[i].rotation);
+}
+
+
+// Binary caches.  A header made of the magic, MD5_CACHE_VERSION, the
+// kind of file and the size of the structures stored raw, so that a file
+// written by another build of the engine is rejected and rebuilt rather
+// than misread, then the path, size and stamp of the text file it was
+// made from, so that it is rebuilt as well once that file changes.  Then
+// fields and vectors (count, then elements) in the order of the
+// save_cache() functions.  The counts and indices are checked on load.
+#define MD5_CACHE_VERSION	3
+
+typedef struct
+{
+    char		magic[ 4 ];
+
+    unsigned int	version;
+
+    unsigned int	kind;
+
+    unsigned int	size[ 5 ];
+
+    char		source[ MAX_PATH ];
+
+    unsigned int	source_size;
+
+    unsigned int	source_stamp;
+
+} MD5CACHEHEADER;
+
+
+// Read cursor over a cache file mapped in memory.
+typedef struct
+{
+    const unsigned char	*data;
+
+    size_t		size;
+
+    size_t		position;
+
+} MD5CACHE;
+
+
+static bool MD5_cache_header(MD5CACHEHEADER *header, const unsigned int kind,
+                             const char *source)
+{
+    memset(header, 0, sizeof(MD5CACHEHEADER));
+
+    if (strlen(source) >= sizeof(header->source) ||
+        !RESOURCE::get_file_stamp(source,
+                                  &header->source_size,
+                                  &header->source_stamp)) return false;
+
+    strcpy(header->source, source);
+
+    memcpy(header->magic, "MD5C", 4);
+
+    header->version = MD5_CACHE_VERSION;
+    header->kind    = kind;
+    header->size[0] = sizeof(MD5JOINT);
+    header->size[1] = sizeof(MD5VERTEX);
+    header->size[2] = sizeof(MD5TRIANGLE);
+    header->size[3] = sizeof(MD5WEIGHT);
+    header->size[4] = sizeof(MD5TRACK);
+
+    return true;
+}
+
+
+static bool MD5_cache_read(MD5CACHE *cache, void *dst, const size_t size)
+{
+    if (cache->position + size > cache->size) return false;
+
+    memcpy(dst, cache->data + cache->position, size);
+
+    cache->position += size;
+
+    return true;
+}
+
+
+template <typename T>
+static bool MD5_cache_read(MD5CACHE *cache, std::vector<T> &v)
+{
+    unsigned int n;
+
+    if (!MD5_cache_read(cache, &n, sizeof(n)) ||
+        cache->position + (size_t)n * sizeof(T) > cache->size)
+        return false;
+
+    v.resize(n);
+
+    return !n || MD5_cache_read(cache, &v[0], n * sizeof(T));
+}
+
+
+static void MD5_cache_write(FILE *f, const void *src, const size_t size)
+{
+    fwrite(src, size, 1, f);
+}
+
+
+template <typename T>
+static void MD5_cache_write(FILE *f, const std::vector<T> &v)
+{
+    unsigned int n = v.size();
+
+    MD5_cache_write(f, &n, sizeof(n));
+
+    if (n) MD5_cache_write(f, &v[0], n * sizeof(T));
+}
+
+
+// Map filename and check its header against source, the cursor is left
+// past it.
+static bool MD5_cache_open(const char *filename,
+                           const unsigned int kind,
+                           const char *source,
+                           MD5CACHE *cache)
+{
+    MD5CACHEHEADER header, expected;
+
+    struct stat st;
+
+    int fd = open(filename, O_RDONLY);
+
+    if (fd == -1) return false;
+
+    cache->data     = NULL;
+    cache->position = 0;
+
+    if (!fstat(fd, &st) && st.st_size >= (off_t)sizeof(MD5CACHEHEADER)) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            cache->data = (const unsigned char *)data;
+            cache->size = st.st_size;
+        }
+    }
+
+    close(fd);
+
+    if (!cache->data) return false;
+
+    MD5_cache_read(cache, &header, sizeof(header));
+
+    if (!MD5_cache_header(&expected, kind, source) ||
+        memcmp(&header, &expected, sizeof(header))) {
+        munmap((void *)cache->data, cache->size);
+
+        return false;
+    }
+
+    return true;
+}
+
+
+static void MD5_cache_close(MD5CACHE *cache)
+{
+    munmap((void *)cache->data, cache->size);
+}
+
+
+// Write to a temporary file renamed over filename once complete, so that
+// an interrupted save never leaves a truncated cache behind.
+static FILE *MD5_cache_create(const char *filename, const unsigned int kind,
+                              const char *source)
+{
+    char tmp[MAX_PATH] = {""};
+
+    MD5CACHEHEADER header;
+
+    if (strlen(filename) + 4 >= sizeof(tmp) ||
+        !MD5_cache_header(&header, kind, source)) return NULL;
+
+    sprintf(tmp, "%s.tmp", filename);
+
+    FILE *f = fopen(tmp, "wb");
+
+    if (!f) return NULL;
+
+    MD5_cache_write(f, &header, sizeof(header));
+
+    return f;
+}
+
+
+static bool MD5_cache_commit(FILE *f, const char *filename)
+{
+    char tmp[MAX_PATH] = {""};
+
+    sprintf(tmp, "%s.tmp", filename);
+
+    bool ok = !ferror(f);
+
+    ok = !fclose(f) && ok;
+
+    if (ok && !rename(tmp, filename)) return true;
+
+    unlink(tmp);
+
+    return false;
+}
+
+
+// Whether the indices of a mesh read from a cache stay within its own
+// vectors and the n_joint joints of the model, so that a corrupt file is
+// parsed again instead of crashing the skinning.
+static bool MD5_check_cache(const MD5MESHDATA *md5meshdata,
+                            const unsigned int n_joint)
+{
+    unsigned int n_vertex = md5meshdata->md5vertex.size(),
+                 n_weight = md5meshdata->md5weight.size();
+
+    if (n_vertex > 65536 ||
+        md5meshdata->n_indice > md5meshdata->indice.size()) return false;
+
+    for (auto md5vertex=md5meshdata->md5vertex.begin();
+         md5vertex!=md5meshdata->md5vertex.end(); ++md5vertex) {
+        if (md5vertex->start > n_weight ||
+            md5vertex->count > n_weight - md5vertex->start) return false;
+    }
+
+    for (auto md5triangle=md5meshdata->md5triangle.begin();
+         md5triangle!=md5meshdata->md5triangle.end(); ++md5triangle) {
+        for (int i=0; i!=3; ++i)
+            if (md5triangle->indice[i] >= n_vertex) return false;
+    }
+
+    for (auto indice=md5meshdata->indice.begin();
+         indice!=md5meshdata->indice.end(); ++indice) {
+        if (*indice >= n_vertex) return false;
+    }
+
+    for (auto md5weight=md5meshdata->md5weight.begin();
+         md5weight!=md5meshdata->md5weight.end(); ++md5weight) {
+        if (md5weight->joint < 0 ||
+            (unsigned int)md5weight->joint >= n_joint) return false;
+    }
+
+    return true;
+}
+
+
+// Same for the n keys of a track starting at first: they must exist, the
+// first one on frame 0, in increasing order.
+static bool MD5_check_key(const std::vector<unsigned short> &frame,
+                          const unsigned int first, const unsigned int n)
+{
+    if (!n || first > frame.size() || n > frame.size() - first ||
+        frame[first]) return false;
+
+    for (unsigned int i=first + 1; i!=first + n; ++i)
+        if (frame[i] <= frame[i - 1]) return false;
+
+    return true;
+}
+
+
+// The parsed model with the weight normals and tangents and, if it was
+// optimized, the strips.  The skinning streams are rebuilt on load.
+bool MD5MODEL::save_cache(const char *filename, const char *source) const
+{
+    FILE *f = MD5_cache_create(filename, 'M', source);
+
+    if (!f) return false;
+
+    unsigned int n_mesh = this->md5meshdata.size();
+
+    MD5_cache_write(f, this->name, sizeof(this->name));
+    MD5_cache_write(f, &this->optimized, sizeof(this->optimized));
+    MD5_cache_write(f, this->bind_pose);
+    MD5_cache_write(f, &n_mesh, sizeof(n_mesh));
+
+    for (auto md5meshdata=this->md5meshdata.begin();
+         md5meshdata!=this->md5meshdata.end(); ++md5meshdata) {
+        MD5_cache_write(f, md5meshdata->shader, sizeof(md5meshdata->shader));
+        MD5_cache_write(f, &md5meshdata->mode, sizeof(md5meshdata->mode));
+        MD5_cache_write(f, &md5meshdata->n_indice, sizeof(md5meshdata->n_indice));
+        MD5_cache_write(f, md5meshdata->md5vertex);
+        MD5_cache_write(f, md5meshdata->md5triangle);
+        MD5_cache_write(f, md5meshdata->indice);
+        MD5_cache_write(f, md5meshdata->md5weight);
+    }
+
+    return MD5_cache_commit(f, filename);
+}
+
+
+bool MD5MODEL::load_cache(const char *filename, const char *source)
+{
+    MD5CACHE cache;
+
+    unsigned int n_mesh = 0;
+
+    if (!MD5_cache_open(filename, 'M', source, &cache)) return false;
+
+    bool ok = MD5_cache_read(&cache, this->name, sizeof(this->name)) &&
+              MD5_cache_read(&cache, &this->optimized, sizeof(this->optimized)) &&
+              MD5_cache_read(&cache, this->bind_pose) &&
+              MD5_cache_read(&cache, &n_mesh, sizeof(n_mesh)) &&
+              n_mesh <= cache.size;
+
+    if (ok) this->md5meshdata.resize(n_mesh);
+
+    for (unsigned int i=0; ok && i!=n_mesh; ++i) {
+        MD5MESHDATA *md5meshdata = &this->md5meshdata[i];
+
+        ok = MD5_cache_read(&cache, md5meshdata->shader, sizeof(md5meshdata->shader)) &&
+             MD5_cache_read(&cache, &md5meshdata->mode, sizeof(md5meshdata->mode)) &&
+             MD5_cache_read(&cache, &md5meshdata->n_indice, sizeof(md5meshdata->n_indice)) &&
+             MD5_cache_read(&cache, md5meshdata->md5vertex) &&
+             MD5_cache_read(&cache, md5meshdata->md5triangle) &&
+             MD5_cache_read(&cache, md5meshdata->indice) &&
+             MD5_cache_read(&cache, md5meshdata->md5weight) &&
+             MD5_check_cache(md5meshdata, this->bind_pose.size());
+    }
+
+    MD5_cache_close(&cache);
+
+    for (unsigned int i=0; ok && i!=this->bind_pose.size(); ++i)
+        ok = this->bind_pose[i].parent >= -1 &&
+             this->bind_pose[i].parent < (int)i;
+
+    if (!ok || cache.position != cache.size) {
+        this->bind_pose.clear();
+
+        this->md5meshdata.clear();
+
+        return false;
+    }
+
+    for (auto md5meshdata=this->md5meshdata.begin();
+         md5meshdata!=this->md5meshdata.end(); ++md5meshdata)
+        md5meshdata->build_skin_stream();
+
+    this->build_joint_bound();
+
+    this->built = true;
+
+    return true;
+}
+
+
+// The compressed tracks.
+bool MD5ANIM::save_cache(const char *filename, const char *source) const
+{
+    FILE *f = MD5_cache_create(filename, 'A', source);
+
+    if (!f) return false;
+
+    MD5_cache_write(f, this->name, sizeof(this->name));
+    MD5_cache_write(f, &this->n_frame, sizeof(this->n_frame));
+    MD5_cache_write(f, &this->fps, sizeof(this->fps));
+    MD5_cache_write(f, &this->location_error, sizeof(this->location_error));
+    MD5_cache_write(f, &this->rotation_error, sizeof(this->rotation_error));
+    MD5_cache_write(f, this->track);
+    MD5_cache_write(f, this->location_frame);
+    MD5_cache_write(f, this->location_key);
+    MD5_cache_write(f, this->rotation_frame);
+    MD5_cache_write(f, this->rotation_key);
+
+    return MD5_cache_commit(f, filename);
+}
+
+
+bool MD5ANIM::load_cache(const char *filename, const char *source)
+{
+    MD5CACHE cache;
+
+    if (!MD5_cache_open(filename, 'A', source, &cache)) return false;
+
+    bool ok = MD5_cache_read(&cache, this->name, sizeof(this->name)) &&
+              MD5_cache_read(&cache, &this->n_frame, sizeof(this->n_frame)) &&
+              MD5_cache_read(&cache, &this->fps, sizeof(this->fps)) &&
+              MD5_cache_read(&cache, &this->location_error, sizeof(this->location_error)) &&
+              MD5_cache_read(&cache, &this->rotation_error, sizeof(this->rotation_error)) &&
+              MD5_cache_read(&cache, this->track) &&
+              MD5_cache_read(&cache, this->location_frame) &&
+              MD5_cache_read(&cache, this->location_key) &&
+              MD5_cache_read(&cache, this->rotation_frame) &&
+              MD5_cache_read(&cache, this->rotation_key) &&
+              cache.position == cache.size &&
+              this->location_key.size() == this->location_frame.size() * 3 &&
+              this->rotation_key.size() == this->rotation_frame.size() * 3;
+
+    MD5_cache_close(&cache);
+
+    for (auto md5track=this->track.begin();
+         ok && md5track!=this->track.end(); ++md5track)
+        ok = MD5_check_key(this->location_frame,
+                           md5track->location, md5track->n_location) &&
+             MD5_check_key(this->rotation_frame,
+                           md5track->rotation, md5track->n_rotation);
+
+    if (!ok) {
+        this->n_frame = 0;
+
+        this->track.clear();
+    }
+
+    return ok;
+}
+
+
+MD5::MD5(char *filename, const bool relative_path) :
+    visible(true),
+    md5model(RESOURCE::acquire_md5model(filename, relative_path)),
+    bind_pose(MD5_get_bind_pose(md5model)),
+    location(0,0,0), rotation(0,0,0), scale(1,1,1),
+    min(FLT_MAX,FLT_MAX,FLT_MAX), max(-FLT_MAX,-FLT_MAX,-FLT_MAX),
+    dimension(0,0,0), radius(0.0f), distance(1.0f), btrigidbody(NULL),
+    gpu_skin(false), n_vertex_upload(0), n_palette_upload(0), n_thread(1),
+    joint_lod(0), sampled_joint_lod(0), sampled_joint_importance(0)
+{
+    if (!this->md5model) return;
+
+    strcpy(this->name, this->md5model->name);
+
+    this->md5mesh.resize(this->md5model->md5meshdata.size());
+
+    for (unsigned int i=0; i!=this->md5mesh.size(); ++i) {
+        this->md5mesh[i].md5meshdata = &this->md5model->md5meshdata[i];
+
+        strcpy(this->md5mesh[i].shader, this->md5model->md5meshdata[i].shader);
+    }
+}
+
+
+MD5::~MD5()
+{
+    // The meshes hold GL objects, free them before the model they point to.
+    this->md5mesh.clear();
+
+    for (auto md5action=this->md5action.begin();
+         md5action!=this->md5action.end(); ++md5action)
+        RESOURCE::release_md5anim(md5action->md5anim);
+
+    if (this->md5model) RESOURCE::release_md5model(this->md5model);
+}
+
+
+// Actions of one MD5 file share the frames of every other MD5 playing it;
+// only the cursor and the pose belong to this MD5.
+int MD5::load_action(char *name, char *filename, const bool relative_path)
+{
+    MD5ANIM *md5anim = RESOURCE::acquire_md5anim(filename, relative_path);
+
+    if (!md5anim) return -1;
+
+    if (md5anim->get_joint_count() != this->bind_pose.size()) {
+        RESOURCE::release_md5anim(md5anim);
+
+        return -1;
+    }
+
+    this->md5action.push_back(MD5ACTION(name));
+
+    MD5ACTION *md5action = &this->md5action.back();
+
+    md5action->md5anim = md5anim;
+
+    md5action->fps = md5anim->fps;
+
+    md5action->pose.resize(this->bind_pose.size());
+
+    md5action->frame_pose[0].resize(this->bind_pose.size());
+
+    md5action->frame_pose[1].resize(this->bind_pose.size());
+
+    for (int i=0; i != this->bind_pose.size(); ++i)
+        strcpy(md5action->pose[i].name, this->bind_pose[i].name);
+
+    return (this->md5action.size() - 1);
+}
+
+
+// The model is shared, so only what was already uploaded goes: the index
+// list once it is in vbo_indice.  The triangles stay for the next MD5 to
+// build the model another way.
+void MD5::free_mesh_data()
+{
+    for (auto md5mesh=this->md5mesh.begin();
+         md5mesh != this->md5mesh.end(); ++md5mesh) {
+
+        MD5MESHDATA *md5meshdata = md5mesh->md5meshdata;
+
+        if (md5meshdata->vbo_indice) {
+            std::vector<unsigned short> none;
+
+            md5meshdata->indice.swap(none);
+        }
+    }
+}
+
+
+MD5ACTION *MD5::get_action(char *name, const bool exact_name)
+{
+    if (exact_name) {
+        for (int i=0; i != this->md5action.size(); ++i) {
+            if (!strcmp(this->md5action[i].name, name))
+                return &this->md5action[i];
+        }
+    } else {
+        for (int i=0; i != this->md5action.size(); ++i) {
+            if (strstr(this->md5action[i].name, name))
+                return &this->md5action[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+MD5MESH *MD5::get_mesh(char *name, const bool exact_name)
+{
+    if (exact_name) {
+        for (auto md5mesh=this->md5mesh.begin();
+             md5mesh != this->md5mesh.end(); ++md5mesh) {
+            if (!strcmp(md5mesh->shader, name))
+                return &(*md5mesh);
+        }
+    } else {
+        for (auto md5mesh=this->md5mesh.begin();
+             md5mesh != this->md5mesh.end(); ++md5mesh) {
+            if (strstr(md5mesh->shader, name))
+                return &(*md5mesh);
+        }
+    }
+
+    return NULL;
+}
+
+
+// Rank a joint of the model, for every instance sharing it.  Returns
+// false if the skeleton has no such joint.  The instances read the ranks
+// in draw_action(), so only call it while none of them is in an
+// MD5ANIMATOR frame, see MD5ANIMATOR::finish().
+bool MD5::set_joint_importance(char *name, unsigned char importance)
+{
+    std::vector<unsigned char> &joint_importance = this->md5model->joint_importance;
+
+    // The .md5mesh names keep their quotes, accept the name with or
+    // without them.
+    char quoted[MAX_CHAR] = {""};
+
+    snprintf(quoted, sizeof(quoted), "\"%s\"", name);
+
+    for (unsigned int i=0; i!=this->bind_pose.size(); ++i) {
+        if (!strcmp(this->bind_pose[i].name, name) ||
+            !strcmp(this->bind_pose[i].name, quoted)) {
+            joint_importance.resize(this->bind_pose.size(), 255);
+
+            joint_importance[i] = importance;
+
+            // Every instance splits its joints again on its next
+            // draw_action().
+            ++this->md5model->joint_importance_serial;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// Split the joints between the ones sampled at joint_lod and the ones
+// attached to their parent.  The frames already decoded may miss joints
+// that are sampled now, so they are decoded again.
+void MD5::update_joint_lod()
+{
+    const std::vector<unsigned char> &joint_importance = this->md5model->joint_importance;
+
+    this->sampled_joint.clear();
+
+    this->attached_joint.clear();
+
+    for (unsigned int i=0; i!=this->bind_pose.size(); ++i) {
+        if (!joint_importance.empty() &&
+            joint_importance[i] < this->joint_lod &&
+            this->bind_pose[i].parent != -1)
+            this->attached_joint.push_back(i);
+        else
+            this->sampled_joint.push_back(i);
+    }
+
+    for (auto md5action = this->md5action.begin();
+         md5action != this->md5action.end(); ++md5action) {
+        md5action->decoded_frame[0] =
+        md5action->decoded_frame[1] = -1;
+    }
+
+    this->sampled_joint_lod = this->joint_lod;
+
+    this->sampled_joint_importance = this->md5model->joint_importance_serial;
+}
+
+
+// Move the joints that were not sampled along with their parent, keeping
+// the offset they have in the bind pose.  Parents come first, so chains
+// of attached joints follow each other.
+void MD5::attach_joints(std::vector<MD5JOINT> &pose) const
+{
+    for (auto i=this->attached_joint.begin(); i!=this->attached_joint.end(); ++i) {
+        const MD5JOINT &bind_joint  = this->bind_pose[*i],
+                       &bind_parent = this->bind_pose[bind_joint.parent];
+
+        const MD5JOINT &parent = pose[bind_joint.parent];
+
+        // From the bind pose of the parent to its current pose.
+        quaternion delta = parent.rotation * bind_parent.rotation.conjugate();
+
+        vec3 offset;
+
+        vec3_rotate_quat(offset, bind_joint.location - bind_parent.location, delta);
+
+        pose[*i].location = parent.location + offset;
+
+        pose[*i].rotation = delta * bind_joint.rotation;
+    }
+}
+
+
+MD5ACTION::MD5ACTION(const char *name) : md5anim(NULL),
+                                         curr_frame(0), next_frame(1),
+                                         state(STOP), method(MD5_METHOD_FRAME),
+                                         loop(false), frame_time(0), fps(0)
+{
+    assert(name==NULL || strlen(name)<sizeof(this->name));
+    strcpy(this->name, name ? name : "");
+
+    this->decoded_frame[0] =
+    this->decoded_frame[1] = -1;
+}
+
+void MD5ACTION::action_play(const MD5Method frame_interpolation_method,
+                            const bool loop)
+{
+    this->method = frame_interpolation_method;
+    this->loop   = loop;
+    this->state  = PLAY;
+
+    if (!this->frame_time && frame_interpolation_method == MD5_METHOD_FRAME) {
+        this->frame_time =
+        this->fps;
+    }
+}
+
+
+void MD5ACTION::action_pause()
+{
+    this->state = PAUSE;
+}
+
+
+void MD5ACTION::action_stop()
+{
+    this->curr_frame = 0;
+    this->next_frame = 1;
+    this->state = STOP;
+    this->frame_time = 0.0f;
+}
+
+
+void MD5ACTION::set_action_fps(float fps)
+{
+    this->fps = 1.0f / fps;
+}
+
+
+// Decode curr_frame and next_frame of md5anim into frame_pose, reusing
+// what is already there: once the action moves on, the old next frame
+// is the new current one.  With joint, only those joints are decoded.
+void MD5ACTION::decode_frame(const std::vector<unsigned int> *joint)
+{
+    if (this->decoded_frame[0] != this->curr_frame &&
+        this->decoded_frame[1] == this->curr_frame) {
+        this->frame_pose[0].swap(this->frame_pose[1]);
+
+        std::swap(this->decoded_frame[0], this->decoded_frame[1]);
+    }
+
+    if (this->decoded_frame[0] != this->curr_frame) {
+        this->md5anim->get_pose(this->curr_frame, this->frame_pose[0], joint);
+
+        this->decoded_frame[0] = this->curr_frame;
+    }
+
+    if (this->decoded_frame[1] != this->next_frame) {
+        this->md5anim->get_pose(this->next_frame, this->frame_pose[1], joint);
+
+        this->decoded_frame[1] = this->next_frame;
+    }
+}
+
+MD5MESH::MD5MESH(const char *name) :
+    md5meshdata(NULL), vbo(0), size(0), stride(0), vertex_data(NULL),
+    vertex_data_back(NULL), vao(0), visible(true), objmaterial(NULL), gpu_skin(false),
+    morph_first(1), morph_last(0), vbo_morph(0)
+{
+    assert(name==NULL || strlen(name)<sizeof(shader));
+    strcpy(shader, name ? name : "");
+}
+
+MD5MESH::MD5MESH(const MD5MESH &src) :
+    md5meshdata(src.md5meshdata), vbo(src.vbo), size(src.size),
+    stride(src.stride), vertex_data_back(NULL), vao(src.vao),
+    visible(src.visible), objmaterial(src.objmaterial),
+    gpu_skin(src.gpu_skin), morph_weight(src.morph_weight),
+    morph_first(1), morph_last(0), vbo_morph(0)
+{
+    strcpy(shader, src.shader);
+
+    vertex_data = (unsigned char *) calloc(1, size);
+    memcpy(vertex_data, src.vertex_data, size);
+
+    memcpy(offset, src.offset, sizeof(offset));
+}
+
+void MD5MESH::set_mesh_attributes()
+{
+    if (this->gpu_skin) {
+        glBindBuffer(GL_ARRAY_BUFFER, this->md5meshdata->vbo_skin);
+
+        glEnableVertexAttribArray(VA_Position);
+
+        glVertexAttribPointer(VA_Position,
+                              3,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, position)));
+
+        glEnableVertexAttribArray(VA_Normal);
+
+        glVertexAttribPointer(VA_Normal,
+                              3,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, normal)));
+
+        glEnableVertexAttribArray(VA_TexCoord0);
+
+        glVertexAttribPointer(VA_TexCoord0,
+                              2,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, uv)));
+
+        glEnableVertexAttribArray(VA_Tangent0);
+
+        glVertexAttribPointer(VA_Tangent0,
+                              3,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, tangent)));
+
+        glEnableVertexAttribArray(VA_Joint);
+
+        glVertexAttribPointer(VA_Joint,
+                              MD5_MAX_INFLUENCE,
+                              GL_UNSIGNED_BYTE,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, joint)));
+
+        glEnableVertexAttribArray(VA_Weight);
+
+        glVertexAttribPointer(VA_Weight,
+                              MD5_MAX_INFLUENCE,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              this->stride,
+                              BUFFER_OFFSET(offsetof(MD5SKINVERTEX, weight)));
+
+        if (this->vbo_morph) {
+            glBindBuffer(GL_ARRAY_BUFFER, this->vbo_morph);
+
+            glEnableVertexAttribArray(VA_Morph);
+
+            glVertexAttribPointer(VA_Morph,
+                                  4,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  4 * sizeof(float),
+                                  (void *)NULL);
+        } else {
+            glDisableVertexAttribArray(VA_Morph);
+
+            glVertexAttrib4f(VA_Morph, 0.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->md5meshdata->vbo_skin_indice);
+
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(0,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          0,
+                          (void *)NULL);
+
+
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(1,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          0,
+                          BUFFER_OFFSET(this->offset[1]));
+
+
+    glEnableVertexAttribArray(2);
+
+    glVertexAttribPointer(2,
+                          2,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          0,
+                          BUFFER_OFFSET(this->offset[2]));
+
+
+    glEnableVertexAttribArray(3);
+
+    glVertexAttribPointer(3,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          0,
+                          BUFFER_OFFSET(this->offset[3]));
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->md5meshdata->vbo_indice);
+}
+
+
+void MD5MESH::set_mesh_visibility(const bool visible)
+{
+    this->visible = visible;
+}
+
+
+void MD5MESH::set_mesh_material(OBJMATERIAL *objmaterial)
+{
+    this->objmaterial = objmaterial;
+}
+
+
+void MD5::optimize(unsigned int vertex_cache_size)
+{
+    unsigned int s;
+
+    unsigned short n_group = 0;
+
+    if (!this->md5model || this->md5model->optimized) return;
+
+    this->md5model->optimized = true;
+
+    if (vertex_cache_size) SetCacheSize(vertex_cache_size);
+
+    for (auto md5mesh=this->md5model->md5meshdata.begin();
+         md5mesh != this->md5model->md5meshdata.end(); ++md5mesh) {
+
+        PrimitiveGroup *primitivegroup;
+
+        if (GenerateStrips((unsigned short *)&md5mesh->md5triangle[0],
+                           md5mesh->n_indice,
+                           &primitivegroup,
+                           &n_group,
+                           true)) {
+            if (primitivegroup[0].numIndices < md5mesh->n_indice) {
+                md5mesh->mode = GL_TRIANGLE_STRIP;
+                md5mesh->n_indice = primitivegroup[0].numIndices;
+
+                s = primitivegroup[0].numIndices * sizeof(unsigned short);
+
+                md5mesh->indice.resize(primitivegroup[0].numIndices);
+
+                memcpy(&md5mesh->indice[0],
+                       &primitivegroup[0].indices[0],
+                       s);
+            }
+            
+            delete[] primitivegroup;
+        }
+    }
+}
+
+
+// Allocate the CPU side vertex arrays skin() writes to.
+void MD5MESH::init_vertex_data()
+{
+    const std::vector<MD5VERTEX> &md5vertex = this->md5meshdata->md5vertex;
+
+    this->size = md5vertex.size() * (sizeof(vec3) +  // Vertex
+                                     sizeof(vec3) +  // Normals
+                                     sizeof(vec2) +  // Texcoord0
+                                     sizeof(vec3));  // Tangent0
+
+    if (this->vertex_data) free(this->vertex_data);
+
+    if (this->vertex_data_back) free(this->vertex_data_back);
+
+    this->vertex_data_back = NULL;
+
+    this->vertex_data = (unsigned char *) calloc(1, this->size);
+
+    this->offset[0] = 0;
+
+    this->offset[1] = md5vertex.size() * sizeof(vec3);
+
+    this->offset[2] = this->offset[1] + (md5vertex.size() * sizeof(vec3));
+
+    this->offset[3] = this->offset[2] + (md5vertex.size() * sizeof(vec2));
+
+    // The UVs never change, and the SIMD path only rewrites positions,
+    // normals and tangents.
+    vec2 *uv_array = (vec2 *)&this->vertex_data[this->offset[2]];
+
+    for (unsigned int j=0; j!=md5vertex.size(); ++j)
+        uv_array[j] = md5vertex[j].uv;
+}
+
+
+// Skin the vertices into vertex_data on the CPU.
+void MD5MESH::skin(const std::vector<MD5JOINT> &pose)
+{
+    vec3    *vertex_array  = (vec3 *)this->vertex_data,
+            *normal_array  = (vec3 *)&this->vertex_data[this->offset[1]],
+            *tangent_array = (vec3 *)&this->vertex_data[this->offset[3]];
+
+    vec2    *uv_array      = (vec2 *)&this->vertex_data[this->offset[2]];
+
+    memset(vertex_array,  0, this->offset[1]);
+    memset(normal_array,  0, this->offset[1]);
+    memset(tangent_array, 0, this->offset[1]);
+
+    const MD5MESHDATA *md5meshdata = this->md5meshdata;
+
+    for (int j=0; j != md5meshdata->md5vertex.size(); ++j) {
+        const MD5VERTEX *md5vertex = &md5meshdata->md5vertex[j];
+
+        for (int k=0; k != md5vertex->count; ++k) {
+            vec3    location(0.0f, 0.0f, 0.0f),
+                    normal  (0.0f, 0.0f, 0.0f),
+                    tangent (0.0f, 0.0f, 0.0f);
+
+
+            const MD5WEIGHT *md5weight = &md5meshdata->md5weight[md5vertex->start + k];
+
+            const MD5JOINT *md5joint = &pose[md5weight->joint];
+
+            vec3_rotate_quat(location,
+                             md5weight->location,
+                             md5joint->rotation);
+
+            vec3_rotate_quat(normal,
+                             md5weight->normal,
+                             md5joint->rotation);
+
+            vec3_rotate_quat(tangent,
+                             md5weight->tangent,
+                             md5joint->rotation);
+
+            vertex_array[j] += (md5joint->location + location) * md5weight->bias;
+
+            normal_array[j] += normal * md5weight->bias;
+
+            tangent_array[j] += tangent * md5weight->bias;
+        }
+
+        uv_array[j] = md5vertex->uv;
+    }
+}
+
+
+void MD5MESH::build_vbo()
+{
+    this->init_vertex_data();
+
+    glGenBuffers(1, &this->vbo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+
+    glBufferData(GL_ARRAY_BUFFER,
+                 this->size,
+                 this->vertex_data,
+                 GL_DYNAMIC_DRAW);
+
+    MD5MESHDATA *md5meshdata = this->md5meshdata;
+
+    // The first MD5 of the model uploads the indices for all of them.
+    if (md5meshdata->vbo_indice) return;
+
+    glGenBuffers(1, &md5meshdata->vbo_indice);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, md5meshdata->vbo_indice);
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 md5meshdata->n_indice * sizeof(unsigned short),
+                 &md5meshdata->indice[0],
+                 GL_STATIC_DRAW);
+}
+
+// Bake the bind pose held in vertex_data, with the MD5_MAX_INFLUENCE
+// heaviest weights of every vertex, into a static VBO for GPU skinning.
+// The triangles are grouped greedily into batches of at most
+// MD5_MAX_PALETTE joints; vertices shared by two batches are duplicated.
+// The buffers belong to the model, the first MD5 to get here builds them.
+// Returns false, leaving the mesh as it was, if the batches need more than
+// the 65536 vertices unsigned short indices reach; build a CPU VBO then.
+bool MD5MESH::build_skin_vbo()
+{
+    MD5MESHDATA *md5meshdata = this->md5meshdata;
+
+    if (md5meshdata->cpu_skin) return false;
+
+    // Another MD5 of the model already did it.
+    if (md5meshdata->vbo_skin) {
+        this->stride   = sizeof(MD5SKINVERTEX);
+        this->gpu_skin = true;
+
+        return true;
+    }
+
+    assert(!md5meshdata->md5triangle.empty());
+
+    const vec3  *vertex_array  = (vec3 *)this->vertex_data,
+                *normal_array  = (vec3 *)&this->vertex_data[this->offset[1]],
+                *tangent_array = (vec3 *)&this->vertex_data[this->offset[3]];
+
+    const vec2  *uv_array      = (vec2 *)&this->vertex_data[this->offset[2]];
+
+    unsigned int n_joint = 0;
+
+    for (auto md5weight=md5meshdata->md5weight.begin();
+         md5weight!=md5meshdata->md5weight.end(); ++md5weight) {
+        if (md5weight->joint >= (int)n_joint) n_joint = md5weight->joint + 1;
+    }
+
+    // Heaviest influences of every vertex, biases renormalized.
+    std::vector<unsigned short> influence_joint(md5meshdata->md5vertex.size() * MD5_MAX_INFLUENCE, 0);
+
+    std::vector<float> influence_weight(md5meshdata->md5vertex.size() * MD5_MAX_INFLUENCE, 0.0f);
+
+    for (unsigned int i=0; i!=md5meshdata->md5vertex.size(); ++i) {
+        unsigned short  *joint  = &influence_joint [i * MD5_MAX_INFLUENCE];
+        float           *weight = &influence_weight[i * MD5_MAX_INFLUENCE];
+
+        float total = 0.0f;
+
+        for (unsigned int j=0; j!=md5meshdata->md5vertex[i].count; ++j) {
+            const MD5WEIGHT &md5weight = md5meshdata->md5weight[md5meshdata->md5vertex[i].start + j];
+
+            // Insertion into the sorted list of the heaviest ones.
+            int k = MD5_MAX_INFLUENCE - 1;
+
+            if (md5weight.bias <= weight[k]) continue;
+
+            while (k && weight[k - 1] < md5weight.bias) {
+                weight[k] = weight[k - 1];
+                joint [k] = joint [k - 1];
+                --k;
+            }
+
+            weight[k] = md5weight.bias;
+            joint [k] = md5weight.joint;
+        }
+
+        for (int k=0; k!=MD5_MAX_INFLUENCE; ++k) total += weight[k];
+
+        if (total > 0.0f) {
+            for (int k=0; k!=MD5_MAX_INFLUENCE; ++k) weight[k] /= total;
+        }
+    }
+
+    std::vector<MD5SKINVERTEX> skinvertex;
+
+    std::vector<unsigned short> skinindice;
+
+    std::vector<int> slot(n_joint, -1),
+                     local(md5meshdata->md5vertex.size(), -1);
+
+    std::vector<unsigned int> touched,
+                              source;
+
+    md5meshdata->md5skinbatch.clear();
+
+    for (unsigned int i=0; i!=md5meshdata->md5triangle.size(); ++i) {
+        const unsigned short *indice = md5meshdata->md5triangle[i].indice;
+
+        unsigned int n_new = 0;
+
+        unsigned short new_joint[ 3 * MD5_MAX_INFLUENCE ];
+
+        for (int j=0; j!=3; ++j) {
+            for (int k=0; k!=MD5_MAX_INFLUENCE; ++k) {
+                unsigned int offset = indice[j] * MD5_MAX_INFLUENCE + k;
+
+                unsigned short joint = influence_joint[offset];
+
+                if (influence_weight[offset] == 0.0f || slot[joint] != -1) continue;
+
+                unsigned int l = 0;
+
+                while (l != n_new && new_joint[l] != joint) ++l;
+
+                if (l == n_new) new_joint[n_new++] = joint;
+            }
+        }
+
+        if (md5meshdata->md5skinbatch.empty() ||
+            md5meshdata->md5skinbatch.back().joint.size() + n_new > MD5_MAX_PALETTE) {
+            // Start a new batch; forget the palette and vertices of the
+            // previous one.
+            if (!md5meshdata->md5skinbatch.empty()) {
+                const std::vector<unsigned short> &joint = md5meshdata->md5skinbatch.back().joint;
+
+                for (unsigned int j=0; j!=joint.size(); ++j) slot[joint[j]] = -1;
+
+                for (unsigned int j=0; j!=touched.size(); ++j) local[touched[j]] = -1;
+
+                touched.clear();
+
+                // Every joint of this triangle is new to the batch.
+                n_new = 0;
+
+                for (int j=0; j!=3; ++j) {
+                    for (int k=0; k!=MD5_MAX_INFLUENCE; ++k) {
+                        unsigned int offset = indice[j] * MD5_MAX_INFLUENCE + k;
+
+                        unsigned short joint = influence_joint[offset];
+
+                        if (influence_weight[offset] == 0.0f) continue;
+
+                        unsigned int l = 0;
+
+                        while (l != n_new && new_joint[l] != joint) ++l;
+
+                        if (l == n_new) new_joint[n_new++] = joint;
+                    }
+                }
+            }
+
+            MD5SKINBATCH md5skinbatch;
+
+            md5skinbatch.first = skinindice.size();
+            md5skinbatch.count = 0;
+
+            md5meshdata->md5skinbatch.push_back(md5skinbatch);
+        }
+
+        MD5SKINBATCH &md5skinbatch = md5meshdata->md5skinbatch.back();
+
+        assert(md5skinbatch.joint.size() + n_new <= MD5_MAX_PALETTE);
+
+        for (unsigned int j=0; j!=n_new; ++j) {
+            slot[new_joint[j]] = md5skinbatch.joint.size();
+
+            md5skinbatch.joint.push_back(new_joint[j]);
+        }
+
+        for (int j=0; j!=3; ++j) {
+            unsigned int v = indice[j];
+
+            if (local[v] == -1) {
+                MD5SKINVERTEX vertex;
+
+                for (int k=0; k!=3; ++k) {
+                    vertex.position[k] = vertex_array [v][k];
+                    vertex.normal  [k] = normal_array [v][k];
+                    vertex.tangent [k] = tangent_array[v][k];
+                }
+
+                vertex.uv[0] = uv_array[v][0];
+                vertex.uv[1] = uv_array[v][1];
+
+                for (int k=0; k!=MD5_MAX_INFLUENCE; ++k) {
+                    unsigned int offset = v * MD5_MAX_INFLUENCE + k;
+
+                    vertex.weight[k] = influence_weight[offset];
+
+                    vertex.joint[k] = vertex.weight[k] == 0.0f ?
+                                      0 : slot[influence_joint[offset]];
+                }
+
+                if (skinvertex.size() == 65536) {
+                    md5meshdata->md5skinbatch.clear();
+
+                    md5meshdata->cpu_skin = true;
+
+                    return false;
+                }
+
+                local[v] = skinvertex.size();
+
+                touched.push_back(v);
+
+                source.push_back(v);
+
+                skinvertex.push_back(vertex);
+            }
+
+            skinindice.push_back(local[v]);
+        }
+
+        md5skinbatch.count += 3;
+    }
+
+    // Where each vertex ended up, for the morph targets.
+    md5meshdata->skin_vertex_start.assign(md5meshdata->md5vertex.size() + 1, 0);
+
+    md5meshdata->skin_vertex.resize(source.size());
+
+    for (unsigned int i=0; i!=source.size(); ++i)
+        ++md5meshdata->skin_vertex_start[source[i] + 1];
+
+    for (unsigned int i=0; i!=md5meshdata->md5vertex.size(); ++i)
+        md5meshdata->skin_vertex_start[i + 1] += md5meshdata->skin_vertex_start[i];
+
+    local.assign(md5meshdata->md5vertex.size(), 0);
+
+    for (unsigned int i=0; i!=source.size(); ++i) {
+        md5meshdata->skin_vertex[md5meshdata->skin_vertex_start[source[i]] + local[source[i]]] = i;
+
+        ++local[source[i]];
+    }
+
+    glGenBuffers(1, &md5meshdata->vbo_skin);
+
+    glBindBuffer(GL_ARRAY_BUFFER, md5meshdata->vbo_skin);
+
+    glBufferData(GL_ARRAY_BUFFER,
+                 skinvertex.size() * sizeof(MD5SKINVERTEX),
+                 &skinvertex[0],
+                 GL_STATIC_DRAW);
+
+
+    glGenBuffers(1, &md5meshdata->vbo_skin_indice);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, md5meshdata->vbo_skin_indice);
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 skinindice.size() * sizeof(unsigned short),
+                 &skinindice[0],
+                 GL_STATIC_DRAW);
+
+    this->stride   = sizeof(MD5SKINVERTEX);
+    this->gpu_skin = true;
+
+    return true;
+}
+
+
+// Sort the weights by vertex weight count into the 4-wide streams used by
+// the CPU path of MD5::set_pose().  Needs the weight normals and tangents,
+// so call it after MD5::build_bind_pose_weighted_normals_tangents().
+void MD5MESHDATA::build_skin_stream()
+{
+    unsigned int max_weight = 0;
+
+    for (auto md5vertex=this->md5vertex.begin();
+         md5vertex!=this->md5vertex.end(); ++md5vertex) {
+        if (md5vertex->count > max_weight) max_weight = md5vertex->count;
+    }
+
+    this->md5skinstream.clear();
+
+    for (unsigned int n=1; n<=max_weight; ++n) {
+        MD5SKINSTREAM md5skinstream;
+
+        md5skinstream.n_weight = n;
+
+        for (unsigned int i=0; i!=this->md5vertex.size(); ++i) {
+            if (this->md5vertex[i].count == n) md5skinstream.vertex.push_back(i);
+        }
+
+        if (md5skinstream.vertex.empty()) continue;
+
+        while (md5skinstream.vertex.size() % 4)
+            md5skinstream.vertex.push_back(md5skinstream.vertex.back());
+
+        md5skinstream.joint.resize(md5skinstream.vertex.size() * n);
+
+        md5skinstream.weight.resize(md5skinstream.vertex.size() * n * 10);
+
+        for (unsigned int i=0; i!=md5skinstream.vertex.size(); ++i) {
+            const MD5VERTEX &md5vertex = this->md5vertex[md5skinstream.vertex[i]];
+
+            unsigned int block = i / 4,
+                         lane  = i % 4;
+
+            for (unsigned int j=0; j!=n; ++j) {
+                const MD5WEIGHT &md5weight = this->md5weight[md5vertex.start + j];
+
+                md5skinstream.joint[(block * n + j) * 4 + lane] = md5weight.joint;
+
+                float *weight = &md5skinstream.weight[(block * n + j) * 40 + lane];
+
+                weight[0] = md5weight.bias;
+
+                for (int k=0; k!=3; ++k) {
+                    weight[(1 + k) * 4] = md5weight.location[k];
+                    weight[(4 + k) * 4] = md5weight.normal[k];
+                    weight[(7 + k) * 4] = md5weight.tangent[k];
+                }
+            }
+        }
+
+        this->md5skinstream.push_back(md5skinstream);
+    }
+}
+
+
+void MD5MESH::build_vao()
+{
+    glGenVertexArraysOES(1, &this->vao);
+
+    glBindVertexArrayOES(this->vao);
+
+    this->set_mesh_attributes();
+
+    glBindVertexArrayOES(0);
+}
+
+
+// Add a target to the mesh, for every MD5 sharing it; a target of the
+// same name already there is kept.  Returns its index.  The MD5s of the
+// model read the targets while they are posed, so only add them while
+// none of them is in an MD5ANIMATOR frame, see MD5ANIMATOR::finish().
+int MD5MESHDATA::add_morph_target(const char *name, const std::vector<MD5MORPHDELTA> &md5morphdelta)
+{
+    int target = this->get_morph_target(name);
+
+    if (target != -1) return target;
+
+    std::vector<MD5MORPHTARGET> &md5morphtarget = this->md5morphtarget;
+
+    md5morphtarget.resize(md5morphtarget.size() + 1);
+
+    assert(strlen(name) < sizeof(md5morphtarget.back().name));
+
+    strcpy(md5morphtarget.back().name, name);
+
+    md5morphtarget.back().md5morphdelta = md5morphdelta;
+
+    for (auto md5morphdelta=md5morphtarget.back().md5morphdelta.begin();
+         md5morphdelta!=md5morphtarget.back().md5morphdelta.end(); ++md5morphdelta) {
+        assert(md5morphdelta->vertex < this->md5vertex.size());
+
+        md5morphdelta->location[3] =
+        md5morphdelta->normal  [3] = 0.0f;
+
+        md5morphtarget.back().extent = std::max(md5morphtarget.back().extent,
+                                                sqrtf(md5morphdelta->location[0] * md5morphdelta->location[0] +
+                                                      md5morphdelta->location[1] * md5morphdelta->location[1] +
+                                                      md5morphdelta->location[2] * md5morphdelta->location[2]));
+    }
+
+    return md5morphtarget.size() - 1;
+}
+
+
+int MD5MESHDATA::get_morph_target(const char *name) const
+{
+    for (unsigned int i=0; i!=this->md5morphtarget.size(); ++i) {
+        if (!strcmp(this->md5morphtarget[i].name, name)) return i;
+    }
+
+    return -1;
+}
+
+
+void MD5MESH::set_morph_weight(int target, float weight)
+{
+    assert(target >= 0 && target < (int)this->md5meshdata->md5morphtarget.size());
+
+    if ((int)this->morph_weight.size() <= target)
+        this->morph_weight.resize(target + 1, 0.0f);
+
+    this->morph_weight[target] = weight;
+}
+
+
+// The normal delta of a morph target as the w of VA_Morph: each component,
+// from -2 to 2, rounded to a signed byte in steps of 1 / 63.5, the three
+// bytes making a 24 bit integer that a float holds exactly.  A delta of 0
+// packs to 0.
+static float MD5_pack_morph_normal(const float *normal)
+{
+    unsigned int packed = 0;
+
+    for (int i=0; i!=3; ++i) {
+        int b = (int)floorf(CLAMP(normal[i], -2.0f, 2.0f) * 63.5f + 0.5f);
+
+        packed = (packed << 8) | (b & 0xFF);
+    }
+
+    return (float)packed;
+}
+
+
+// Sum the targets weighted in into morph_delta, after clearing the
+// vertices of the previous sum, and on the GPU path into morph_stream for
+// every skin vertex they were copied to.  Only the vertices the targets
+// move are touched.
+void MD5MESH::update_morph()
+{
+    const MD5MESHDATA *md5meshdata = this->md5meshdata;
+
+    if (md5meshdata->md5morphtarget.empty()) return;
+
+    if (this->morph_flag.empty()) {
+        this->morph_delta.assign(md5meshdata->md5vertex.size() * 8, 0.0f);
+
+        this->morph_flag.assign(md5meshdata->md5vertex.size(), 0);
+    }
+
+    bool gpu = this->gpu_skin && !md5meshdata->skin_vertex.empty();
+
+    if (gpu && this->morph_stream.empty())
+        this->morph_stream.assign(md5meshdata->skin_vertex.size() * 4, 0.0f);
+
+    for (auto v=this->morph_vertex.begin(); v!=this->morph_vertex.end(); ++v) {
+        memset(&this->morph_delta[*v * 8], 0, 8 * sizeof(float));
+
+        this->morph_flag[*v] = 0;
+    }
+
+    // The skin vertices of the previous sum are cleared by the loop over
+    // the new one when moved again, here when not.
+    std::vector<unsigned int> previous;
+
+    if (gpu) previous.swap(this->morph_vertex);
+
+    this->morph_vertex.clear();
+
+    for (unsigned int i=0; i!=this->morph_weight.size(); ++i) {
+        if (this->morph_weight[i] == 0.0f) continue;
+
+        const std::vector<MD5MORPHDELTA> &md5morphdelta = md5meshdata->md5morphtarget[i].md5morphdelta;
+
+        SIMDFLOAT4 weight = simd_splat(this->morph_weight[i]);
+
+        for (auto d=md5morphdelta.begin(); d!=md5morphdelta.end(); ++d) {
+            float *delta = &this->morph_delta[d->vertex * 8];
+
+            if (!this->morph_flag[d->vertex]) {
+                this->morph_flag[d->vertex] = 1;
+
+                this->morph_vertex.push_back(d->vertex);
+            }
+
+            simd_store(delta,     simd_madd(weight, simd_load(d->location), simd_load(delta)));
+            simd_store(delta + 4, simd_madd(weight, simd_load(d->normal),   simd_load(delta + 4)));
+        }
+    }
 
-    unsigned short n_group = 0;
+    if (!gpu) return;
 
-    if (vertex_cache_size) SetCacheSize(vertex_cache_size);
+    for (int pass=0; pass!=2; ++pass) {
+        const std::vector<unsigned int> &vertex = pass ? this->morph_vertex : previous;
 
-    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        for (auto v=vertex.begin(); v!=vertex.end(); ++v) {
+            // A vertex of the previous sum moved again is written by the
+            // second pass.
+            if (!pass && this->morph_flag[*v]) continue;
 
-        PrimitiveGroup *primitivegroup;
+            const float *delta = &this->morph_delta[*v * 8];
 
-        if (GenerateStrips((unsigned short *)&md5mesh->md5triangle[0],
-                           md5mesh->n_indice,
-                           &primitivegroup,
-                           &n_group,
-                           true)) {
-            if (primitivegroup[0].numIndices < md5mesh->n_indice) {
-                md5mesh->mode = GL_TRIANGLE_STRIP;
-                md5mesh->n_indice = primitivegroup[0].numIndices;
+            float normal = MD5_pack_morph_normal(delta + 4);
 
-                s = primitivegroup[0].numIndices * sizeof(unsigned short);
+            for (unsigned int i=md5meshdata->skin_vertex_start[*v];
+                 i!=md5meshdata->skin_vertex_start[*v + 1]; ++i) {
+                unsigned int skin_vertex = md5meshdata->skin_vertex[i];
 
-                md5mesh->indice.resize(primitivegroup[0].numIndices);
+                float *stream = &this->morph_stream[skin_vertex * 4];
 
-                memcpy(&md5mesh->indice[0],
-                       &primitivegroup[0].indices[0],
-                       s);
+                stream[0] = delta[0]; stream[1] = delta[1]; stream[2] = delta[2];
+                stream[3] = normal;
+
+                if (this->morph_first > this->morph_last) {
+                    this->morph_first =
+                    this->morph_last  = skin_vertex;
+                } else {
+                    this->morph_first = std::min(this->morph_first, skin_vertex);
+                    this->morph_last  = std::max(this->morph_last,  skin_vertex);
+                }
             }
-            
-            delete[] primitivegroup;
         }
     }
 }
 
 
-void MD5MESH::build_vbo()
+// CPU path: add the summed deltas to the skinned vertices, through the
+// rotations of the palette blended by the biases of each vertex.
+void MD5MESH::apply_morph(const std::vector<vec4> &palette)
 {
-    this->size = this->md5vertex.size() * (sizeof(vec3) +  // Vertex
-                                           sizeof(vec3) +  // Normals
-                                           sizeof(vec2) +  // Texcoord0
-                                           sizeof(vec3));  // Tangent0
+    const MD5MESHDATA *md5meshdata = this->md5meshdata;
 
-    this->vertex_data = (unsigned char *) calloc(1, this->size);
+    vec3    *vertex_array = (vec3 *)this->vertex_data,
+            *normal_array = (vec3 *)&this->vertex_data[this->offset[1]];
 
-    this->offset[0] = 0;
+    for (auto v=this->morph_vertex.begin(); v!=this->morph_vertex.end(); ++v) {
+        const MD5VERTEX *md5vertex = &md5meshdata->md5vertex[*v];
 
-    this->offset[1] = this->md5vertex.size() * sizeof(vec3);
+        SIMDFLOAT4 row[3] = { simd_splat(0.0f), simd_splat(0.0f), simd_splat(0.0f) };
 
-    this->offset[2] = this->offset[1] + (this->md5vertex.size() * sizeof(vec3));
+        for (unsigned int k=0; k!=md5vertex->count; ++k) {
+            const MD5WEIGHT *md5weight = &md5meshdata->md5weight[md5vertex->start + k];
 
-    this->offset[3] = this->offset[2] + (this->md5vertex.size() * sizeof(vec2));
+            SIMDFLOAT4 bias = simd_splat(md5weight->bias);
 
+            for (int r=0; r!=3; ++r)
+                row[r] = simd_madd(bias, simd_load(palette[md5weight->joint * 3 + r].v()), row[r]);
+        }
 
-    glGenBuffers(1, &this->vbo);
+        float m[3][4];
 
-    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+        for (int r=0; r!=3; ++r) simd_store(m[r], row[r]);
 
-    glBufferData(GL_ARRAY_BUFFER,
-                 this->size,
-                 this->vertex_data,
-                 GL_DYNAMIC_DRAW);
+        const float *delta = &this->morph_delta[*v * 8];
 
+        for (int r=0; r!=3; ++r) {
+            vertex_array[*v][r] += m[r][0] * delta[0] + m[r][1] * delta[1] + m[r][2] * delta[2];
+            normal_array[*v][r] += m[r][0] * delta[4] + m[r][1] * delta[5] + m[r][2] * delta[6];
+        }
+    }
+}
 
-    glGenBuffers(1, &this->vbo_indice);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbo_indice);
+// GPU path: send the part of morph_stream that changed, creating vbo_morph
+// and adding it to the vertex array the first time.  Returns the bytes
+// sent.
+unsigned int MD5MESH::upload_morph()
+{
+    if (this->morph_first > this->morph_last) return 0;
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 this->n_indice * sizeof(unsigned short),
-                 &this->indice[0],
-                 GL_STATIC_DRAW);
-}
+    unsigned int size = (this->morph_last - this->morph_first + 1) * 4 * sizeof(float);
 
-void MD5MESH::build_vao()
-{
-    glGenVertexArraysOES(1, &this->vao);
+    if (!this->vbo_morph) {
+        glGenBuffers(1, &this->vbo_morph);
 
-    glBindVertexArrayOES(this->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, this->vbo_morph);
 
-    this->set_mesh_attributes();
+        size = this->morph_stream.size() * sizeof(float);
 
-    glBindVertexArrayOES(0);
+        glBufferData(GL_ARRAY_BUFFER,
+                     size,
+                     &this->morph_stream[0],
+                     GL_DYNAMIC_DRAW);
+
+        if (this->vao) {
+            glBindVertexArrayOES(this->vao);
+
+            this->set_mesh_attributes();
+
+            glBindVertexArrayOES(0);
+        }
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, this->vbo_morph);
+
+        glBufferSubData(GL_ARRAY_BUFFER,
+                        this->morph_first * 4 * sizeof(float),
+                        size,
+                        &this->morph_stream[this->morph_first * 4]);
+    }
+
+    this->morph_first = 1;
+    this->morph_last  = 0;
+
+    return size;
 }
 
 void MD5::build_bind_pose_weighted_normals_tangents()
@@ -572,14 +2431,14 @@ void MD5::build_bind_pose_weighted_normals_tangents()
 
         vec3 *vertex_array = (vec3 *)md5mesh->vertex_data;
 
-        for (auto md5vertex=md5mesh->md5vertex.begin();
-             md5vertex!=md5mesh->md5vertex.end(); ++md5vertex) {
+        for (auto md5vertex=md5mesh->md5meshdata->md5vertex.begin();
+             md5vertex!=md5mesh->md5meshdata->md5vertex.end(); ++md5vertex) {
             md5vertex->normal  =
             md5vertex->tangent = zero;
         }
 
-        for (auto md5triangle=md5mesh->md5triangle.begin();
-             md5triangle!=md5mesh->md5triangle.end(); ++md5triangle) {
+        for (auto md5triangle=md5mesh->md5meshdata->md5triangle.begin();
+             md5triangle!=md5mesh->md5meshdata->md5triangle.end(); ++md5triangle) {
             auto &indice = md5triangle->indice;
 
             vec3    v1,
@@ -597,61 +2456,61 @@ void MD5::build_bind_pose_weighted_normals_tangents()
 
             // Flat normals
             /*
-             md5mesh->md5vertex[md5triangle->indice[0]].normal =
-             md5mesh->md5vertex[md5triangle->indice[1]].normal =
-             md5mesh->md5vertex[md5triangle->indice[2]].normal = normal;
+             md5mesh->md5meshdata->md5vertex[md5triangle->indice[0]].normal =
+             md5mesh->md5meshdata->md5vertex[md5triangle->indice[1]].normal =
+             md5mesh->md5meshdata->md5vertex[md5triangle->indice[2]].normal = normal;
              */
 
             // Smooth normals
-            md5mesh->md5vertex[indice[0]].normal += normal;
+            md5mesh->md5meshdata->md5vertex[indice[0]].normal += normal;
 
-            md5mesh->md5vertex[indice[1]].normal += normal;
+            md5mesh->md5meshdata->md5vertex[indice[1]].normal += normal;
 
-            md5mesh->md5vertex[indice[2]].normal += normal;
+            md5mesh->md5meshdata->md5vertex[indice[2]].normal += normal;
 
             vec3 tangent;
 
-            vec2 uv1(md5mesh->md5vertex[indice[1]].uv);
-            uv1 -= md5mesh->md5vertex[indice[0]].uv;
+            vec2 uv1(md5mesh->md5meshdata->md5vertex[indice[1]].uv);
+            uv1 -= md5mesh->md5meshdata->md5vertex[indice[0]].uv;
 
-            vec2 uv2(md5mesh->md5vertex[indice[2]].uv);
-            uv2 -= md5mesh->md5vertex[indice[0]].uv;
+            vec2 uv2(md5mesh->md5meshdata->md5vertex[indice[2]].uv);
+            uv2 -= md5mesh->md5meshdata->md5vertex[indice[0]].uv;
 
             float c = 1.0f / (uv1->x * uv2->y - uv2->x * uv1->y);
 
             tangent = (v1 * uv2->y + v2 * uv1->y) * c;
 
 
-            md5mesh->md5vertex[indice[0]].tangent += tangent;
+            md5mesh->md5meshdata->md5vertex[indice[0]].tangent += tangent;
 
-            md5mesh->md5vertex[indice[1]].tangent += tangent;
+            md5mesh->md5meshdata->md5vertex[indice[1]].tangent += tangent;
 
-            md5mesh->md5vertex[indice[2]].tangent += tangent;
+            md5mesh->md5meshdata->md5vertex[indice[2]].tangent += tangent;
         }
 
 
-        for (auto md5vertex=md5mesh->md5vertex.begin();
-             md5vertex!=md5mesh->md5vertex.end(); ++md5vertex) {
+        for (auto md5vertex=md5mesh->md5meshdata->md5vertex.begin();
+             md5vertex!=md5mesh->md5meshdata->md5vertex.end(); ++md5vertex) {
             // Average normals
             md5vertex->normal.safeNormalize();
 
             md5vertex->tangent.safeNormalize();
         }
 
-        for (auto md5weight=md5mesh->md5weight.begin();
-             md5weight!=md5mesh->md5weight.end(); ++md5weight) {
+        for (auto md5weight=md5mesh->md5meshdata->md5weight.begin();
+             md5weight!=md5mesh->md5meshdata->md5weight.end(); ++md5weight) {
             md5weight->normal  =
             md5weight->tangent = zero;
         }
 
 
-        for (auto md5vertex=md5mesh->md5vertex.begin();
-             md5vertex!=md5mesh->md5vertex.end(); ++md5vertex) {
+        for (auto md5vertex=md5mesh->md5meshdata->md5vertex.begin();
+             md5vertex!=md5mesh->md5meshdata->md5vertex.end(); ++md5vertex) {
 
             for (int k=0; k != md5vertex->count; ++k) {
-                MD5WEIGHT &md5weight = md5mesh->md5weight[md5vertex->start + k];
+                MD5WEIGHT &md5weight = md5mesh->md5meshdata->md5weight[md5vertex->start + k];
 
-                MD5JOINT &md5joint = this->bind_pose[md5weight.joint];
+                const MD5JOINT &md5joint = this->bind_pose[md5weight.joint];
 
                 vec3    normal(md5vertex->normal),
                         tangent(md5vertex->tangent);
@@ -675,8 +2534,8 @@ void MD5::build_bind_pose_weighted_normals_tangents()
         }
         
         
-        for (auto md5weight=md5mesh->md5weight.begin();
-             md5weight!=md5mesh->md5weight.end(); ++md5weight) {
+        for (auto md5weight=md5mesh->md5meshdata->md5weight.begin();
+             md5weight!=md5mesh->md5meshdata->md5weight.end(); ++md5weight) {
             md5weight->normal.safeNormalize();
             
             md5weight->tangent.safeNormalize();
@@ -685,68 +2544,203 @@ void MD5::build_bind_pose_weighted_normals_tangents()
 }
 
 
-void MD5::set_pose(std::vector<MD5JOINT> &pose)
+void MD5::set_pose(const std::vector<MD5JOINT> &pose)
+{
+    this->compute_pose(pose);
+
+    this->upload_pose();
+
+    this->update_bound_pose(pose);
+}
+
+
+// The matrix taking a bind pose vertex to the pose, for every joint: undo
+// the bind joint, then apply the posed one.
+void MD5::build_palette(const std::vector<MD5JOINT> &pose)
+{
+    this->palette.resize(this->bind_pose.size() * 3);
+
+    for (unsigned int i=0; i!=this->bind_pose.size(); ++i) {
+        quaternion inverse(this->bind_pose[i].rotation.conjugate());
+
+        vec3 axis[3];
+
+        for (int j=0; j!=3; ++j) {
+            vec3 e(j == 0, j == 1, j == 2);
+
+            vec3_rotate_quat(axis[j], e, inverse);
+
+            vec3_rotate_quat(axis[j], axis[j], pose[i].rotation);
+        }
+
+        vec3 location = pose[i].location -
+                        axis[0] * this->bind_pose[i].location->x -
+                        axis[1] * this->bind_pose[i].location->y -
+                        axis[2] * this->bind_pose[i].location->z;
+
+        for (int j=0; j!=3; ++j) {
+            this->palette[i * 3 + j] = vec4(axis[0][j],
+                                            axis[1][j],
+                                            axis[2][j],
+                                            location[j]);
+        }
+    }
+}
+
+
+// The CPU half of set_pose(): the palette, or the skinned vertices in
+// vertex_data, then the morph targets.  Makes no GL call, so it can run
+// away from the GL thread.
+void MD5::compute_pose(const std::vector<MD5JOINT> &pose)
 {
+    bool morph = false;
+
     for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
-        vec3    *vertex_array  = (vec3 *)md5mesh->vertex_data,
-                *normal_array  = (vec3 *)&md5mesh->vertex_data[md5mesh->offset[1]],
-                *tangent_array = (vec3 *)&md5mesh->vertex_data[md5mesh->offset[3]];
+        md5mesh->update_morph();
 
-        vec2    *uv_array      = (vec2 *)&md5mesh->vertex_data[md5mesh->offset[2]];
+        if (!md5mesh->morph_vertex.empty()) morph = true;
+    }
 
-        memset(vertex_array,  0, md5mesh->offset[1]);
-        memset(normal_array,  0, md5mesh->offset[1]);
-        memset(tangent_array, 0, md5mesh->offset[1]);
+    if (this->gpu_skin) {
+        this->build_palette(pose);
 
+        bool cpu_skin = false;
 
-        for (int j=0; j != md5mesh->md5vertex.size(); ++j) {
-            MD5VERTEX *md5vertex = &md5mesh->md5vertex[j];
+        for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh)
+            if (!md5mesh->gpu_skin) cpu_skin = true;
 
-            for (int k=0; k != md5vertex->count; ++k) {
-                vec3    location(0.0f, 0.0f, 0.0f),
-                        normal  (0.0f, 0.0f, 0.0f),
-                        tangent (0.0f, 0.0f, 0.0f);
+        if (!cpu_skin) return;
+    }
 
+    // The joints as 3x4 matrices, once per pose rather than once per
+    // weight.
+    this->joint_matrix.resize(pose.size() * 12);
 
-                MD5WEIGHT *md5weight = &md5mesh->md5weight[md5vertex->start + k];
+    for (unsigned int i=0; i!=pose.size(); ++i) {
+        float *m = &this->joint_matrix[i * 12];
 
-                MD5JOINT *md5joint = &pose[md5weight->joint];
+        for (int j=0; j!=3; ++j) {
+            vec3 e(j == 0, j == 1, j == 2),
+                 axis;
 
-                vec3_rotate_quat(location,
-                                 md5weight->location,
-                                 md5joint->rotation);
+            vec3_rotate_quat(axis, e, pose[i].rotation);
 
-                vec3_rotate_quat(normal,
-                                 md5weight->normal,
-                                 md5joint->rotation);
+            m[j] = axis->x; m[4 + j] = axis->y; m[8 + j] = axis->z;
+        }
 
-                vec3_rotate_quat(tangent,
-                                 md5weight->tangent,
-                                 md5joint->rotation);
+        m[3] = pose[i].location->x; m[7] = pose[i].location->y; m[11] = pose[i].location->z;
+    }
 
-                vertex_array[j] += (md5joint->location + location) * md5weight->bias;
+    unsigned int n_block = 0;
 
-                normal_array[j] += normal * md5weight->bias;
+    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        if (md5mesh->gpu_skin) continue;
+
+        if (md5mesh->md5meshdata->md5skinstream.empty())
+            md5mesh->skin(pose);
+        else {
+            for (auto md5skinstream=md5mesh->md5meshdata->md5skinstream.begin();
+                 md5skinstream!=md5mesh->md5meshdata->md5skinstream.end(); ++md5skinstream)
+                n_block += md5skinstream->vertex.size() / 4;
+        }
+    }
 
-                tangent_array[j] += tangent * md5weight->bias;
-            }
-            
-            uv_array[j] = md5vertex->uv;
+    // Contiguous ranges of blocks, one per thread, each writing its own
+    // vertices.  Not worth waking up a thread for less than 64 blocks.
+    MD5SKINRANGE range[MD5_MAX_THREAD];
+
+    pthread_t thread[MD5_MAX_THREAD];
+
+    bool started[MD5_MAX_THREAD];
+
+    unsigned int n = CLAMP(this->n_thread, 1, MD5_MAX_THREAD);
+
+    while (n > 1 && n_block / n < 64) --n;
+
+    for (unsigned int i=0; i!=n; ++i) {
+        range[i].md5   = this;
+        range[i].start = n_block * i / n;
+        range[i].end   = n_block * (i + 1) / n;
+    }
+
+    for (unsigned int i=1; i!=n; ++i) {
+        started[i] = !pthread_create(&thread[i],
+                                     NULL,
+                                     MD5_skin_range,
+                                     (void *)&range[i]);
+
+        if (!started[i]) MD5_skin_range(&range[i]);
+    }
+
+    if (n_block) MD5_skin_range(&range[0]);
+
+    for (unsigned int i=1; i!=n; ++i) {
+        if (started[i]) pthread_join(thread[i], NULL);
+    }
+
+    if (!morph) return;
+
+    if (!this->gpu_skin) this->build_palette(pose);
+
+    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        if (!md5mesh->gpu_skin && !md5mesh->morph_vertex.empty())
+            md5mesh->apply_morph(this->palette);
+    }
+}
+
+
+// The GL half of set_pose(): send the skinned vertices to the VBOs, from
+// vertex_data_back instead when back is set.
+void MD5::upload_pose(const bool back)
+{
+    this->n_vertex_upload = 0;
+
+    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        if (md5mesh->gpu_skin) {
+            this->n_vertex_upload += md5mesh->upload_morph();
+
+            continue;
         }
-        
-        
+
+        this->n_vertex_upload += md5mesh->size;
+
+        // Respecify the whole store rather than updating it in place, so
+        // the driver can hand out fresh memory instead of waiting for the
+        // draws still reading the previous pose.
         glBindBuffer(GL_ARRAY_BUFFER, md5mesh->vbo);
-        
-        glBufferSubData(GL_ARRAY_BUFFER,
-                        0,
-                        md5mesh->size,
-                        md5mesh->vertex_data);		
+
+        glBufferData(GL_ARRAY_BUFFER,
+                     md5mesh->size,
+                     back ? md5mesh->vertex_data_back : md5mesh->vertex_data,
+                     GL_DYNAMIC_DRAW);
     }
     
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
+// Exchange vertex_data with vertex_data_back, so the pose just skinned
+// can be uploaded while the next one is skinned.  The back buffer starts
+// as a copy, for the texture coordinates the skinning does not write.
+void MD5::swap_vertex_data()
+{
+    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        if (!md5mesh->vertex_data_back) {
+            md5mesh->vertex_data_back = (unsigned char *) calloc(1, md5mesh->size);
+
+            memcpy(md5mesh->vertex_data_back,
+                   md5mesh->vertex_data,
+                   md5mesh->size);
+        }
+
+        unsigned char *vertex_data = md5mesh->vertex_data;
+
+        md5mesh->vertex_data      = md5mesh->vertex_data_back;
+        md5mesh->vertex_data_back = vertex_data;
+    }
+}
+
+
 void MD5::blend_pose(std::vector<MD5JOINT> &final_pose,
                      const std::vector<MD5JOINT> &pose0,
                      const std::vector<MD5JOINT> &pose1,
@@ -788,9 +2782,15 @@ void MD5::add_pose(std::vector<MD5JOINT> &final_pose,
                    const MD5Method joint_interpolation_method,
                    const float action_weight)
 {
+    vec3 location[2];
+
+    quaternion rotation[2];
+
     for (int i=0; i != this->bind_pose.size(); ++i) {
-        if ((action1.frame[action1.curr_frame][i].location != action1.frame[action1.next_frame][i].location) ||
-            (action1.frame[action1.curr_frame][i].rotation != action1.frame[action1.next_frame][i].rotation))
+        action1.md5anim->get_joint(action1.curr_frame, i, location[0], rotation[0]);
+        action1.md5anim->get_joint(action1.next_frame, i, location[1], rotation[1]);
+
+        if ((location[0] != location[1]) || (rotation[0] != rotation[1]))
         {
             final_pose[i].location = linterp(action0.pose[i].location,
                                              action1.pose[i].location,
@@ -824,29 +2824,35 @@ void MD5::add_pose(std::vector<MD5JOINT> &final_pose,
 }
 
 
-void MD5::update_bound_mesh()
+// The exact bounds of the pose in vertex_data, one pass over the
+// vertices.
+void MD5::get_bound_mesh(vec3 &min, vec3 &max) const
 {
-    // Get the mesh min and max.
-
-    // min, and max vectors are already set using FLT_MAX, or -FLT_MAX
-    // by the constructor
+    min = vec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
 
+    max = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-    for (int i=0; i != this->md5mesh.size(); ++i) {
-        MD5MESH *md5mesh = &this->md5mesh[i];
+    for (unsigned int i=0; i != this->md5mesh.size(); ++i) {
+        const MD5MESH *md5mesh = &this->md5mesh[i];
 
-        vec3 *vertex_array = (vec3 *)md5mesh->vertex_data;
+        const vec3 *vertex_array = (const vec3 *)md5mesh->vertex_data;
 
-        for (int j=0; j != md5mesh->md5vertex.size(); ++j) {
-            if (vertex_array[j]->x < this->min->x) this->min->x = vertex_array[j]->x;
-            if (vertex_array[j]->y < this->min->y) this->min->y = vertex_array[j]->y;
-            if (vertex_array[j]->z < this->min->z) this->min->z = vertex_array[j]->z;
+        for (unsigned int j=0; j != md5mesh->md5meshdata->md5vertex.size(); ++j) {
+            if (vertex_array[j]->x < min->x) min->x = vertex_array[j]->x;
+            if (vertex_array[j]->y < min->y) min->y = vertex_array[j]->y;
+            if (vertex_array[j]->z < min->z) min->z = vertex_array[j]->z;
 
-            if (vertex_array[j]->x > this->max->x) this->max->x = vertex_array[j]->x;
-            if (vertex_array[j]->y > this->max->y) this->max->y = vertex_array[j]->y;
-            if (vertex_array[j]->z > this->max->z) this->max->z = vertex_array[j]->z;
+            if (vertex_array[j]->x > max->x) max->x = vertex_array[j]->x;
+            if (vertex_array[j]->y > max->y) max->y = vertex_array[j]->y;
+            if (vertex_array[j]->z > max->z) max->z = vertex_array[j]->z;
         }
     }
+}
+
+
+void MD5::update_bound_mesh()
+{
+    this->get_bound_mesh(this->min, this->max);
 
 
     // Mesh dimension
@@ -858,8 +2864,103 @@ void MD5::update_bound_mesh()
 }
 
 
+// Bounds of a pose from the boxes of the joints, in one pass over the
+// joints rather than the vertices.  They hold every vertex, but can be
+// larger than update_bound_mesh() finds.
+void MD5::update_bound_pose(const std::vector<MD5JOINT> &pose)
+{
+    const std::vector<vec3> &joint_min = this->md5model->joint_min,
+                            &joint_max = this->md5model->joint_max;
+
+    this->min = vec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+
+    this->max = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (unsigned int i=0; i!=joint_min.size(); ++i) {
+        if (joint_min[i]->x > joint_max[i]->x) continue;
+
+        vec3 center = (joint_min[i] + joint_max[i]) * 0.5f,
+             extent = (joint_max[i] - joint_min[i]) * 0.5f,
+             axis[3];
+
+        // The box posed, then boxed again: its center moves with the
+        // joint, its extent along each axis is the sum of its rotated
+        // extents projected on that axis.
+        vec3_rotate_quat(center, center, pose[i].rotation);
+
+        center += pose[i].location;
+
+        for (int j=0; j!=3; ++j) {
+            vec3 e(j == 0, j == 1, j == 2);
+
+            vec3_rotate_quat(axis[j], e, pose[i].rotation);
+        }
+
+        for (int j=0; j!=3; ++j) {
+            float r = fabsf(axis[0][j]) * extent->x +
+                      fabsf(axis[1][j]) * extent->y +
+                      fabsf(axis[2][j]) * extent->z;
+
+            this->min[j] = std::min(this->min[j], center[j] - r);
+            this->max[j] = std::max(this->max[j], center[j] + r);
+        }
+    }
+
+    // The morph targets move vertices by at most their extent, the
+    // blended rotations do not make them longer.
+    float extent = 0.0f;
+
+    for (auto md5mesh=this->md5mesh.begin(); md5mesh != this->md5mesh.end(); ++md5mesh) {
+        const std::vector<MD5MORPHTARGET> &md5morphtarget = md5mesh->md5meshdata->md5morphtarget;
+
+        float e = 0.0f;
+
+        for (unsigned int i=0; i!=md5mesh->morph_weight.size(); ++i)
+            e += fabsf(md5mesh->morph_weight[i]) * md5morphtarget[i].extent;
+
+        extent = std::max(extent, e);
+    }
+
+    if (extent > 0.0f) {
+        this->min -= vec3(extent, extent, extent);
+        this->max += vec3(extent, extent, extent);
+    }
+
+    this->dimension = this->max - this->min;
+
+    this->radius = this->dimension.length() * 0.5f;
+}
+
+
+// The normals, tangents and skin streams live in the shared model, so
+// only the first instance to be built computes them, and then writes the
+// model to its binary cache.  Needs the bind pose in vertex_data.
+void MD5::build_model()
+{
+    MD5MODEL *md5model = this->md5model;
+
+    if (md5model->built) return;
+
+    this->build_bind_pose_weighted_normals_tangents();
+
+    for (auto md5meshdata=md5model->md5meshdata.begin();
+         md5meshdata!=md5model->md5meshdata.end(); ++md5meshdata)
+        md5meshdata->build_skin_stream();
+
+    md5model->built = true;
+
+    if (md5model->cache[0]) {
+        md5model->save_cache(md5model->cache, md5model->source);
+
+        md5model->cache[0] = 0;
+    }
+}
+
+
 void MD5::build()
 {
+    if (!this->md5model) return;
+
     for (auto md5mesh=this->md5mesh.begin();
          md5mesh!=this->md5mesh.end(); ++md5mesh) {
         md5mesh->build_vbo();
@@ -869,23 +2970,61 @@ void MD5::build()
 
     this->set_pose(this->bind_pose);
 
-    this->build_bind_pose_weighted_normals_tangents();
-    
+    this->build_model();
+
     this->set_pose(this->bind_pose);
     
     this->update_bound_mesh();
 }
 
 
+// Same as build(), but for skinning on the GPU: the bind pose is baked into
+// static VBOs, and set_pose() only updates the joint palette.
+void MD5::build_skin()
+{
+    if (!this->md5model) return;
+
+    for (auto md5mesh=this->md5mesh.begin();
+         md5mesh!=this->md5mesh.end(); ++md5mesh) {
+        md5mesh->init_vertex_data();
+
+        md5mesh->skin(this->bind_pose);
+    }
+
+    this->build_model();
+
+    for (auto md5mesh=this->md5mesh.begin();
+         md5mesh!=this->md5mesh.end(); ++md5mesh) {
+        md5mesh->skin(this->bind_pose);
+
+        if (!md5mesh->build_skin_vbo()) {
+            md5mesh->build_vbo();
+
+            md5mesh->skin(this->bind_pose);
+        }
+
+        md5mesh->build_vao();
+    }
+
+    this->update_bound_mesh();
+
+    this->gpu_skin = true;
+
+    this->set_pose(this->bind_pose);
+}
+
+
 void MD5::build2()
 {
+    if (!this->md5model) return;
+
     for (auto md5mesh=this->md5mesh.begin();
          md5mesh != this->md5mesh.end(); ++md5mesh)
         md5mesh->build_vbo();
 
     this->set_pose(this->bind_pose);
 
-    this->build_bind_pose_weighted_normals_tangents();
+    this->build_model();
 
     this->set_pose(this->bind_pose);
 
@@ -897,23 +3036,50 @@ bool MD5::draw_action(float time_step)
 {
     bool    update = false;
 
+    if (this->md5model &&
+        (this->sampled_joint_lod != this->joint_lod ||
+         this->sampled_joint_importance != this->md5model->joint_importance_serial))
+        this->update_joint_lod();
+
+    const std::vector<unsigned int> *joint = this->attached_joint.empty() ?
+                                             NULL : &this->sampled_joint;
+
     for (auto md5action = this->md5action.begin();
          md5action != this->md5action.end(); ++md5action) {
 
         if (md5action->state == PLAY) {
             md5action->frame_time += time_step;
 
+            // Steps of more than a frame, as taken by the animation LOD,
+            // skip the frames in between instead of falling behind.  The
+            // last frames of an action that does not loop are left to
+            // the code below.
+            while (md5action->frame_time >= md5action->fps * 2.0f) {
+                int n_frame = md5action->md5anim->n_frame;
+
+                if (!md5action->loop && md5action->curr_frame + 2 >= n_frame)
+                    break;
+
+                md5action->curr_frame = (md5action->curr_frame + 1) % n_frame;
+                md5action->next_frame = (md5action->curr_frame + 1) % n_frame;
+
+                md5action->frame_time -= md5action->fps;
+            }
+
             switch(md5action->method)
             {
                 case MD5_METHOD_FRAME:
                 {
                     if (md5action->frame_time >= md5action->fps) {
-                        md5action->pose =
-                            md5action->frame[md5action->curr_frame];
+                        md5action->md5anim->get_pose(md5action->curr_frame,
+                                                     md5action->pose,
+                                                     joint);
+
+                        if (joint) this->attach_joints(md5action->pose);
 
                         ++md5action->curr_frame;
 
-                        if (md5action->curr_frame == md5action->frame.size()) {
+                        if (md5action->curr_frame == md5action->md5anim->n_frame) {
                             if (md5action->loop)
                                 md5action->curr_frame = 0;
                             else {
@@ -924,7 +3090,7 @@ bool MD5::draw_action(float time_step)
 
                         md5action->next_frame = md5action->curr_frame + 1;
 
-                        if (md5action->next_frame == md5action->frame.size()) {
+                        if (md5action->next_frame == md5action->md5anim->n_frame) {
                             md5action->next_frame = 0;
                         }
 
@@ -941,28 +3107,32 @@ bool MD5::draw_action(float time_step)
                 {
                     float t = CLAMP(md5action->frame_time / md5action->fps, 0.0f, 1.0f);
 
+                    md5action->decode_frame(joint);
+
                     this->blend_pose(md5action->pose,
-                                     md5action->frame[md5action->curr_frame],
-                                     md5action->frame[md5action->next_frame],
+                                     md5action->frame_pose[0],
+                                     md5action->frame_pose[1],
                                      md5action->method,
                                      t);
 
+                    if (joint) this->attach_joints(md5action->pose);
+
                     if (t >= 1.0f) {
                         ++md5action->curr_frame;
                         
                         md5action->next_frame = (md5action->curr_frame + 1);
                         
                         if (md5action->loop) {
-                            if (md5action->curr_frame == md5action->frame.size()) {
+                            if (md5action->curr_frame == md5action->md5anim->n_frame) {
                                 md5action->curr_frame = 0;
                                 md5action->next_frame = 1;
                             }								
                             
-                            if (md5action->next_frame == md5action->frame.size()) {
+                            if (md5action->next_frame == md5action->md5anim->n_frame) {
                                 md5action->next_frame = 0;
                             }
                         } else {
-                            if (md5action->next_frame == md5action->frame.size()) {
+                            if (md5action->next_frame == md5action->md5anim->n_frame) {
                                 md5action->action_stop();
                                 break;
                             }
@@ -985,6 +3155,8 @@ bool MD5::draw_action(float time_step)
 
 void MD5::draw()
 {
+    this->n_palette_upload = 0;
+
     if (this->visible && this->distance) {
         for (auto md5mesh=this->md5mesh.begin();
              md5mesh != this->md5mesh.end(); ++md5mesh) {
@@ -998,11 +3170,93 @@ void MD5::draw()
                 else
                     md5mesh->set_mesh_attributes();
 
-                glDrawElements(md5mesh->mode,
-                               md5mesh->n_indice,
+                if (this->gpu_skin) {
+                    this->draw_skin(&(*md5mesh));
+
+                    continue;
+                }
+
+                glDrawElements(md5mesh->md5meshdata->mode,
+                               md5mesh->md5meshdata->n_indice,
                                GL_UNSIGNED_SHORT,
                                (void *)NULL);
             }
         }
     }	
 }
+
+
+void MD5::draw_skin(MD5MESH *md5mesh)
+{
+    GLint location = -1;
+
+    if (md5mesh->objmaterial && md5mesh->objmaterial->program) {
+        PROGRAM *program = md5mesh->objmaterial->program;
+
+        location = program->get_uniform_location(MD5_PALETTE_String);
+
+        // Some drivers report arrays with their first subscript.
+        if (location == -1)
+            location = program->get_uniform_location((char *)"PALETTE[0]");
+    } else {
+        GLint pid;
+
+        glGetIntegerv(GL_CURRENT_PROGRAM, &pid);
+
+        if (pid) location = glGetUniformLocation(pid, MD5_PALETTE_String);
+    }
+
+    // A mesh build_skin_vbo() left to the CPU, every vertex taking the
+    // whole weight of an identity palette entry.
+    if (!md5mesh->gpu_skin) {
+        static const float identity[12] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                            0.0f, 1.0f, 0.0f, 0.0f,
+                                            0.0f, 0.0f, 1.0f, 0.0f };
+
+        if (location != -1) glUniform4fv(location, 3, identity);
+
+        ++this->n_palette_upload;
+
+        glVertexAttrib4f(VA_Joint,  0.0f, 0.0f, 0.0f, 0.0f);
+        glVertexAttrib4f(VA_Weight, 1.0f, 0.0f, 0.0f, 0.0f);
+        glVertexAttrib4f(VA_Morph,  0.0f, 0.0f, 0.0f, 0.0f);
+
+        glDrawElements(md5mesh->md5meshdata->mode,
+                       md5mesh->md5meshdata->n_indice,
+                       GL_UNSIGNED_SHORT,
+                       (void *)NULL);
+
+        return;
+    }
+
+    for (auto md5skinbatch=md5mesh->md5meshdata->md5skinbatch.begin();
+         md5skinbatch!=md5mesh->md5meshdata->md5skinbatch.end(); ++md5skinbatch) {
+        const std::vector<unsigned short> &joint = md5skinbatch->joint;
+
+        this->batch_palette.resize(joint.size() * 3);
+
+        for (unsigned int i=0; i!=joint.size(); ++i) {
+            this->batch_palette[i * 3    ] = this->palette[joint[i] * 3    ];
+            this->batch_palette[i * 3 + 1] = this->palette[joint[i] * 3 + 1];
+            this->batch_palette[i * 3 + 2] = this->palette[joint[i] * 3 + 2];
+        }
+
+        if (location != -1 && !joint.empty())
+            glUniform4fv(location, joint.size() * 3, this->batch_palette[0].v());
+
+        this->n_palette_upload += joint.size();
+
+        glDrawElements(GL_TRIANGLES,
+                       md5skinbatch->count,
+                       GL_UNSIGNED_SHORT,
+                       BUFFER_OFFSET(md5skinbatch->first * sizeof(unsigned short)));
+    }
+
+    if (!md5mesh->vao) {
+        glDisableVertexAttribArray(VA_Joint);
+
+        glDisableVertexAttribArray(VA_Weight);
+
+        if (md5mesh->vbo_morph) glDisableVertexAttribArray(VA_Morph);
+    }
+}
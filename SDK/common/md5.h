@@ -47,6 +47,72 @@ as being the original software.
 #define MD5_H
 
 
+// GPU skinning.  MD5::build_skin() bakes the bind pose of every mesh into
+// a static VBO holding, per vertex, up to MD5_MAX_INFLUENCE joint indices
+// (VA_Joint, unsigned bytes) and weights (VA_Weight).  set_pose() then
+// only computes a palette of 3x4 joint matrices, and draw() uploads the
+// rows each batch needs to the vec4 array uniform MD5_PALETTE_String,
+// three rows per joint.  A vertex shader skins with:
+//
+//     uniform highp vec4 PALETTE[ 96 ];
+//     attribute mediump vec4 JOINT;
+//     attribute lowp vec4 WEIGHT;
+//
+//     highp vec4 p = vec4( POSITION, 1.0 );
+//     highp vec4 r0 = vec4( 0.0 ), r1 = vec4( 0.0 ), r2 = vec4( 0.0 );
+//     for( int i = 0; i != 4; ++i ) {
+//         int j = int( JOINT[ i ] ) * 3;
+//         r0 += PALETTE[ j     ] * WEIGHT[ i ];
+//         r1 += PALETTE[ j + 1 ] * WEIGHT[ i ];
+//         r2 += PALETTE[ j + 2 ] * WEIGHT[ i ];
+//     }
+//     highp vec3 position = vec3( dot( r0, p ), dot( r1, p ), dot( r2, p ) );
+//
+// normals and tangents use the same rows with w = 0.  A mesh using more
+// joints than MD5_MAX_PALETTE is split into batches by joint set, and one
+// whose batches need more than 65536 vertices stays on the CPU, see
+// MD5::gpu_skin.
+
+#define MD5_MAX_INFLUENCE	4
+
+// 3 vec4 per joint: 96 of the 128 vertex uniform vectors OpenGL ES 2.0
+// guarantees, leaving room for the matrices and the light.
+#define MD5_MAX_PALETTE		32
+
+#define MD5_PALETTE_String	((char *)"PALETTE")
+
+
+// Morph targets.  A target moves some vertices of a mesh away from the
+// bind pose, and only stores those: their index, and their position and
+// normal deltas.  The targets are shared by every MD5 of the model, see
+// MD5MESHDATA::add_morph_target(), and each MD5 weights them on its own
+// with MD5MESH::set_morph_weight().  set_pose() only goes through the
+// vertices moved by the targets weighted in.  On the CPU path the summed
+// deltas are moved by the joint rotations of their vertex, blended like
+// the vertex is, and added to the skinned vertices, which is the same as
+// adding them to the bind pose before skinning.  On the GPU path they are
+// streamed per skin vertex to VA_Morph, for the shader to add before
+// skinning.  OpenGL ES 2.0 only guarantees 8 attributes, so both deltas
+// share the slot: the location in xyz, and the normal in w as three
+// signed bytes (steps of 1 / 63.5), see MD5_pack_morph_normal():
+//
+//     attribute highp vec4 MORPH;
+//
+//     highp vec3 b = vec3( floor( MORPH.w / 65536.0 ),
+//                          mod( floor( MORPH.w / 256.0 ), 256.0 ),
+//                          mod( MORPH.w, 256.0 ) );
+//     highp vec4 p = vec4( POSITION + MORPH.xyz, 1.0 );
+//     mediump vec3 n = NORMAL + ( mod( b + 128.0, 256.0 ) - 128.0 ) / 63.5;
+//
+// The 24 bits of w need the 32 bit floats vertex shaders have in
+// practice; highp only guarantees 16.  Meshes without targets weighted
+// in leave the array disabled and the attribute at 0.
+
+
+// CPU skinning threads used by MD5::set_pose(), at most.
+#define MD5_MAX_THREAD		8
+
+
 enum MD5Method {
     MD5_METHOD_FRAME = 0,
     MD5_METHOD_LERP  = 1,
@@ -146,26 +212,90 @@ struct MD5WEIGHT {
 };
 
 
-struct MD5MESH {
-    char		shader[ MAX_CHAR ] = "";
+struct MD5SKINVERTEX {
+    float		position[ 3 ];
 
-    std::vector<MD5VERTEX>  md5vertex;
+    float		normal[ 3 ];
 
-    unsigned int	vbo;
+    float		uv[ 2 ];
 
-    unsigned int	size;
+    float		tangent[ 3 ];
 
-    unsigned int	stride;
+    float		weight[ MD5_MAX_INFLUENCE ];
 
-    unsigned int	offset[ 4 ] = { 0, 0, 0, 0 };
+    // Palette slots within the batch, not skeleton joints.
+    unsigned char	joint[ MD5_MAX_INFLUENCE ];
+};
 
-    unsigned char	*vertex_data;
+
+// A vertex moved by an MD5MORPHTARGET, the w of the deltas is 0 so they
+// load as SIMDFLOAT4.
+struct MD5MORPHDELTA {
+    unsigned int	vertex;
+
+    float		location[ 4 ];
+
+    float		normal[ 4 ];
+};
+
+
+struct MD5MORPHTARGET {
+    char			name[ MAX_CHAR ] = "";
+
+    std::vector<MD5MORPHDELTA>	md5morphdelta;
+
+    // Longest location delta, to grow the bounds of MD5::update_bound_pose().
+    float			extent;
+
+    MD5MORPHTARGET() : extent(0.0f) {}
+};
+
+
+// Triangles of a GPU skinned mesh drawn with one palette upload.
+struct MD5SKINBATCH {
+    // Skeleton joint of each palette slot.
+    std::vector<unsigned short> joint;
+
+    // Range in the index buffer.
+    unsigned int	first;
+
+    unsigned int	count;
+};
+
+
+// CPU skinning data of the vertices having n_weight weights, in blocks
+// of 4 vertices.  Within a block every field of every weight is stored
+// 4-wide, one lane per vertex, so the vertices are skinned together with
+// SIMDFLOAT4.
+struct MD5SKINSTREAM {
+    unsigned int		n_weight;
+
+    // Vertex of every lane; the last block is padded by repeating its
+    // last vertex.
+    std::vector<unsigned int>	vertex;
+
+    // Per block and weight, the joint of each lane.
+    std::vector<unsigned short>	joint;
+
+    // Per block and weight, 4 lanes of bias, location xyz, normal xyz and
+    // tangent xyz.
+    std::vector<float>		weight;
+};
+
+
+// Geometry and weights of one mesh of an .md5mesh file, shared by every
+// MD5 loaded from it.  Along with the data built from it once for all of
+// them: the index buffers and the skinning streams and batches.
+struct MD5MESHDATA {
+    char		shader[ MAX_CHAR ] = "";
+
+    std::vector<MD5VERTEX>  md5vertex;
 
     std::vector<MD5TRIANGLE>    md5triangle;
 
     unsigned int	mode;
 
-    unsigned short	n_indice;
+    unsigned int	n_indice;
 
     std::vector<unsigned short> indice;
 
@@ -173,22 +303,249 @@ struct MD5MESH {
 
     std::vector<MD5WEIGHT>  md5weight;
 
+    // Built by build_skin_stream() for the CPU path of MD5::set_pose().
+    std::vector<MD5SKINSTREAM>  md5skinstream;
+
+    // Not empty once MD5MESH::build_skin_vbo() baked the mesh for GPU
+    // skinning: vbo_skin holds MD5SKINVERTEX and vbo_skin_indice the
+    // triangles of the batches.
+    std::vector<MD5SKINBATCH>   md5skinbatch;
+
+    unsigned int	vbo_skin;
+
+    unsigned int	vbo_skin_indice;
+
+    // Set by build_skin_vbo() when the batches would need more vertices
+    // than unsigned short indices reach: the mesh is skinned on the CPU
+    // even by MD5::build_skin().
+    bool		cpu_skin;
+
+    // The skin vertices made from vertex i by build_skin_vbo(), duplicated
+    // across batches: skin_vertex[skin_vertex_start[i]] up to
+    // skin_vertex[skin_vertex_start[i + 1]].
+    std::vector<unsigned int>	skin_vertex_start;
+
+    std::vector<unsigned short>	skin_vertex;
+
+    // Added by add_morph_target(), weighted by every MD5 on its own.
+    std::vector<MD5MORPHTARGET>	md5morphtarget;
+public:
+    MD5MESHDATA() : mode(GL_TRIANGLES), n_indice(0), vbo_indice(0),
+                    vbo_skin(0), vbo_skin_indice(0), cpu_skin(false) {}
+    ~MD5MESHDATA() {
+        if (this->vbo_indice)
+            glDeleteBuffers(1, &this->vbo_indice);
+
+        if (this->vbo_skin)
+            glDeleteBuffers(1, &this->vbo_skin);
+
+        if (this->vbo_skin_indice)
+            glDeleteBuffers(1, &this->vbo_skin_indice);
+    }
+    void build_skin_stream();
+    int add_morph_target(const char *name, const std::vector<MD5MORPHDELTA> &md5morphdelta);
+    int get_morph_target(const char *name) const;
+};
+
+
+// Everything an .md5mesh file holds.  Loaded once per file through
+// RESOURCE::acquire_md5model() and never changed once built, except by
+// the first MD5 to optimize() and build() it.
+struct MD5MODEL {
+    char		name[ MAX_CHAR ] = "";
+
+    std::vector<MD5JOINT>    bind_pose;
+
+    std::vector<MD5MESHDATA> md5meshdata;
+
+    // Set once the triangles were turned into strips.
+    bool		optimized;
+
+    // Set once the weight normals, tangents and skinning streams exist.
+    bool		built;
+
+    // Binary cache file MD5::build() writes once the model is built, see
+    // RESOURCE::set_cache_path().  Empty when there is nothing to write.
+    char		cache[ MAX_PATH ] = "";
+
+    // Canonical path of the .md5mesh, recorded in the cache.
+    char		source[ MAX_PATH ] = "";
+
+    // Per joint, how much it matters to the silhouette, from 0 to 255.
+    // Compared against MD5::joint_lod; empty when every joint matters.
+    std::vector<unsigned char> joint_importance;
+
+    // Bumped by every change to joint_importance, for each MD5 to split
+    // its joints again.
+    unsigned int	joint_importance_serial;
+
+    // Box of the weights of each joint, in the space of the joint, for
+    // MD5::update_bound_pose().  min is above max for joints without
+    // weights.
+    std::vector<vec3>	joint_min;
+
+    std::vector<vec3>	joint_max;
+public:
+    MD5MODEL();
+    MD5MODEL(const char *filename, const bool relative_path);
+    bool load_cache(const char *filename, const char *source);
+    bool save_cache(const char *filename, const char *source) const;
+private:
+    void build_joint_bound();
+    MD5MODEL(const MD5MODEL &src);
+    MD5MODEL &operator=(const MD5MODEL &rhs);
+};
+
+
+// How far, in model units and radians, a joint decoded from an MD5ANIM
+// may stray from the .md5anim frame it was built from.  Keys are dropped
+// as long as interpolating their neighbours stays within these.
+#define MD5_ANIM_LOCATION_ERROR 0.001f
+
+#define MD5_ANIM_ROTATION_ERROR 0.001f
+
+
+// The keys of one joint of an MD5ANIM.  Locations are 16 bits per
+// component within the box of the track, rotations are smallest-three
+// quaternions packed in 48 bits.  A frame between two keys is their
+// interpolation, a frame past the last key is the last key.
+struct MD5TRACK {
+    vec3		min;
+
+    vec3		scale;
+
+    // First key and number of keys in MD5ANIM::location_frame and
+    // location_key (3 shorts per key).
+    unsigned int	location;
+
+    unsigned int	n_location;
+
+    // Same for MD5ANIM::rotation_frame and rotation_key.
+    unsigned int	rotation;
+
+    unsigned int	n_rotation;
+
+    MD5TRACK() : min(0,0,0), scale(0,0,0), location(0), n_location(0),
+                 rotation(0), n_rotation(0) {}
+};
+
+
+// The frames of an .md5anim file, in model space.  Loaded once per file
+// through RESOURCE::acquire_md5anim() and shared by every MD5ACTION
+// playing it.  Stored compressed, one MD5TRACK per joint, and decoded
+// frame by frame with get_pose().
+struct MD5ANIM {
+    char		name[ MAX_CHAR ] = "";
+
+    unsigned int	n_frame;
+
+    std::vector<MD5TRACK>	track;
+
+    std::vector<unsigned short>	location_frame;
+
+    std::vector<unsigned short>	location_key;
+
+    std::vector<unsigned short>	rotation_frame;
+
+    std::vector<unsigned short>	rotation_key;
+
+    // frameRate of the file.
+    float		fps;
+
+    // Largest error of the decoded frames against the file, measured
+    // once compressed.
+    float		location_error;
+
+    float		rotation_error;
+public:
+    MD5ANIM();
+    MD5ANIM(const char *filename, const bool relative_path);
+    bool load_cache(const char *filename, const char *source);
+    bool save_cache(const char *filename, const char *source) const;
+    unsigned int get_joint_count() const { return this->track.size(); }
+    unsigned int get_size() const;
+    void get_joint(const unsigned int frame,
+                   const unsigned int joint,
+                   vec3 &location,
+                   quaternion &rotation) const;
+    void get_pose(const unsigned int frame,
+                  std::vector<MD5JOINT> &pose,
+                  const std::vector<unsigned int> *joint=NULL) const;
+private:
+    void compress(const std::vector<std::vector<MD5JOINT> > &frame,
+                  const float max_location_error,
+                  const float max_rotation_error);
+    MD5ANIM(const MD5ANIM &src);
+    MD5ANIM &operator=(const MD5ANIM &rhs);
+};
+
+
+// A mesh of one MD5: the skinned vertices and what it is drawn with.
+struct MD5MESH {
+    char		shader[ MAX_CHAR ] = "";
+
+    MD5MESHDATA		*md5meshdata;
+
+    unsigned int	vbo;
+
+    unsigned int	size;
+
+    unsigned int	stride;
+
+    unsigned int	offset[ 4 ] = { 0, 0, 0, 0 };
+
+    unsigned char	*vertex_data;
+
+    // The other half of vertex_data when it is double buffered by
+    // MD5::swap_vertex_data(): the previous pose, still to be uploaded
+    // while the next one is skinned into vertex_data.
+    unsigned char	*vertex_data_back;
+
     unsigned int	vao;
 
     bool                visible;
 
     OBJMATERIAL		*objmaterial;
+
+    // Set by build_skin_vbo(): drawn from the VBOs of md5meshdata with
+    // the joint palette instead of vbo.
+    bool		gpu_skin;
+
+    // Weight of each target of md5meshdata, 0 for the ones not used.
+    std::vector<float>	morph_weight;
+
+    // Sum of the targets weighted in, 8 floats per vertex (location then
+    // normal), 0 but for the vertices listed in morph_vertex, which are
+    // the ones flagged in morph_flag.
+    std::vector<float>	morph_delta;
+
+    std::vector<unsigned char> morph_flag;
+
+    std::vector<unsigned int> morph_vertex;
+
+    // GPU path: morph_delta per skin vertex as VA_Morph reads it, 4 floats
+    // each, the range changed since it was last sent to vbo_morph.
+    std::vector<float>	morph_stream;
+
+    unsigned int	morph_first;
+
+    unsigned int	morph_last;
+
+    unsigned int	vbo_morph;
 public:
     MD5MESH(const char *name=NULL);
     ~MD5MESH() {
         if (this->vertex_data)
             free(this->vertex_data);
 
+        if (this->vertex_data_back)
+            free(this->vertex_data_back);
+
         if (this->vbo)
             glDeleteBuffers(1, &this->vbo);
 
-        if (this->vbo_indice)
-            glDeleteBuffers(1, &this->vbo_indice);
+        if (this->vbo_morph)
+            glDeleteBuffers(1, &this->vbo_morph);
 
         if (this->vao)
             glDeleteVertexArraysOES(1, &this->vao);
@@ -197,7 +554,7 @@ public:
     MD5MESH &operator=(const MD5MESH &rhs) {
         if (this != &rhs) {
             strcpy(shader, rhs.shader);
-            md5vertex   = rhs.md5vertex;
+            md5meshdata = rhs.md5meshdata;
             vbo         = rhs.vbo;
             size        = rhs.size;
             stride      = rhs.stride;
@@ -205,32 +562,41 @@ public:
             if (vertex_data) free(vertex_data);
             vertex_data = (unsigned char *) calloc(1, size);
             vertex_data = rhs.vertex_data;
-            md5triangle = rhs.md5triangle;
-            mode        = rhs.mode;
-            n_indice    = rhs.n_indice;
-            indice      = rhs.indice;
-            vbo_indice  = rhs.vbo_indice;
-            md5weight   = rhs.md5weight;
             vao         = rhs.vao;
             visible     = rhs.visible;
             objmaterial = rhs.objmaterial;
+            gpu_skin    = rhs.gpu_skin;
+            morph_weight = rhs.morph_weight;
         }
         return *this;
     }
     void set_mesh_attributes();
     void set_mesh_visibility(const bool visible);
     void set_mesh_material(OBJMATERIAL *objmaterial);
+    void init_vertex_data();
+    void skin(const std::vector<MD5JOINT> &pose);
     void build_vbo();
+    bool build_skin_vbo();
     void build_vao();
+    void set_morph_weight(int target, float weight);
+    void update_morph();
+    void apply_morph(const std::vector<vec4> &palette);
+    unsigned int upload_morph();
 };
 
 struct MD5ACTION {
     char			name[ MAX_CHAR ] = "";
 
-    std::vector<std::vector<MD5JOINT> >   frame;
+    // Shared frames; the MD5 holding the action releases them.
+    MD5ANIM			*md5anim;
 
     std::vector<MD5JOINT>   pose;
 
+    // curr_frame and next_frame decoded from md5anim, see decode_frame().
+    std::vector<MD5JOINT>   frame_pose[ 2 ];
+
+    int			decoded_frame[ 2 ];
+
     int			curr_frame;
 
     int			next_frame;
@@ -251,14 +617,21 @@ public:
     void action_pause();
     void action_stop();
     void set_action_fps(float fps);
+    void decode_frame(const std::vector<unsigned int> *joint=NULL);
 };
 
+// One character: a shared MD5MODEL and MD5ANIMs, plus what differs from
+// one instance to the next, the pose, action cursors, transform and
+// skinned vertices or palette.
 struct MD5 {
     char		name[ MAX_CHAR ] = "";
 
     bool                visible;
 
-    std::vector<MD5JOINT>    bind_pose;
+    MD5MODEL		*md5model;
+
+    // The bind pose of md5model.
+    const std::vector<MD5JOINT> &bind_pose;
 
     std::vector<MD5MESH>     md5mesh;
 
@@ -281,18 +654,72 @@ struct MD5 {
     float		distance;
 
     btRigidBody		*btrigidbody;
+
+    // Set by build_skin(): set_pose() fills palette instead of skinning
+    // the vertices on the CPU, but for the meshes build_skin_vbo() left
+    // to the CPU.  Those are skinned wherever compute_pose() runs, and
+    // drawn by the same shader as the others with an identity palette.
+    bool		gpu_skin;
+
+    // 3 rows of the joint matrix taking the bind pose to the current pose,
+    // for every joint.
+    std::vector<vec4>	palette;
+
+    // Bytes of vertex data sent by the last set_pose(), and joints sent
+    // by the last draw().
+    unsigned int	n_vertex_upload;
+
+    unsigned int	n_palette_upload;
+
+    // Threads skinning the vertices on the CPU, 1 to MD5_MAX_THREAD.
+    unsigned int	n_thread;
+
+    // Joints of the current pose as 3x4 row major matrices, for the CPU
+    // skinning streams.
+    std::vector<float>	joint_matrix;
+
+    // Joints whose importance is below joint_lod are not sampled by
+    // draw_action(): they keep their bind pose offset from their parent.
+    // 0 samples every joint.
+    unsigned char	joint_lod;
 protected:
+    // Rows of the batch being drawn, reused from draw to draw.
+    std::vector<vec4>	batch_palette;
+
+    // Joints sampled and joints attached at sampled_joint_lod, rebuilt by
+    // draw_action() when joint_lod or the importance of the joints
+    // changes.
+    std::vector<unsigned int> sampled_joint;
+
+    std::vector<unsigned int> attached_joint;
+
+    int			sampled_joint_lod;
+
+    // MD5MODEL::joint_importance_serial when they were rebuilt.
+    unsigned int	sampled_joint_importance;
+
+    void update_joint_lod();
+    void attach_joints(std::vector<MD5JOINT> &pose) const;
+
     void update_bound_mesh();
+    void build_palette(const std::vector<MD5JOINT> &pose);
 public:
     MD5(char *filename, const bool relative_path);
-    ~MD5() {}
+    ~MD5();
     int load_action(char *name, char *filename, const bool relative_path);
     void free_mesh_data();
     MD5ACTION *get_action(char *name, const bool exact_name);
     MD5MESH *get_mesh(char *name, const bool exact_name);
+    bool set_joint_importance(char *name, unsigned char importance);
+    unsigned int get_attached_joint_count() const { return this->attached_joint.size(); }
     void optimize(unsigned int vertex_cache_size);
     void build_bind_pose_weighted_normals_tangents();
-    void set_pose(std::vector<MD5JOINT> &pose);
+    void set_pose(const std::vector<MD5JOINT> &pose);
+    void compute_pose(const std::vector<MD5JOINT> &pose);
+    void upload_pose(const bool back=false);
+    void swap_vertex_data();
+    void update_bound_pose(const std::vector<MD5JOINT> &pose);
+    void get_bound_mesh(vec3 &min, vec3 &max) const;
     void blend_pose(std::vector<MD5JOINT> &final_pose,
                     const std::vector<MD5JOINT> &pose0,
                     const std::vector<MD5JOINT> &pose1,
@@ -305,8 +732,15 @@ public:
                   const float action_weight);
     void build();
     void build2();
+    void build_skin();
     bool draw_action(float time_step);
     void draw();
+protected:
+    void build_model();
+    void draw_skin(MD5MESH *md5mesh);
+private:
+    MD5(const MD5 &src);
+    MD5 &operator=(const MD5 &rhs);
 };
 
 #endif
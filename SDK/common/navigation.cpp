@@ -79,7 +79,7 @@ NAVIGATION::~NAVIGATION()
         dtFreeNavMesh(this->dtnavmesh);
 
     if (this->program)
-        delete this->program;
+        RESOURCE::release_program(this->program);
 }
 
 	
@@ -402,23 +402,13 @@ bool NAVIGATION::get_path(NAVIGATIONPATH *navigationpath, NAVIGATIONPATHDATA *na
 void NAVIGATION::draw(GFX *gfx)
 {
     if (!this->program) {
-        this->program = new PROGRAM(this->name);
-
-        this->program->vertex_shader = new SHADER(this->name, GL_VERTEX_SHADER);
-
-        this->program->vertex_shader->compile("uniform highp mat4 MODELVIEWPROJECTIONMATRIX;"
-                                              "attribute highp vec3 POSITION;"
-                                              "void main( void ) {"
-                                              "gl_Position = MODELVIEWPROJECTIONMATRIX * vec4( POSITION, 1.0 ); }",
-                                              false);
-
-        this->program->fragment_shader = new SHADER(this->name, GL_FRAGMENT_SHADER);
-
-        this->program->fragment_shader->compile("void main( void ) {"
-                                                "gl_FragColor = vec4( 0.25, 0.5, 1.0, 0.65 ); }",
-                                                false);
-
-        this->program->link(false);
+        this->program = RESOURCE::acquire_program("NAVIGATION",
+                                                  "uniform highp mat4 MODELVIEWPROJECTIONMATRIX;"
+                                                  "attribute highp vec3 POSITION;"
+                                                  "void main( void ) {"
+                                                  "gl_Position = MODELVIEWPROJECTIONMATRIX * vec4( POSITION, 1.0 ); }",
+                                                  "void main( void ) {"
+                                                  "gl_FragColor = vec4( 0.25, 0.5, 1.0, 0.65 ); }");
     }
 
     char vertex_attribute = this->program->get_vertex_attrib_location(VA_Position_String);
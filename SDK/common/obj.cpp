@@ -80,7 +80,8 @@ OBJMESH::OBJMESH(OBJ *parent) : name(""), visible(false), group(""),
                                 dimension(0,0,0), radius(0.0f),
                                 distance(0.0f), vbo(0), stride(0),
                                 size(0), vao(0), btrigidbody(NULL),
-                                use_smooth_normals(false), parent(parent)
+                                use_smooth_normals(false), occluder(false),
+                                parent(parent)
 {}
 
 OBJMESH::OBJMESH(char *name, bool visible, char *group, float scale_x,
@@ -91,7 +92,7 @@ OBJMESH::OBJMESH(char *name, bool visible, char *group, float scale_x,
     min(FLT_MAX,FLT_MAX,FLT_MAX), max(-FLT_MAX,-FLT_MAX,-FLT_MAX),
     dimension(0,0,0), radius(0.0f), distance(distance), vbo(0),
     stride(0), size(0), vao(0), btrigidbody(NULL),
-    use_smooth_normals(use_smooth_normals), parent(parent)
+    use_smooth_normals(use_smooth_normals), occluder(false), parent(parent)
 {
     assert(name==NULL || strlen(name) < sizeof(this->name));
     strcpy(this->name, name ? name : "");
@@ -125,6 +126,7 @@ OBJMESH::OBJMESH(const OBJMESH &src) :
     vao(src.vao),
     btrigidbody(src.btrigidbody),
     use_smooth_normals(src.use_smooth_normals),
+    occluder(src.occluder),
     parent(src.parent)
 {
     strcpy(name, src.name);
@@ -163,6 +165,7 @@ OBJMESH &OBJMESH::operator=(const OBJMESH &rhs)
         vao = rhs.vao;
         btrigidbody = rhs.btrigidbody;
         use_smooth_normals = rhs.use_smooth_normals;
+        occluder = rhs.occluder;
 
         parent = rhs.parent;
     }
@@ -964,6 +967,25 @@ void OBJMESH::free_vertex_data()
 }
 
 
+// Append the three vertices of every triangle, through all the triangle
+// lists in order, relative to location.  The triangle indices are released
+// by free_vertex_data(), so this has to be called before it.
+void OBJMESH::get_triangles(std::vector<vec3> &vertex) const
+{
+    for (auto objtrianglelist=this->objtrianglelist.begin();
+         objtrianglelist!=this->objtrianglelist.end(); ++objtrianglelist) {
+        for (auto objtriangleindex=objtrianglelist->objtriangleindex.begin();
+             objtriangleindex!=objtrianglelist->objtriangleindex.end();
+             ++objtriangleindex) {
+            for (int i=0; i!=3; ++i) {
+                vertex.push_back(this->parent->indexed_vertex[objtriangleindex->vertex_index[i]] -
+                                 this->location);
+            }
+        }
+    }
+}
+
+
 bool OBJ::load_mtl(char *filename, const bool relative_path)
 {
     MEMORY *m = new MEMORY(filename, relative_path);
@@ -217,7 +217,10 @@ enum VertexAttribute {  // Use with glBindAttribLocation()
     VA_Normal    = 1,
     VA_TexCoord0 = 2,
     VA_Tangent0  = 3,
-    VA_FNormal   = 4
+    VA_FNormal   = 4,
+    VA_Joint     = 5,
+    VA_Weight    = 6,
+    VA_Morph     = 7
     };
 
 #define VA_Position_String  ((char *)"POSITION")
@@ -225,6 +228,9 @@ enum VertexAttribute {  // Use with glBindAttribLocation()
 #define VA_TexCoord0_String ((char *)"TEXCOORD0")
 #define VA_Tangent0_String  ((char *)"TANGENT0")
 #define VA_FNormal_String   ((char *)"FNORMAL")
+#define VA_Joint_String     ((char *)"JOINT")
+#define VA_Weight_String    ((char *)"WEIGHT")
+#define VA_Morph_String     ((char *)"MORPH")
 
 #define OFFSET_NO_TEXCOORD_NEEDED  (~0)
 
@@ -271,6 +277,9 @@ struct OBJMESH {
     btRigidBody                     *btrigidbody;
     
     bool                            use_smooth_normals;
+
+    // Rasterized into the OCCLUSION depth buffer to hide what is behind.
+    bool                            occluder;
     
     const OBJ                       *parent;
 
@@ -293,6 +302,7 @@ public:
     void draw2();
     void draw3(GFX *gfx);
     void free_vertex_data();
+    void get_triangles(std::vector<vec3> &vertex) const;
 };
 
 
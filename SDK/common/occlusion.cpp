@@ -0,0 +1,326 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+// Whether a clip space point lies past the near plane, z >= -w, where the
+// GPU keeps it.  Triangles with a vertex in front of it would need
+// clipping; they are simply not drawn, which can only make the occlusion
+// less aggressive.  Points behind the eye fail the test as well, so w is
+// safe to divide by when it passes.
+static inline bool occlusion_past_near(const vec4 &p)
+{
+    return p->z >= -p->w && p->w > 0.0f;
+}
+
+
+OCCLUSION::OCCLUSION(unsigned short width, unsigned short height) :
+    modelview_projection_matrix(1), n_triangle(0), n_tested(0), n_culled(0)
+{
+    // The rasterizer writes four pixels at a time.
+    width = (width + 3) & ~3;
+
+    assert(width && height);
+
+    do {
+        OCCLUSIONLEVEL occlusionlevel;
+
+        occlusionlevel.width  = width;
+        occlusionlevel.height = height;
+        occlusionlevel.depth.resize(width * height, 1.0f);
+
+        this->level.push_back(occlusionlevel);
+
+        width  = (width  + 1) >> 1;
+        height = (height + 1) >> 1;
+    } while (this->level.back().width  > 1 ||
+             this->level.back().height > 1);
+}
+
+
+void OCCLUSION::add(OBJMESH *objmesh)
+{
+    OCCLUDER occluder;
+
+    occluder.objmesh = objmesh;
+
+    objmesh->get_triangles(occluder.vertex);
+
+    if (occluder.vertex.empty()) {
+        console_print("OCCLUSION: %s has no triangle data left, skipping.\n",
+                      objmesh->name);
+        return;
+    }
+
+    objmesh->occluder = true;
+
+    this->occluder.push_back(occluder);
+}
+
+
+// Add every mesh of obj flagged as an occluder.
+void OCCLUSION::add(OBJ *obj)
+{
+    for (auto objmesh=obj->objmesh.begin();
+         objmesh!=obj->objmesh.end(); ++objmesh) {
+        if (objmesh->occluder) this->add(&(*objmesh));
+    }
+}
+
+
+// Redraw the occluders from the camera described by the two matrices, and
+// rebuild the hierarchy.  Call once per frame before is_visible().
+void OCCLUSION::update(const mat4 &modelview_matrix,
+                       const mat4 &projection_matrix)
+{
+    std::vector<float> &depth = this->level[0].depth;
+
+    std::fill(depth.begin(), depth.end(), 1.0f);
+
+    this->modelview_projection_matrix = modelview_matrix * projection_matrix;
+
+    this->n_triangle = 0;
+    this->n_tested   = 0;
+    this->n_culled   = 0;
+
+    for (auto occluder=this->occluder.begin();
+         occluder!=this->occluder.end(); ++occluder) {
+        if (!occluder->objmesh->visible) continue;
+
+        // Fold the mesh location into the matrix once per mesh.
+        mat4 m = this->modelview_projection_matrix;
+
+        vec4 t = vec4(occluder->objmesh->location, 1.0f) * m;
+
+        m[3] = t;
+
+        for (unsigned int i=0; i!=occluder->vertex.size(); i+=3) {
+            vec4 a = vec4(occluder->vertex[i    ], 1.0f) * m,
+                 b = vec4(occluder->vertex[i + 1], 1.0f) * m,
+                 c = vec4(occluder->vertex[i + 2], 1.0f) * m;
+
+            if (!occlusion_past_near(a) ||
+                !occlusion_past_near(b) ||
+                !occlusion_past_near(c)) continue;
+
+            this->rasterize(a, b, c);
+        }
+    }
+
+    this->build_hierarchy();
+}
+
+
+// Half space rasterization of one clip space triangle into level 0.  Both
+// faces are drawn, and only pixels whose center is strictly inside are
+// touched, so that the buffer never claims more coverage than the
+// occluders really have.
+void OCCLUSION::rasterize(const vec4 &a, const vec4 &b, const vec4 &c)
+{
+    OCCLUSIONLEVEL *occlusionlevel = &this->level[0];
+
+    float w = occlusionlevel->width,
+          h = occlusionlevel->height;
+
+    float ax = (a->x / a->w * 0.5f + 0.5f) * w, ay = (a->y / a->w * 0.5f + 0.5f) * h, az = a->z / a->w,
+          bx = (b->x / b->w * 0.5f + 0.5f) * w, by = (b->y / b->w * 0.5f + 0.5f) * h, bz = b->z / b->w,
+          cx = (c->x / c->w * 0.5f + 0.5f) * w, cy = (c->y / c->w * 0.5f + 0.5f) * h, cz = c->z / c->w;
+
+    float area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+
+    if (area == 0.0f) return;
+
+    // Make the triangle counterclockwise so the three edge functions are
+    // positive inside.
+    if (area < 0.0f) {
+        float t;
+
+        t = bx; bx = cx; cx = t;
+        t = by; by = cy; cy = t;
+        t = bz; bz = cz; cz = t;
+
+        area = -area;
+    }
+
+    int xmin = floorf(fminf(ax, fminf(bx, cx))),
+        xmax = ceilf (fmaxf(ax, fmaxf(bx, cx))),
+        ymin = floorf(fminf(ay, fminf(by, cy))),
+        ymax = ceilf (fmaxf(ay, fmaxf(by, cy)));
+
+    if (xmin < 0) xmin = 0;
+    if (ymin < 0) ymin = 0;
+    if (xmax > occlusionlevel->width  - 1) xmax = occlusionlevel->width  - 1;
+    if (ymax > occlusionlevel->height - 1) ymax = occlusionlevel->height - 1;
+
+    if (xmin > xmax || ymin > ymax) return;
+
+    xmin &= ~3;
+
+    ++this->n_triangle;
+
+    // e(x, y) = A * x + B * y + C for the edges facing a, b and c.
+    float A0 = by - cy, B0 = cx - bx, C0 = bx * cy - by * cx,
+          A1 = cy - ay, B1 = ax - cx, C1 = cx * ay - cy * ax,
+          A2 = ay - by, B2 = bx - ax, C2 = ax * by - ay * bx;
+
+    // Depth is linear in screen space: the edge functions divided by the
+    // area are the barycentric coordinates.
+    float inv_area = 1.0f / area,
+          zA = (A0 * az + A1 * bz + A2 * cz) * inv_area,
+          zB = (B0 * az + B1 * bz + B2 * cz) * inv_area,
+          zC = (C0 * az + C1 * bz + C2 * cz) * inv_area;
+
+    static const float lane[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+
+    SIMDFLOAT4 zero = simd_splat(0.0f),
+               step = simd_load(lane);
+
+    for (int y=ymin; y<=ymax; ++y) {
+        float py = y + 0.5f;
+
+        float *depth = &occlusionlevel->depth[y * occlusionlevel->width];
+
+        SIMDFLOAT4 r0 = simd_splat(B0 * py + C0),
+                   r1 = simd_splat(B1 * py + C1),
+                   r2 = simd_splat(B2 * py + C2),
+                   rz = simd_splat(zB * py + zC);
+
+        for (int x=xmin; x<=xmax; x+=4) {
+            SIMDFLOAT4 px = simd_add(simd_splat(x), step);
+
+            SIMDMASK4 inside = simd_and(simd_lt(zero, simd_madd(simd_splat(A0), px, r0)),
+                               simd_and(simd_lt(zero, simd_madd(simd_splat(A1), px, r1)),
+                                        simd_lt(zero, simd_madd(simd_splat(A2), px, r2))));
+
+            if (!simd_bits(inside)) continue;
+
+            SIMDFLOAT4 z   = simd_madd(simd_splat(zA), px, rz),
+                       old = simd_load(&depth[x]);
+
+            simd_store(&depth[x], simd_select(inside, simd_min(old, z), old));
+        }
+    }
+}
+
+
+// Each texel of a level keeps the farthest depth of the up to 2x2 texels
+// below it.
+void OCCLUSION::build_hierarchy()
+{
+    for (unsigned int l=1; l!=this->level.size(); ++l) {
+        const OCCLUSIONLEVEL *src = &this->level[l - 1];
+
+        OCCLUSIONLEVEL *dst = &this->level[l];
+
+        for (int y=0; y!=dst->height; ++y) {
+            int y0 = y << 1,
+                y1 = y0 + 1 < src->height ? y0 + 1 : y0;
+
+            for (int x=0; x!=dst->width; ++x) {
+                int x0 = x << 1,
+                    x1 = x0 + 1 < src->width ? x0 + 1 : x0;
+
+                dst->depth[y * dst->width + x] =
+                    fmaxf(fmaxf(src->depth[y0 * src->width + x0],
+                                src->depth[y0 * src->width + x1]),
+                          fmaxf(src->depth[y1 * src->width + x0],
+                                src->depth[y1 * src->width + x1]));
+            }
+        }
+    }
+}
+
+
+// Test a world space box against the current occluders.  Boxes crossing
+// the near plane, or off screen, are reported visible and left to the
+// frustum culling.
+bool OCCLUSION::is_visible(const vec3 &min, const vec3 &max)
+{
+    float xmin =  FLT_MAX, ymin =  FLT_MAX, zmin = FLT_MAX,
+          xmax = -FLT_MAX, ymax = -FLT_MAX;
+
+    ++this->n_tested;
+
+    for (int i=0; i!=8; ++i) {
+        vec4 p = vec4(i & 1 ? max->x : min->x,
+                      i & 2 ? max->y : min->y,
+                      i & 4 ? max->z : min->z,
+                      1.0f) * this->modelview_projection_matrix;
+
+        if (!occlusion_past_near(p)) return true;
+
+        float x = p->x / p->w,
+              y = p->y / p->w,
+              z = p->z / p->w;
+
+        if (x < xmin) xmin = x;
+        if (x > xmax) xmax = x;
+        if (y < ymin) ymin = y;
+        if (y > ymax) ymax = y;
+        if (z < zmin) zmin = z;
+    }
+
+    const OCCLUSIONLEVEL *occlusionlevel = &this->level[0];
+
+    int x0 = floorf((xmin * 0.5f + 0.5f) * occlusionlevel->width),
+        x1 = floorf((xmax * 0.5f + 0.5f) * occlusionlevel->width),
+        y0 = floorf((ymin * 0.5f + 0.5f) * occlusionlevel->height),
+        y1 = floorf((ymax * 0.5f + 0.5f) * occlusionlevel->height);
+
+    if (x1 < 0 || y1 < 0 ||
+        x0 >= occlusionlevel->width || y0 >= occlusionlevel->height)
+        return true;
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > occlusionlevel->width  - 1) x1 = occlusionlevel->width  - 1;
+    if (y1 > occlusionlevel->height - 1) y1 = occlusionlevel->height - 1;
+
+    unsigned int l = 0;
+
+    while (l + 1 != this->level.size() &&
+           ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) ++l;
+
+    occlusionlevel = &this->level[l];
+
+    for (int y=y0 >> l; y<=y1 >> l; ++y) {
+        for (int x=x0 >> l; x<=x1 >> l; ++x) {
+            if (zmin <= occlusionlevel->depth[y * occlusionlevel->width + x])
+                return true;
+        }
+    }
+
+    ++this->n_culled;
+
+    return false;
+}
+
+
+bool OCCLUSION::is_visible(OBJMESH *objmesh)
+{
+    vec3 half = objmesh->dimension * 0.5f;
+
+    return this->is_visible(objmesh->location - half,
+                            objmesh->location + half);
+}
@@ -0,0 +1,83 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Software occlusion culling.  The meshes flagged as occluders are
+ * rasterized, four pixels at a time, into a small CPU depth buffer, which
+ * is then reduced into a hierarchical Z pyramid holding the farthest depth
+ * of each texel.  A candidate is hidden when the nearest point of its
+ * screen space bounds is behind every texel its rectangle covers, at the
+ * pyramid level where that rectangle spans at most 2x2 texels.  Nothing
+ * touches the GPU.
+ */
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+
+struct OCCLUSIONLEVEL {
+    unsigned short	width;
+
+    unsigned short	height;
+
+    // Normalized device depth, -1 near to 1 far.
+    std::vector<float>	depth;
+};
+
+
+struct OCCLUDER {
+    OBJMESH		*objmesh;
+
+    // Three vertices per triangle, relative to objmesh->location.
+    std::vector<vec3>	vertex;
+};
+
+
+struct OCCLUSION {
+    // Level 0 is the depth buffer itself.
+    std::vector<OCCLUSIONLEVEL>	level;
+
+    std::vector<OCCLUDER>	occluder;
+
+    mat4			modelview_projection_matrix;
+
+    // Counters for the current frame, reset by update().
+    unsigned int		n_triangle;
+
+    unsigned int		n_tested;
+
+    unsigned int		n_culled;
+
+public:
+    OCCLUSION(unsigned short width=256, unsigned short height=128);
+    ~OCCLUSION() {}
+    void add(OBJMESH *objmesh);
+    void add(OBJ *obj);
+    void update(const mat4 &modelview_matrix, const mat4 &projection_matrix);
+    bool is_visible(const vec3 &min, const vec3 &max);
+    bool is_visible(OBJMESH *objmesh);
+private:
+    void rasterize(const vec4 &a, const vec4 &b, const vec4 &c);
+    void build_hierarchy();
+};
+
+#endif
@@ -0,0 +1,227 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+// Moller-Trumbore, accepting both faces so that picking does not depend on
+// the culling state.  userdata points to the three vertices of the
+// triangle, in mesh space.
+static bool PICKER_triangle(void        *userdata,
+                            const vec3  &origin,
+                            const vec3  &direction,
+                            float       *distance)
+{
+    const vec3 *v = (const vec3 *)userdata;
+
+    vec3 e1 = v[1] - v[0],
+         e2 = v[2] - v[0],
+         p  = direction.crossProduct(e2);
+
+    float det = e1.dotProduct(p);
+
+    if (fabsf(det) < 1e-8f) return false;
+
+    float inv_det = 1.0f / det;
+
+    vec3 s = origin - v[0];
+
+    float u = s.dotProduct(p) * inv_det;
+
+    if (u < 0.0f || u > 1.0f) return false;
+
+    vec3 q = s.crossProduct(e1);
+
+    float w = direction.dotProduct(q) * inv_det;
+
+    if (w < 0.0f || u + w > 1.0f) return false;
+
+    float t = e2.dotProduct(q) * inv_det;
+
+    if (t < 0.0f || t >= *distance) return false;
+
+    *distance = t;
+
+    return true;
+}
+
+
+// Mesh level test: move the ray into mesh space and cast it against the
+// triangles.  userdata is the PICKMESH.
+static bool PICKER_mesh(void        *userdata,
+                        const vec3  &origin,
+                        const vec3  &direction,
+                        float       *distance)
+{
+    PICKMESH *pickmesh = (PICKMESH *)userdata;
+
+    if (!pickmesh->objmesh->visible) return false;
+
+    int triangle = pickmesh->bvh.ray_cast(origin - pickmesh->objmesh->location,
+                                          direction,
+                                          distance,
+                                          PICKER_triangle);
+
+    pickmesh->picker->n_triangle_test += pickmesh->bvh.n_item_test;
+
+    if (triangle == -1) return false;
+
+    pickmesh->hit_triangle = triangle;
+
+    return true;
+}
+
+
+PICKMESH::PICKMESH(OBJMESH *objmesh, PICKER *picker) :
+    objmesh(objmesh), picker(picker), hit_triangle(0)
+{
+    objmesh->get_triangles(this->vertex);
+
+    // The vector is complete, so the item pointers into it stay valid.
+    for (unsigned int i=0; i!=this->vertex.size(); i+=3) {
+        vec3 min = this->vertex[i],
+             max = this->vertex[i];
+
+        for (int j=1; j!=3; ++j) {
+            for (int k=0; k!=3; ++k) {
+                if (this->vertex[i+j][k] < min[k]) min[k] = this->vertex[i+j][k];
+                if (this->vertex[i+j][k] > max[k]) max[k] = this->vertex[i+j][k];
+            }
+        }
+
+        this->bvh.add(min, max, &this->vertex[i]);
+    }
+
+    this->bvh.build();
+}
+
+
+PICKER::~PICKER()
+{
+    for (auto pickmesh=this->pickmesh.begin();
+         pickmesh!=this->pickmesh.end(); ++pickmesh) {
+        delete *pickmesh;
+    }
+}
+
+
+void PICKER::add(OBJMESH *objmesh)
+{
+    if (objmesh->objtrianglelist.empty() ||
+        objmesh->objtrianglelist[0].objtriangleindex.empty()) {
+        console_print("PICKER: %s has no triangle data left, skipping.\n",
+                      objmesh->name);
+        return;
+    }
+
+    PICKMESH *pickmesh = new PICKMESH(objmesh, this);
+
+    this->pickmesh.push_back(pickmesh);
+
+    vec3 half = objmesh->dimension * 0.5f;
+
+    this->bvh.add(objmesh->location - half, objmesh->location + half, pickmesh);
+}
+
+
+void PICKER::add(OBJ *obj)
+{
+    for (auto objmesh=obj->objmesh.begin();
+         objmesh!=obj->objmesh.end(); ++objmesh) {
+        this->add(&(*objmesh));
+    }
+}
+
+
+// Call once all the meshes are added.
+void PICKER::build()
+{
+    this->bvh.build();
+}
+
+
+// Follow the meshes to their current location; the triangle BVHs are in
+// mesh space and never need to be touched.
+void PICKER::refit()
+{
+    for (unsigned int i=0; i!=this->pickmesh.size(); ++i) {
+        OBJMESH *objmesh = this->pickmesh[i]->objmesh;
+
+        vec3 half = objmesh->dimension * 0.5f;
+
+        this->bvh.set_bounds(i, objmesh->location - half, objmesh->location + half);
+    }
+
+    this->bvh.refit();
+}
+
+
+// Closest visible mesh hit by the ray within distance.  direction does not
+// need to be normalized; the returned distance is then in units of its
+// length.
+bool PICKER::ray_cast(const vec3    &origin,
+                      const vec3    &direction,
+                      float         distance,
+                      PICKHIT       *pickhit)
+{
+    this->n_triangle_test = 0;
+
+    int index = this->bvh.ray_cast(origin, direction, &distance, PICKER_mesh);
+
+    if (index == -1) return false;
+
+    PICKMESH *pickmesh = this->pickmesh[index];
+
+    pickhit->objmesh  = pickmesh->objmesh;
+    pickhit->triangle = pickmesh->hit_triangle;
+    pickhit->distance = distance;
+    pickhit->location = origin + direction * distance;
+
+    return true;
+}
+
+
+// Pick at a touch location, y going down from the top of the viewport as
+// the touch callbacks report it, using the current model view (the camera)
+// and projection matrices of gfx.
+bool PICKER::pick(GFX *gfx, float x, float y, const int *viewport_matrix,
+                  PICKHIT *pickhit)
+{
+    vec3 near, far;
+
+    y = viewport_matrix[3] - y;
+
+    if (!gfx->unproject(x, y, 0.0f,
+                        gfx->get_modelview_matrix(),
+                        gfx->get_projection_matrix(),
+                        viewport_matrix,
+                        near) ||
+        !gfx->unproject(x, y, 1.0f,
+                        gfx->get_modelview_matrix(),
+                        gfx->get_projection_matrix(),
+                        viewport_matrix,
+                        far))
+        return false;
+
+    return this->ray_cast(near, far - near, 1.0f, pickhit);
+}
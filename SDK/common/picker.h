@@ -0,0 +1,104 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * CPU picking.  A touch is unprojected into a ray, the ray is cast against
+ * a BVH over the mesh bounds, and the meshes it reaches are then tested
+ * triangle by triangle through a BVH of their own.  Nothing is rendered
+ * and nothing is read back from the GPU.
+ *
+ * The triangles are copied from OBJMESH::objtrianglelist, so meshes have to
+ * be added before OBJMESH::free_vertex_data() is called.  Like the draw
+ * loops of the chapter apps, picking assumes that a mesh is only moved by
+ * its location.
+ */
+
+#ifndef PICKER_H
+#define PICKER_H
+
+
+struct PICKER;
+
+
+struct PICKHIT {
+    OBJMESH		*objmesh;
+
+    // Index of the triangle in the mesh, counting through its triangle
+    // lists in order.
+    unsigned int	triangle;
+
+    // World space hit point, and its distance from the ray origin.
+    vec3		location;
+
+    float		distance;
+};
+
+
+struct PICKMESH {
+    OBJMESH		*objmesh;
+
+    PICKER		*picker;
+
+    // Three vertices per triangle, relative to objmesh->location.
+    std::vector<vec3>	vertex;
+
+    // One item per triangle.
+    BVH			bvh;
+
+    // Set by the triangle test when it finds a closer hit.
+    unsigned int	hit_triangle;
+
+public:
+    PICKMESH(OBJMESH *objmesh, PICKER *picker);
+    ~PICKMESH() {}
+private:
+    PICKMESH(const PICKMESH &src);
+    PICKMESH &operator=(const PICKMESH &rhs);
+};
+
+
+struct PICKER {
+    std::vector<PICKMESH *>	pickmesh;
+
+    // One item per PICKMESH, bounding the mesh at its current location.
+    BVH				bvh;
+
+    // Triangles tested by the last pick() or ray_cast().
+    unsigned int		n_triangle_test;
+
+public:
+    PICKER() : n_triangle_test(0) {}
+    ~PICKER();
+    void add(OBJMESH *objmesh);
+    void add(OBJ *obj);
+    void build();
+    void refit();
+    bool ray_cast(const vec3 &origin, const vec3 &direction, float distance,
+                  PICKHIT *pickhit);
+    bool pick(GFX *gfx, float x, float y, const int *viewport_matrix,
+              PICKHIT *pickhit);
+private:
+    PICKER(const PICKER &src);
+    PICKER &operator=(const PICKER &rhs);
+};
+
+#endif
@@ -0,0 +1,414 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+static inline bool PORTAL_overlap(const vec3 &min0, const vec3 &max0,
+                                  const vec3 &min1, const vec3 &max1,
+                                  float epsilon)
+{
+    for (int i=0; i!=3; ++i) {
+        if (max0[i] + epsilon < min1[i] || max1[i] + epsilon < min0[i])
+            return false;
+    }
+
+    return true;
+}
+
+
+// Sutherland-Hodgman clipping of a convex polygon, keeping what is in
+// front of every plane.
+static void PORTAL_clip(std::vector<vec3> &polygon,
+                        const vec4 *plane, unsigned int count)
+{
+    std::vector<vec3> clipped;
+
+    for (unsigned int i=0; i!=count && polygon.size() >= 3; ++i) {
+        clipped.clear();
+
+        for (unsigned int j=0; j!=polygon.size(); ++j) {
+            const vec3 &a = polygon[j],
+                       &b = polygon[(j + 1) % polygon.size()];
+
+            float da = plane[i].dotProduct(vec4(a, 1.0f)),
+                  db = plane[i].dotProduct(vec4(b, 1.0f));
+
+            if (da >= 0.0f) clipped.push_back(a);
+
+            if ((da >= 0.0f) != (db >= 0.0f))
+                clipped.push_back(a + (b - a) * (da / (da - db)));
+        }
+
+        polygon.swap(clipped);
+    }
+}
+
+
+PORTALSYSTEM::PORTALSYSTEM(OBJ *obj) :
+    obj(obj), camera_cell(-1), n_visible_cell(0), n_portal_test(0),
+    n_mesh_test(0), frame(0)
+{
+    std::vector<unsigned int> portal_mesh;
+
+    for (unsigned int i=0; i!=obj->objmesh.size(); ++i) {
+        OBJMESH *objmesh = &obj->objmesh[i];
+
+        if (!strncmp(objmesh->name, "cell", 4)) {
+            PORTALCELL portalcell;
+
+            vec3 half = objmesh->dimension * 0.5f;
+
+            portalcell.objmesh = objmesh;
+            portalcell.min     = objmesh->location - half;
+            portalcell.max     = objmesh->location + half;
+            portalcell.visible = false;
+
+            this->portalcell.push_back(portalcell);
+
+            objmesh->visible = false;
+        } else if (!strncmp(objmesh->name, "portal", 6)) {
+            portal_mesh.push_back(i);
+
+            objmesh->visible = false;
+        }
+    }
+
+    for (unsigned int i=0; i!=portal_mesh.size(); ++i) {
+        OBJMESH *objmesh = &obj->objmesh[portal_mesh[i]];
+
+        vec3 half = objmesh->dimension * 0.5f,
+             min  = objmesh->location - half,
+             max  = objmesh->location + half;
+
+        PORTAL portal;
+
+        unsigned int n_cell = 0;
+
+        // A portal lies on the boundary between its two cells, so give
+        // the overlap test some slack.
+        float epsilon = 0.01f * objmesh->radius + 1e-4f;
+
+        for (unsigned int j=0; j!=this->portalcell.size(); ++j) {
+            if (PORTAL_overlap(min, max,
+                               this->portalcell[j].min,
+                               this->portalcell[j].max,
+                               epsilon)) {
+                if (n_cell < 2) portal.cell[n_cell] = j;
+
+                ++n_cell;
+            }
+        }
+
+        if (n_cell != 2) {
+            console_print("PORTALSYSTEM: %s touches %d cells instead of 2, skipping.\n",
+                          objmesh->name, n_cell);
+            continue;
+        }
+
+        int axis = 0;
+
+        if (objmesh->dimension[1] < objmesh->dimension[axis]) axis = 1;
+        if (objmesh->dimension[2] < objmesh->dimension[axis]) axis = 2;
+
+        int u = (axis + 1) % 3,
+            v = (axis + 2) % 3;
+
+        for (int j=0; j!=4; ++j) {
+            portal.vertex[j][axis] = objmesh->location[axis];
+            portal.vertex[j][u]    = (j == 1 || j == 2) ? max[u] : min[u];
+            portal.vertex[j][v]    = (j >= 2)           ? max[v] : min[v];
+        }
+
+        portal.objmesh = objmesh;
+
+        this->portalcell[portal.cell[0]].portal.push_back(this->portal.size());
+        this->portalcell[portal.cell[1]].portal.push_back(this->portal.size());
+
+        this->portal.push_back(portal);
+    }
+
+    this->mesh_cell.resize(obj->objmesh.size());
+
+    this->stamp.resize(obj->objmesh.size(), 0);
+
+    this->on_path.resize(this->portalcell.size(), 0);
+
+    for (unsigned int i=0; i!=obj->objmesh.size(); ++i) {
+        if (strncmp(obj->objmesh[i].name, "cell",   4) &&
+            strncmp(obj->objmesh[i].name, "portal", 6))
+            this->relocate(i);
+    }
+}
+
+
+// Sort a mesh back into the cells its box overlaps; call after moving it.
+void PORTALSYSTEM::relocate(unsigned int mesh_index)
+{
+    OBJMESH *objmesh = &this->obj->objmesh[mesh_index];
+
+    std::vector<unsigned int> &mesh_cell = this->mesh_cell[mesh_index];
+
+    for (unsigned int i=0; i!=mesh_cell.size(); ++i) {
+        std::vector<unsigned int> &mesh = this->portalcell[mesh_cell[i]].mesh;
+
+        mesh.erase(std::find(mesh.begin(), mesh.end(), mesh_index));
+    }
+
+    if (mesh_cell.empty()) {
+        auto it = std::find(this->outside.begin(), this->outside.end(), mesh_index);
+
+        if (it != this->outside.end()) this->outside.erase(it);
+    }
+
+    mesh_cell.clear();
+
+    vec3 half = objmesh->dimension * 0.5f,
+         min  = objmesh->location - half,
+         max  = objmesh->location + half;
+
+    for (unsigned int i=0; i!=this->portalcell.size(); ++i) {
+        if (PORTAL_overlap(min, max,
+                           this->portalcell[i].min,
+                           this->portalcell[i].max,
+                           0.0f)) {
+            mesh_cell.push_back(i);
+
+            this->portalcell[i].mesh.push_back(mesh_index);
+        }
+    }
+
+    if (mesh_cell.empty()) this->outside.push_back(mesh_index);
+}
+
+
+int PORTALSYSTEM::get_cell(const vec3 &location)
+{
+    for (unsigned int i=0; i!=this->portalcell.size(); ++i) {
+        if (PORTAL_overlap(location, location,
+                           this->portalcell[i].min,
+                           this->portalcell[i].max,
+                           0.0f))
+            return i;
+    }
+
+    return -1;
+}
+
+
+unsigned int PORTALSYSTEM::add_view(unsigned int cell, const vec4 *plane,
+                                    unsigned int count)
+{
+    PORTALVIEW portalview;
+
+    portalview.cell  = cell;
+    portalview.first = this->plane.size();
+    portalview.count = count;
+
+    this->plane.insert(this->plane.end(), plane, plane + count);
+
+    this->portalview.push_back(portalview);
+
+    this->portalcell[cell].visible = true;
+
+    return portalview.first;
+}
+
+
+// Find the visible cells for a camera at eye, frustum being the camera
+// frustum from build_frustum().  When the camera is outside every cell all
+// the cells are considered visible through the whole frustum.
+void PORTALSYSTEM::update(const vec3 &eye, vec4 *frustum)
+{
+    this->eye     = eye;
+    this->clip[0] = frustum[4];
+    this->clip[1] = frustum[5];
+
+    this->portalview.clear();
+    this->plane.clear();
+
+    this->n_visible_cell = 0;
+    this->n_portal_test  = 0;
+
+    for (unsigned int i=0; i!=this->portalcell.size(); ++i)
+        this->portalcell[i].visible = false;
+
+    this->camera_cell = this->get_cell(eye);
+
+    if (this->camera_cell == -1) {
+        this->plane.insert(this->plane.end(), frustum, frustum + 6);
+
+        for (unsigned int i=0; i!=this->portalcell.size(); ++i) {
+            PORTALVIEW portalview = { i, 0, 6 };
+
+            this->portalview.push_back(portalview);
+
+            this->portalcell[i].visible = true;
+        }
+    } else {
+        this->add_view(this->camera_cell, frustum, 6);
+
+        this->walk(this->camera_cell, 0, 6, 0);
+    }
+
+    for (unsigned int i=0; i!=this->portalcell.size(); ++i)
+        this->n_visible_cell += this->portalcell[i].visible;
+}
+
+
+// Look through every portal of cell that is still in sight of the planes
+// [first, first + count), and recurse into the cells behind with the
+// frustum reduced to the visible part of the portal.  Cells already on the
+// current path are skipped so that the walk cannot loop.
+void PORTALSYSTEM::walk(unsigned int cell, unsigned int first,
+                        unsigned int count, unsigned int depth)
+{
+    this->on_path[cell] = 1;
+
+    for (unsigned int i=0; i!=this->portalcell[cell].portal.size(); ++i) {
+        const PORTAL &portal = this->portal[this->portalcell[cell].portal[i]];
+
+        unsigned int next = portal.cell[0] == cell ? portal.cell[1] : portal.cell[0];
+
+        if (this->on_path[next]) continue;
+
+        ++this->n_portal_test;
+
+        std::vector<vec3> polygon(portal.vertex, portal.vertex + 4);
+
+        // Copy the planes; walking deeper appends to this->plane.
+        std::vector<vec4> parent(this->plane.begin() + first,
+                                 this->plane.begin() + first + count);
+
+        PORTAL_clip(polygon, &parent[0], count);
+
+        if (polygon.size() < 3) continue;
+
+        vec3 u      = portal.vertex[1] - portal.vertex[0],
+             normal = u.crossProduct(portal.vertex[3] - portal.vertex[0]),
+             center(0.0f, 0.0f, 0.0f);
+
+        for (unsigned int j=0; j!=polygon.size(); ++j) center += polygon[j];
+
+        center *= 1.0f / polygon.size();
+
+        normal = normal.normalize();
+
+        float d = normal.dotProduct(this->eye - portal.vertex[0]);
+
+        std::vector<vec4> reduced;
+
+        if (fabsf(d) < 1e-3f) {
+            // Standing in the portal: it cannot narrow anything.
+            reduced = parent;
+        } else {
+            // One plane through the eye and each edge of what is left of
+            // the portal, facing the center of it.
+            for (unsigned int j=0; j!=polygon.size(); ++j) {
+                vec3 a = polygon[j] - this->eye,
+                     n = a.crossProduct(polygon[(j + 1) % polygon.size()] - this->eye);
+
+                float l = n.length();
+
+                if (l < 1e-6f) continue;
+
+                n *= 1.0f / l;
+
+                vec4 p(n, -n.dotProduct(this->eye));
+
+                if (p.dotProduct(vec4(center, 1.0f)) < 0.0f) p = -p;
+
+                reduced.push_back(p);
+            }
+
+            // Only what is beyond the portal can be seen through it.
+            vec4 p(normal, -normal.dotProduct(portal.vertex[0]));
+
+            if (d > 0.0f) p = -p;
+
+            reduced.push_back(p);
+
+            reduced.push_back(this->clip[0]);
+            reduced.push_back(this->clip[1]);
+        }
+
+        unsigned int next_first = this->add_view(next, &reduced[0], reduced.size());
+
+        if (depth + 1 < PORTAL_MAX_DEPTH)
+            this->walk(next, next_first, reduced.size(), depth + 1);
+    }
+
+    this->on_path[cell] = 0;
+}
+
+
+// Append the indices of the visible meshes of the visible cells, each
+// tested as a sphere against the frusta its cells are seen through, and of
+// the meshes outside every cell that are in the camera frustum.
+void PORTALSYSTEM::get_visible_meshes(std::vector<unsigned int> &result)
+{
+    ++this->frame;
+
+    this->n_mesh_test = 0;
+
+    for (unsigned int i=0; i!=this->portalview.size(); ++i) {
+        const PORTALVIEW &portalview = this->portalview[i];
+
+        const std::vector<unsigned int> &mesh = this->portalcell[portalview.cell].mesh;
+
+        for (unsigned int j=0; j!=mesh.size(); ++j) {
+            OBJMESH *objmesh = &this->obj->objmesh[mesh[j]];
+
+            if (this->stamp[mesh[j]] == this->frame || !objmesh->visible)
+                continue;
+
+            ++this->n_mesh_test;
+
+            vec4 location(objmesh->location, 1.0f);
+
+            unsigned int k = 0;
+
+            while (k != portalview.count &&
+                   this->plane[portalview.first + k].dotProduct(location) >= -objmesh->radius) ++k;
+
+            if (k != portalview.count) continue;
+
+            this->stamp[mesh[j]] = this->frame;
+
+            result.push_back(mesh[j]);
+        }
+    }
+
+    for (unsigned int i=0; i!=this->outside.size(); ++i) {
+        OBJMESH *objmesh = &this->obj->objmesh[this->outside[i]];
+
+        if (!objmesh->visible) continue;
+
+        ++this->n_mesh_test;
+
+        if (sphere_distance_in_frustum(&this->plane[0],
+                                       &objmesh->location,
+                                       objmesh->radius))
+            result.push_back(this->outside[i]);
+    }
+}
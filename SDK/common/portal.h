@@ -0,0 +1,141 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Portal/cell visibility for indoor levels.  Cells and portals are
+ * authored as OBJ meshes: meshes whose name starts with "cell" give the
+ * box of a cell, and meshes whose name starts with "portal" give the
+ * opening between the two cells their box touches.  Both are helper
+ * geometry and are hidden on load.
+ *
+ * Every frame update() starts from the cell holding the camera and walks
+ * through the portals, each time narrowing the view frustum to the part
+ * of the portal still in sight.  The result is the set of visible cells,
+ * each with the reduced frusta it is seen through, and the meshes to draw
+ * are gathered from those cells only, so the cost follows what is visible
+ * rather than the size of the level.
+ */
+
+#ifndef PORTAL_H
+#define PORTAL_H
+
+
+// How many portals deep the walk may go.
+#define PORTAL_MAX_DEPTH 16
+
+
+struct PORTALCELL {
+    OBJMESH			*objmesh;
+
+    vec3			min;
+
+    vec3			max;
+
+    std::vector<unsigned int>	portal;
+
+    // Indices, in the OBJ, of the meshes whose box overlaps the cell.
+    std::vector<unsigned int>	mesh;
+
+    // Set by update() when the cell is seen through at least one portal.
+    bool			visible;
+};
+
+
+struct PORTAL {
+    OBJMESH			*objmesh;
+
+    unsigned int		cell[2];
+
+    // The opening, as the box of the portal mesh flattened along its
+    // thinnest axis.
+    vec3			vertex[4];
+};
+
+
+// One way a cell is seen: planes [first, first + count) of
+// PORTALSYSTEM::plane, all facing inward.
+struct PORTALVIEW {
+    unsigned int		cell;
+
+    unsigned int		first;
+
+    unsigned int		count;
+};
+
+
+struct PORTALSYSTEM {
+    OBJ				*obj;
+
+    std::vector<PORTALCELL>	portalcell;
+
+    std::vector<PORTAL>		portal;
+
+    std::vector<PORTALVIEW>	portalview;
+
+    std::vector<vec4>		plane;
+
+    // Cells covering each mesh of the OBJ; empty for meshes outside every
+    // cell, which are always tested against the camera frustum.
+    std::vector< std::vector<unsigned int> > mesh_cell;
+
+    std::vector<unsigned int>	outside;
+
+    // Cell holding the camera during the last update(), or -1.
+    int				camera_cell;
+
+    // Work done by the last update() and get_visible_meshes().
+    unsigned int		n_visible_cell;
+
+    unsigned int		n_portal_test;
+
+    unsigned int		n_mesh_test;
+
+private:
+    vec3			eye;
+
+    // Far and near planes of the camera, added to every reduced frustum.
+    vec4			clip[2];
+
+    std::vector<unsigned char>	on_path;
+
+    std::vector<unsigned int>	stamp;
+
+    unsigned int		frame;
+
+public:
+    PORTALSYSTEM(OBJ *obj);
+    ~PORTALSYSTEM() {}
+    void relocate(unsigned int mesh_index);
+    int get_cell(const vec3 &location);
+    void update(const vec3 &eye, vec4 *frustum);
+    void get_visible_meshes(std::vector<unsigned int> &result);
+    bool is_cell_visible(unsigned int cell) const { return this->portalcell[cell].visible; }
+private:
+    void walk(unsigned int cell, unsigned int first, unsigned int count,
+              unsigned int depth);
+    unsigned int add_view(unsigned int cell, const vec4 *plane,
+                          unsigned int count);
+    PORTALSYSTEM(const PORTALSYSTEM &src);
+    PORTALSYSTEM &operator=(const PORTALSYSTEM &rhs);
+};
+
+#endif
@@ -54,7 +54,9 @@ PROGRAM::PROGRAM(char *name) : vertex_shader(NULL),
                                fragment_shader(NULL),
                                pid(0),
                                programdrawcallback(NULL),
-                               programbindattribcallback(NULL)
+                               programbindattribcallback(NULL),
+                               shared(NULL),
+                               current_user(NULL)
 {
     this->init(name);
 }
@@ -70,7 +72,9 @@ PROGRAM::PROGRAM(char                       *name,
     fragment_shader(NULL),
     pid(0),
     programdrawcallback(programdrawcallback),
-    programbindattribcallback(programbindattribcallback)
+    programbindattribcallback(programbindattribcallback),
+    shared(NULL),
+    current_user(NULL)
 {
     this->init(name);
 
@@ -274,9 +278,32 @@ GLint PROGRAM::get_uniform_location(char *name)
 }
 
 
+// Point this program at the GL object owned by a registry program.  The
+// uniform and attribute tables are copied so that each user keeps its
+// own "constant" flags; the reference taken by
+// RESOURCE::acquire_program() is handed back by delete_id().
+void PROGRAM::share(PROGRAM *program)
+{
+    this->delete_id();
+
+    this->pid               = program->pid;
+    this->uniform_map       = program->uniform_map;
+    this->vertex_attrib_map = program->vertex_attrib_map;
+    this->shared            = program;
+}
+
+
 void PROGRAM::delete_id()
 {
-    if (this->pid) {
+    if (this->shared) {
+        if (this->shared->current_user == this)
+            this->shared->current_user = NULL;
+
+        RESOURCE::release_program(this->shared);
+
+        this->shared = NULL;
+        this->pid    = 0;
+    } else if (this->pid) {
         glDeleteProgram(this->pid);
 
         this->pid = 0;
@@ -288,10 +315,24 @@ void PROGRAM::draw()
 {
     glUseProgram(this->pid);
 
+    if (this->shared && this->shared->current_user != this) {
+        this->reset();
+
+        this->shared->current_user = this;
+    }
+
     if (this->programdrawcallback) this->programdrawcallback(this);
 }
 
 
+void PROGRAM::reset()
+{
+    for (auto uniform=this->uniform_map.begin();
+         uniform!=this->uniform_map.end(); ++uniform)
+        uniform->second.constant = false;
+}
+
+
 bool PROGRAM::load_gfx(PROGRAMBINDATTRIBCALLBACK    *programbindattribcallback,
                        PROGRAMDRAWCALLBACK          *programdrawcallback,
                        char                         *filename,
@@ -352,9 +393,14 @@ void PROGRAM::build(PROGRAMBINDATTRIBCALLBACK   *programbindattribcallback,
 
     sprintf(filename, "%s%s", program_path, this->name);
 
-    this->load_gfx(programbindattribcallback,
-                   programdrawcallback,
-                   filename,
-                   debug_shader,
-                   false);
+    PROGRAM *program = RESOURCE::acquire_program(filename,
+                                                 false,
+                                                 debug_shader,
+                                                 programbindattribcallback);
+
+    this->programbindattribcallback = programbindattribcallback;
+
+    this->programdrawcallback = programdrawcallback;
+
+    if (program) this->share(program);
 }
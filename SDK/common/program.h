@@ -88,6 +88,14 @@ struct PROGRAM {
     PROGRAMDRAWCALLBACK                 *programdrawcallback;
 
     PROGRAMBINDATTRIBCALLBACK           *programbindattribcallback;
+
+    // Registry owned program whose GL object this one is borrowing, or
+    // NULL if this program owns pid itself.
+    PROGRAM                             *shared;
+
+    // On a registry owned program, the borrower that last drew with it.
+    // Uniforms flagged constant by any other borrower are stale.
+    PROGRAM                             *current_user;
 private:
     void init(char *name);
     void add_vertex_attrib(char *name, GLenum type);
@@ -105,6 +113,7 @@ public:
     void set_bind_attrib_location_callback(PROGRAMBINDATTRIBCALLBACK *programbindattribcallback);
     GLint get_vertex_attrib_location(char *name);
     GLint get_uniform_location(char *name);
+    void share(PROGRAM *program);
     void delete_id();
     void draw();
     void reset();
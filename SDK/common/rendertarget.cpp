@@ -0,0 +1,247 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+// Render targets handed out by acquire(), busy or idle.
+static std::vector<RENDERTARGET *> rendertarget_pool;
+
+static unsigned int rendertarget_frame = 0;
+
+
+RENDERTARGET::RENDERTARGET(unsigned short   width,
+                           unsigned short   height,
+                           unsigned int     color_format,
+                           unsigned int     depth_format) :
+    fbo(0), rbo(0), width(width), height(height),
+    color_format(color_format), depth_format(depth_format),
+    color(NULL), depth(NULL), in_use(false), last_frame(0),
+    previous_buffer(0)
+{
+    int buffer;
+
+    memset(this->previous_viewport, 0, sizeof(this->previous_viewport));
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &buffer);
+
+    glGenFramebuffers(1, &this->fbo);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+
+    if (color_format) {
+        this->color = new TEXTURE((char *)"color");
+
+        this->color->width           = width;
+        this->color->height          = height;
+        this->color->byte            = color_format == GL_RGBA ? 4 : 3;
+        this->color->internal_format =
+        this->color->format          = color_format;
+        this->color->texel_type      = GL_UNSIGNED_BYTE;
+
+        this->color->generate_id(TEXTURE_CLAMP, TEXTURE_FILTER_1X, 0.0f);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D,
+                               this->color->tid,
+                               0);
+    }
+
+    if (depth_format == GL_DEPTH_COMPONENT) {
+        // Requires GL_OES_depth_texture.
+        this->depth = new TEXTURE((char *)"depth");
+
+        this->depth->width           = width;
+        this->depth->height          = height;
+        this->depth->byte            = 2;
+        this->depth->internal_format =
+        this->depth->format          = GL_DEPTH_COMPONENT;
+        this->depth->texel_type      = GL_UNSIGNED_SHORT;
+
+        this->depth->generate_id(TEXTURE_CLAMP, TEXTURE_FILTER_0X, 0.0f);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_2D,
+                               this->depth->tid,
+                               0);
+    } else if (depth_format) {
+        glGenRenderbuffers(1, &this->rbo);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, this->rbo);
+
+        glRenderbufferStorage(GL_RENDERBUFFER, depth_format, width, height);
+
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                  GL_DEPTH_ATTACHMENT,
+                                  GL_RENDERBUFFER,
+                                  this->rbo);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer < 0 ? 0 : buffer);
+}
+
+
+RENDERTARGET::~RENDERTARGET()
+{
+    if (this->color) delete this->color;
+
+    if (this->depth) delete this->depth;
+
+    if (this->rbo) glDeleteRenderbuffers(1, &this->rbo);
+
+    if (this->fbo) glDeleteFramebuffers(1, &this->fbo);
+}
+
+
+bool RENDERTARGET::is_complete()
+{
+    int buffer;
+
+    GLenum status;
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &buffer);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+
+    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, buffer < 0 ? 0 : buffer);
+
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+
+// Redirect drawing to this target and size the viewport to it.  The
+// framebuffer and viewport in effect are remembered for unbind(); on
+// Android there may be no framebuffer bound, in which case 0 is restored.
+void RENDERTARGET::bind()
+{
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &this->previous_buffer);
+
+    if (this->previous_buffer < 0) this->previous_buffer = 0;
+
+    glGetIntegerv(GL_VIEWPORT, this->previous_viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->fbo);
+
+    glViewport(0, 0, this->width, this->height);
+}
+
+
+void RENDERTARGET::unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, this->previous_buffer);
+
+    glViewport(this->previous_viewport[0],
+               this->previous_viewport[1],
+               this->previous_viewport[2],
+               this->previous_viewport[3]);
+}
+
+
+// Return an idle pooled target with the requested size and formats,
+// creating one only when none is available.
+RENDERTARGET *RENDERTARGET::acquire(unsigned short  width,
+                                    unsigned short  height,
+                                    unsigned int    color_format,
+                                    unsigned int    depth_format)
+{
+    RENDERTARGET *rendertarget;
+
+    for (auto it=rendertarget_pool.begin();
+         it!=rendertarget_pool.end(); ++it) {
+        rendertarget = *it;
+
+        if (!rendertarget->in_use                       &&
+            rendertarget->width        == width         &&
+            rendertarget->height       == height        &&
+            rendertarget->color_format == color_format  &&
+            rendertarget->depth_format == depth_format) {
+            rendertarget->in_use = true;
+
+            return rendertarget;
+        }
+    }
+
+    rendertarget = new RENDERTARGET(width, height, color_format, depth_format);
+
+    rendertarget->in_use = true;
+
+    rendertarget_pool.push_back(rendertarget);
+
+    return rendertarget;
+}
+
+
+void RENDERTARGET::release(RENDERTARGET *rendertarget)
+{
+    assert(rendertarget->in_use);
+
+    rendertarget->in_use     = false;
+    rendertarget->last_frame = rendertarget_frame;
+}
+
+
+// Advance the pool clock and destroy idle targets that have not been
+// acquired for more than max_idle_frames frames.  Call once per frame.
+void RENDERTARGET::end_frame(unsigned int max_idle_frames)
+{
+    ++rendertarget_frame;
+
+    for (auto it=rendertarget_pool.begin(); it!=rendertarget_pool.end(); ) {
+        RENDERTARGET *rendertarget = *it;
+
+        if (!rendertarget->in_use &&
+            rendertarget_frame - rendertarget->last_frame > max_idle_frames) {
+            delete rendertarget;
+
+            it = rendertarget_pool.erase(it);
+        } else
+            ++it;
+    }
+}
+
+
+// Destroy every pooled target.  Targets still in use are leaked to the
+// caller, who is then responsible for deleting them.
+void RENDERTARGET::purge()
+{
+    for (auto it=rendertarget_pool.begin();
+         it!=rendertarget_pool.end(); ++it) {
+        if (!(*it)->in_use) delete *it;
+    }
+
+    rendertarget_pool.clear();
+}
+
+
+unsigned int RENDERTARGET::get_pool_size()
+{
+    return (unsigned int)rendertarget_pool.size();
+}
@@ -0,0 +1,106 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Off-screen framebuffer with optional color and depth attachments.  The
+ * attachments are plain TEXTUREs so they can be bound like any other
+ * texture once the pass is done.  Transient targets should come from
+ * RENDERTARGET::acquire() so that they are recycled across frames
+ * instead of being created and destroyed on every pass.
+ */
+
+#ifndef RENDERTARGET_H
+#define RENDERTARGET_H
+
+
+struct RENDERTARGET {
+    unsigned int	fbo;
+
+    // Depth renderbuffer, used when depth_format is GL_DEPTH_COMPONENT16.
+    unsigned int	rbo;
+
+    unsigned short	width;
+
+    unsigned short	height;
+
+    // GL_RGB, GL_RGBA or 0 for no color attachment.
+    unsigned int	color_format;
+
+    // GL_DEPTH_COMPONENT for a depth texture, GL_DEPTH_COMPONENT16 for a
+    // renderbuffer that cannot be sampled, or 0 for no depth attachment.
+    unsigned int	depth_format;
+
+    TEXTURE		*color;
+
+    TEXTURE		*depth;
+
+    // Pool bookkeeping.
+    bool		in_use;
+
+    unsigned int	last_frame;
+
+    // Framebuffer and viewport to restore in unbind().
+    int			previous_buffer;
+
+    int			previous_viewport[4];
+
+public:
+    RENDERTARGET(unsigned short width, unsigned short height,
+                 unsigned int color_format, unsigned int depth_format);
+    ~RENDERTARGET();
+    bool is_complete();
+    void bind();
+    void unbind();
+
+    static RENDERTARGET *acquire(unsigned short width, unsigned short height,
+                                 unsigned int color_format,
+                                 unsigned int depth_format);
+    static void release(RENDERTARGET *rendertarget);
+    static void end_frame(unsigned int max_idle_frames);
+    static void purge();
+    static unsigned int get_pool_size();
+private:
+    RENDERTARGET(const RENDERTARGET &src);
+    RENDERTARGET &operator=(const RENDERTARGET &rhs);
+};
+
+
+// Binds a render target for the lifetime of the object and puts the
+// previous framebuffer and viewport back when it goes out of scope.
+struct RENDERTARGETBINDING {
+    RENDERTARGET	*rendertarget;
+public:
+    RENDERTARGETBINDING(RENDERTARGET *rendertarget) :
+        rendertarget(rendertarget)
+    {
+        this->rendertarget->bind();
+    }
+    ~RENDERTARGETBINDING()
+    {
+        this->rendertarget->unbind();
+    }
+private:
+    RENDERTARGETBINDING(const RENDERTARGETBINDING &src);
+    RENDERTARGETBINDING &operator=(const RENDERTARGETBINDING &rhs);
+};
+
+#endif
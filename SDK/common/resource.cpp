@@ -0,0 +1,507 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+#include <unordered_map>
+
+
+struct RESOURCEENTRY {
+    void            *resource;
+
+    unsigned int    refcount;
+};
+
+
+// Key -> entry for every live resource, plus the reverse mapping used
+// by the release functions so callers only need to hand back the
+// pointer they were given.
+static std::unordered_map<std::string, RESOURCEENTRY>   texture_registry;
+
+static std::unordered_map<const void *, std::string>    texture_key;
+
+static std::unordered_map<std::string, RESOURCEENTRY>   program_registry;
+
+static std::unordered_map<const void *, std::string>    program_key;
+
+static std::unordered_map<std::string, RESOURCEENTRY>   md5model_registry;
+
+static std::unordered_map<const void *, std::string>    md5model_key;
+
+static std::unordered_map<std::string, RESOURCEENTRY>   md5anim_registry;
+
+static std::unordered_map<const void *, std::string>    md5anim_key;
+
+
+// Directory of the binary MD5 caches, empty when they are off.
+static char cache_path[MAX_PATH] = {""};
+
+
+// Resolve a path the same way MEMORY does and then collapse any "//",
+// "./" and "dir/../" segments so that different spellings of one file
+// map onto a single registry key.
+void RESOURCE::get_canonical_path(const char *filepath,
+                                  const bool relative_path, char *path)
+{
+    char    fname[MAX_PATH] = {""},
+            *segment[MAX_PATH / 2];
+
+    int     n_segment = 0;
+
+    if (relative_path) {
+#ifdef __IPHONE_4_0
+        get_file_path(getenv("FILESYSTEM"), fname);
+
+        strcat(fname, filepath);
+#else
+        sprintf(fname, "assets/%s", filepath);
+#endif
+    } else {
+        assert(strlen(filepath) < sizeof(fname));
+        strcpy(fname, filepath);
+    }
+
+    adjust_file_path(fname);
+
+    bool absolute = fname[0] == '/';
+
+    // Split in place rather than with strtok(), the OBJ and MD5 loaders
+    // may be in the middle of their own strtok() pass.
+    for (char *s = fname, *e; *s; s = e) {
+        e = strchr(s, '/');
+
+        if (e)
+            *e++ = 0;
+        else
+            e = s + strlen(s);
+
+        if (!s[0] || !strcmp(s, "."))
+            continue;
+
+        if (!strcmp(s, "..") && n_segment && strcmp(segment[n_segment-1], "..")) {
+            --n_segment;
+            continue;
+        }
+
+        segment[n_segment++] = s;
+    }
+
+    path[0] = 0;
+
+    if (absolute) strcat(path, "/");
+
+    for (int i=0; i!=n_segment; ++i) {
+        if (i) strcat(path, "/");
+
+        strcat(path, segment[i]);
+    }
+}
+
+
+TEXTURE *RESOURCE::acquire_texture(const char           *filename,
+                                   const bool           relative_path,
+                                   const unsigned int   flags,
+                                   const unsigned char  filter,
+                                   const float          anisotropic_filter)
+{
+    char path[MAX_PATH] = {""},
+         key[MAX_PATH + MAX_CHAR] = {""};
+
+    get_canonical_path(filename, relative_path, path);
+
+    sprintf(key, "%s|%u|%u|%g", path, flags, filter, anisotropic_filter);
+
+    auto it = texture_registry.find(key);
+
+    if (it != texture_registry.end()) {
+        ++it->second.refcount;
+
+        return (TEXTURE *)it->second.resource;
+    }
+
+    TEXTURE *texture = new TEXTURE(NULL);
+
+    if (!texture->load_file(path, false, flags, filter, anisotropic_filter)) {
+        delete texture;
+
+        return NULL;
+    }
+
+    RESOURCEENTRY &entry = texture_registry[key];
+
+    entry.resource = texture;
+    entry.refcount = 1;
+
+    texture_key[texture] = key;
+
+    return texture;
+}
+
+
+void RESOURCE::release_texture(TEXTURE *texture)
+{
+    auto k = texture_key.find(texture);
+
+    if (k == texture_key.end()) return;
+
+    auto it = texture_registry.find(k->second);
+
+    if (--it->second.refcount) return;
+
+    texture_registry.erase(it);
+
+    texture_key.erase(k);
+
+    delete texture;
+}
+
+
+PROGRAM *RESOURCE::acquire_program(const char                   *filename,
+                                   const bool                   relative_path,
+                                   const bool                   debug_shader,
+                                   PROGRAMBINDATTRIBCALLBACK    *programbindattribcallback)
+{
+    char path[MAX_PATH] = {""},
+         key[MAX_PATH + MAX_CHAR] = {""};
+
+    get_canonical_path(filename, relative_path, path);
+
+    // The attribute binding callback runs before glLinkProgram() so two
+    // programs built from the same file with different callbacks are
+    // different GL objects.  The draw callback is per user, see
+    // PROGRAM::share().
+    sprintf(key, "%s|%d|%p", path, debug_shader, programbindattribcallback);
+
+    auto it = program_registry.find(key);
+
+    if (it != program_registry.end()) {
+        ++it->second.refcount;
+
+        return (PROGRAM *)it->second.resource;
+    }
+
+    PROGRAM *program = new PROGRAM(NULL);
+
+    if (!program->load_gfx(programbindattribcallback,
+                           NULL,
+                           path,
+                           debug_shader,
+                           false) || !program->pid) {
+        delete program;
+
+        return NULL;
+    }
+
+    RESOURCEENTRY &entry = program_registry[key];
+
+    entry.resource = program;
+    entry.refcount = 1;
+
+    program_key[program] = key;
+
+    return program;
+}
+
+
+PROGRAM *RESOURCE::acquire_program(const char *name,
+                                   const char *vertex_shader_code,
+                                   const char *fragment_shader_code)
+{
+    char key[MAX_PATH] = {""};
+
+    // Built in programs (FONT, NAVIGATION, ...) have no file behind
+    // them, the name is the identity.
+    sprintf(key, "<%s>", name);
+
+    auto it = program_registry.find(key);
+
+    if (it != program_registry.end()) {
+        ++it->second.refcount;
+
+        return (PROGRAM *)it->second.resource;
+    }
+
+    PROGRAM *program = new PROGRAM((char *)name);
+
+    program->vertex_shader = new SHADER((char *)name, GL_VERTEX_SHADER);
+
+    program->vertex_shader->compile(vertex_shader_code, false);
+
+    program->fragment_shader = new SHADER((char *)name, GL_FRAGMENT_SHADER);
+
+    program->fragment_shader->compile(fragment_shader_code, false);
+
+    program->link(false);
+
+    RESOURCEENTRY &entry = program_registry[key];
+
+    entry.resource = program;
+    entry.refcount = 1;
+
+    program_key[program] = key;
+
+    return program;
+}
+
+
+void RESOURCE::release_program(PROGRAM *program)
+{
+    auto k = program_key.find(program);
+
+    if (k == program_key.end()) return;
+
+    auto it = program_registry.find(k->second);
+
+    if (--it->second.refcount) return;
+
+    program_registry.erase(it);
+
+    program_key.erase(k);
+
+    delete program;
+}
+
+
+void RESOURCE::set_cache_path(const char *path)
+{
+    assert(path == NULL || strlen(path) < sizeof(cache_path));
+
+    strcpy(cache_path, path ? path : "");
+}
+
+
+// The cache file of the resource at the canonical path, under cache_path:
+// its file name followed by a 64 bit FNV-1a hash of the whole path, so
+// that files of the same name in different directories never share a
+// cache.  The header of the cache holds the path as well, see md5.cpp.
+// False when caching is off or the name does not fit.
+bool RESOURCE::get_cache_filename(const char *path, char *filename)
+{
+    const char *name = strrchr(path, '/');
+
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (const char *c = path; *c; ++c)
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+
+    name = name ? name + 1 : path;
+
+    if (!cache_path[0] ||
+        strlen(cache_path) + strlen(name) + 22 >= MAX_PATH) return false;
+
+    sprintf(filename, "%s/%s.%016llx.bin", cache_path, name, hash);
+
+    return true;
+}
+
+
+// Size and stamp of the file at the canonical path, for the caches to
+// tell a stale text file: its modification time, or on Android, where
+// the package does not reliably keep times, the CRC of its entry.  False
+// when the file cannot be found.
+bool RESOURCE::get_file_stamp(const char *path,
+                              unsigned int *size, unsigned int *stamp)
+{
+#ifdef __IPHONE_4_0
+    struct stat st;
+
+    if (stat(path, &st)) return false;
+
+    *size  = st.st_size;
+    *stamp = st.st_mtime;
+
+    return true;
+#else
+    unzFile uf = unzOpen(getenv("FILESYSTEM"));
+
+    unz_file_info fi;
+
+    if (!uf) return false;
+
+    bool found = unzLocateFile(uf, path, 1) == UNZ_OK &&
+                 unzGetCurrentFileInfo(uf, &fi, NULL, 0,
+                                       NULL, 0, NULL, 0) == UNZ_OK;
+
+    unzClose(uf);
+
+    if (!found) return false;
+
+    *size  = fi.uncompressed_size;
+    *stamp = fi.crc;
+
+    return true;
+#endif
+}
+
+
+MD5MODEL *RESOURCE::acquire_md5model(const char *filename,
+                                     const bool relative_path)
+{
+    char path[MAX_PATH] = {""};
+
+    get_canonical_path(filename, relative_path, path);
+
+    auto it = md5model_registry.find(path);
+
+    if (it != md5model_registry.end()) {
+        ++it->second.refcount;
+
+        return (MD5MODEL *)it->second.resource;
+    }
+
+    char cache[MAX_PATH] = {""};
+
+    MD5MODEL *md5model = new MD5MODEL();
+
+    // Without a cache, parse the text and let the first MD5::build()
+    // write the cache once the normals and tangents exist.
+    if (!get_cache_filename(path, cache) || !md5model->load_cache(cache, path)) {
+        delete md5model;
+
+        md5model = new MD5MODEL(path, false);
+
+        strcpy(md5model->cache, cache);
+        strcpy(md5model->source, path);
+    }
+
+    if (md5model->md5meshdata.empty()) {
+        delete md5model;
+
+        return NULL;
+    }
+
+    RESOURCEENTRY &entry = md5model_registry[path];
+
+    entry.resource = md5model;
+    entry.refcount = 1;
+
+    md5model_key[md5model] = path;
+
+    return md5model;
+}
+
+
+void RESOURCE::release_md5model(MD5MODEL *md5model)
+{
+    auto k = md5model_key.find(md5model);
+
+    if (k == md5model_key.end()) return;
+
+    auto it = md5model_registry.find(k->second);
+
+    if (--it->second.refcount) return;
+
+    md5model_registry.erase(it);
+
+    md5model_key.erase(k);
+
+    delete md5model;
+}
+
+
+MD5ANIM *RESOURCE::acquire_md5anim(const char *filename,
+                                   const bool relative_path)
+{
+    char path[MAX_PATH] = {""};
+
+    get_canonical_path(filename, relative_path, path);
+
+    auto it = md5anim_registry.find(path);
+
+    if (it != md5anim_registry.end()) {
+        ++it->second.refcount;
+
+        return (MD5ANIM *)it->second.resource;
+    }
+
+    char cache[MAX_PATH] = {""};
+
+    bool cached = get_cache_filename(path, cache);
+
+    MD5ANIM *md5anim = new MD5ANIM();
+
+    if (!cached || !md5anim->load_cache(cache, path)) {
+        delete md5anim;
+
+        md5anim = new MD5ANIM(path, false);
+
+        if (cached && md5anim->n_frame) md5anim->save_cache(cache, path);
+    }
+
+    if (!md5anim->n_frame) {
+        delete md5anim;
+
+        return NULL;
+    }
+
+    RESOURCEENTRY &entry = md5anim_registry[path];
+
+    entry.resource = md5anim;
+    entry.refcount = 1;
+
+    md5anim_key[md5anim] = path;
+
+    return md5anim;
+}
+
+
+void RESOURCE::release_md5anim(MD5ANIM *md5anim)
+{
+    auto k = md5anim_key.find(md5anim);
+
+    if (k == md5anim_key.end()) return;
+
+    auto it = md5anim_registry.find(k->second);
+
+    if (--it->second.refcount) return;
+
+    md5anim_registry.erase(it);
+
+    md5anim_key.erase(k);
+
+    delete md5anim;
+}
+
+
+unsigned int RESOURCE::get_texture_count()
+{
+    return texture_registry.size();
+}
+
+
+unsigned int RESOURCE::get_program_count()
+{
+    return program_registry.size();
+}
+
+
+unsigned int RESOURCE::get_md5model_count()
+{
+    return md5model_registry.size();
+}
+
+
+unsigned int RESOURCE::get_md5anim_count()
+{
+    return md5anim_registry.size();
+}
@@ -0,0 +1,82 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Process wide, reference counted registry of GPU resources.  Textures
+ * and shader programs are keyed by their canonical path plus the flags
+ * used to load them so that two OBJs, or an OBJ and the MD5 using its
+ * materials, never decode and upload the same image or link the same
+ * program twice.  MD5 models and animations are keyed by path alone, so
+ * a crowd of characters parses each .md5mesh and .md5anim once.  Given
+ * a writable directory with set_cache_path(), they are also kept there
+ * in binary form and later runs map those instead of parsing the text.
+ * Each cache records the path, size and stamp of its text file and is
+ * parsed again, then rewritten, once they no longer match.
+ */
+
+#ifndef RESOURCE_H
+#define RESOURCE_H
+
+struct MD5MODEL;
+
+struct MD5ANIM;
+
+struct RESOURCE {
+    static TEXTURE *acquire_texture(const char *filename,
+                                    const bool relative_path,
+                                    const unsigned int flags,
+                                    const unsigned char filter,
+                                    const float anisotropic_filter);
+    static void release_texture(TEXTURE *texture);
+    static PROGRAM *acquire_program(const char *filename,
+                                    const bool relative_path,
+                                    const bool debug_shader,
+                                    PROGRAMBINDATTRIBCALLBACK *programbindattribcallback);
+    static PROGRAM *acquire_program(const char *name,
+                                    const char *vertex_shader_code,
+                                    const char *fragment_shader_code);
+    static void release_program(PROGRAM *program);
+    static MD5MODEL *acquire_md5model(const char *filename,
+                                      const bool relative_path);
+    static void release_md5model(MD5MODEL *md5model);
+    static MD5ANIM *acquire_md5anim(const char *filename,
+                                    const bool relative_path);
+    static void release_md5anim(MD5ANIM *md5anim);
+    static unsigned int get_texture_count();
+    static unsigned int get_program_count();
+    static unsigned int get_md5model_count();
+    static unsigned int get_md5anim_count();
+    static void get_canonical_path(const char *filepath,
+                                   const bool relative_path, char *path);
+    static void set_cache_path(const char *path);
+    static bool get_cache_filename(const char *path, char *filename);
+    static bool get_file_stamp(const char *path,
+                               unsigned int *size, unsigned int *stamp);
+private:
+    // RESOURCE is never instantiated; everything lives in the registry
+    // maps in resource.cpp.
+    RESOURCE();
+    RESOURCE(const RESOURCE &src);
+    RESOURCE &operator=(const RESOURCE &rhs);
+};
+
+#endif
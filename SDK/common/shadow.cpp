@@ -0,0 +1,274 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+// Lay the tiles out two per row; each cell is as large as the largest
+// cascade so that the atlas stays a simple grid.
+SHADOW::SHADOW(unsigned int         n_cascade,
+               const unsigned short *resolution,
+               float                lambda,
+               float                caster_distance) :
+    n_cascade(n_cascade), lambda(lambda), caster_distance(caster_distance),
+    direction(0.0f, 0.0f, -1.0f), rendertarget(NULL), n_culled(0)
+{
+    unsigned short cell = 0;
+
+    assert(n_cascade > 0 && n_cascade <= SHADOW_MAX_CASCADE);
+
+    for (unsigned int i=0; i!=n_cascade; ++i) {
+        if (resolution[i] > cell) cell = resolution[i];
+    }
+
+    for (unsigned int i=0; i!=n_cascade; ++i) {
+        this->cascade[i].split_near = 0.0f;
+        this->cascade[i].split_far  = 0.0f;
+        this->cascade[i].resolution = resolution[i];
+        this->cascade[i].x          = (i & 1) * cell;
+        this->cascade[i].y          = (i >> 1) * cell;
+        this->cascade[i].n_caster   = 0;
+    }
+
+    this->rendertarget = new RENDERTARGET(n_cascade > 1 ? cell << 1 : cell,
+                                          ((n_cascade + 1) >> 1) * cell,
+                                          0,
+                                          GL_DEPTH_COMPONENT);
+}
+
+
+SHADOW::~SHADOW()
+{
+    delete this->rendertarget;
+}
+
+
+// Compute the split distances for the current camera and fit a light
+// projection to each slice.  modelview_matrix and projection_matrix are
+// the camera matrices; clip_start and clip_end the view distances to
+// shadow, the values given to set_perspective() or any range within
+// them.
+void SHADOW::update(const vec3  &direction,
+                    const mat4  &modelview_matrix,
+                    const mat4  &projection_matrix,
+                    float       clip_start,
+                    float       clip_end)
+{
+    mat4 inverse_matrix = inverse(modelview_matrix * projection_matrix);
+
+    this->direction = direction.normalize();
+
+    for (unsigned int i=0; i!=this->n_cascade; ++i) {
+        float f = (float)(i + 1) / (float)this->n_cascade,
+              l = clip_start * powf(clip_end / clip_start, f),
+              u = clip_start + (clip_end - clip_start) * f;
+
+        this->cascade[i].split_near = i ? this->cascade[i - 1].split_far :
+                                          clip_start;
+
+        this->cascade[i].split_far = this->lambda * l +
+                                     (1.0f - this->lambda) * u;
+
+        this->fit_cascade(&this->cascade[i], inverse_matrix, projection_matrix);
+    }
+}
+
+
+// Bound the slice with a sphere rather than a box so that the projection
+// size does not change as the camera turns, then snap its center to the
+// texel grid of the tile so that the shadow edges do not crawl as the
+// camera moves.
+void SHADOW::fit_cascade(SHADOWCASCADE  *shadowcascade,
+                         const mat4     &inverse_matrix,
+                         const mat4     &projection_matrix)
+{
+    static const mat4 bias_matrix(0.5f, 0.0f, 0.0f, 0.0f,
+                                  0.0f, 0.5f, 0.0f, 0.0f,
+                                  0.0f, 0.0f, 0.5f, 0.0f,
+                                  0.5f, 0.5f, 0.5f, 1.0f);
+
+    float depth[2] = { shadowcascade->split_near, shadowcascade->split_far },
+          radius = 0.0f,
+          texel,
+          s,
+          ox,
+          oy;
+
+    vec3 corner[8],
+         center(0.0f, 0.0f, 0.0f),
+         up_axis(0.0f, 0.0f, 1.0f);
+
+    vec4 c;
+
+    TStack l;
+
+    unsigned short atlas_width  = this->rendertarget->width,
+                   atlas_height = this->rendertarget->height;
+
+    for (int i=0; i!=2; ++i) {
+        // Depth of the split plane in normalized device coordinates.
+        vec4 p = vec4(0.0f, 0.0f, -depth[i], 1.0f) * projection_matrix;
+
+        float z = p->z / p->w;
+
+        for (int j=0; j!=4; ++j) {
+            vec4 ndc((j & 1) ? 1.0f : -1.0f,
+                     (j & 2) ? 1.0f : -1.0f,
+                     z,
+                     1.0f);
+
+            corner[(i << 2) + j] = vec3(ndc * inverse_matrix);
+
+            center += corner[(i << 2) + j];
+        }
+    }
+
+    center *= 0.125f;
+
+    for (int i=0; i!=8; ++i) {
+        float d = (corner[i] - center).length();
+
+        if (d > radius) radius = d;
+    }
+
+    // Quantize the radius so that rounding noise in the corners does
+    // not resize the projection from one frame to the next.
+    radius = ceilf(radius * 16.0f) / 16.0f;
+
+    if (fabsf(this->direction->z) > 0.99f) up_axis = vec3(0.0f, 1.0f, 0.0f);
+
+    l.loadLookAt(vec3(0.0f, 0.0f, 0.0f), this->direction, up_axis);
+
+    shadowcascade->modelview_matrix = l.back();
+
+    c = vec4(center, 1.0f) * shadowcascade->modelview_matrix;
+
+    texel = (radius * 2.0f) / (float)shadowcascade->resolution;
+
+    c->x = floorf(c->x / texel) * texel;
+    c->y = floorf(c->y / texel) * texel;
+
+    l.loadOrtho(c->x - radius,
+                c->x + radius,
+                c->y - radius,
+                c->y + radius,
+                -c->z - radius - this->caster_distance,
+                -c->z + radius);
+
+    shadowcascade->projection_matrix = l.back();
+
+    build_frustum(shadowcascade->frustum,
+                  shadowcascade->modelview_matrix,
+                  shadowcascade->projection_matrix);
+
+    // Scale and offset [0,1] texture coordinates into the cascade tile.
+    s  = (float)shadowcascade->resolution;
+    ox = (float)shadowcascade->x / (float)atlas_width;
+    oy = (float)shadowcascade->y / (float)atlas_height;
+
+    mat4 tile_matrix(s / atlas_width, 0.0f,             0.0f, 0.0f,
+                     0.0f,            s / atlas_height, 0.0f, 0.0f,
+                     0.0f,            0.0f,             1.0f, 0.0f,
+                     ox,              oy,               0.0f, 1.0f);
+
+    shadowcascade->shadow_matrix = shadowcascade->modelview_matrix *
+                                   shadowcascade->projection_matrix *
+                                   bias_matrix *
+                                   tile_matrix;
+}
+
+
+// Render every visible mesh of obj that intersects a cascade into that
+// cascade's tile using program, typically a depth only shader.  The
+// materials' programs are restored afterwards.  The GFX projection and
+// modelview matrices are left as they were set for the last cascade.
+void SHADOW::draw(GFX *gfx, OBJ *obj, PROGRAM *program)
+{
+    std::vector<PROGRAM *> material_program;
+
+    RENDERTARGETBINDING binding(this->rendertarget);
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glCullFace(GL_FRONT);
+
+    for (auto objmaterial=obj->objmaterial.begin();
+         objmaterial!=obj->objmaterial.end(); ++objmaterial) {
+        material_program.push_back(objmaterial->program);
+
+        objmaterial->program = program;
+    }
+
+    this->n_culled = 0;
+
+    for (unsigned int i=0; i!=this->n_cascade; ++i) {
+        SHADOWCASCADE *shadowcascade = &this->cascade[i];
+
+        shadowcascade->n_caster = 0;
+
+        glViewport(shadowcascade->x,
+                   shadowcascade->y,
+                   shadowcascade->resolution,
+                   shadowcascade->resolution);
+
+        gfx->set_matrix_mode(PROJECTION_MATRIX);
+        gfx->load_matrix(shadowcascade->projection_matrix);
+
+        gfx->set_matrix_mode(MODELVIEW_MATRIX);
+        gfx->load_matrix(shadowcascade->modelview_matrix);
+
+        for (auto objmesh=obj->objmesh.begin();
+             objmesh!=obj->objmesh.end(); ++objmesh) {
+            if (!objmesh->visible) continue;
+
+            if (sphere_intersect_frustum(shadowcascade->frustum,
+                                         &objmesh->location,
+                                         objmesh->radius) == IF_Outside) {
+                ++this->n_culled;
+
+                continue;
+            }
+
+            gfx->push_matrix();
+
+            gfx->translate(objmesh->location);
+
+            objmesh->draw();
+
+            gfx->pop_matrix();
+
+            ++shadowcascade->n_caster;
+        }
+    }
+
+    for (unsigned int i=0; i!=obj->objmaterial.size(); ++i)
+        obj->objmaterial[i].program = material_program[i];
+
+    glCullFace(GL_BACK);
+}
+
+
+TEXTURE *SHADOW::get_texture()
+{
+    return this->rendertarget->depth;
+}
@@ -0,0 +1,100 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Cascaded shadow maps for a directional light.  The camera frustum is cut
+ * into up to SHADOW_MAX_CASCADE slices using the practical split scheme,
+ * each slice gets its own orthographic light projection, and every
+ * cascade is rendered into its own tile of a single depth texture atlas.
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+
+#define SHADOW_MAX_CASCADE 4
+
+
+struct SHADOWCASCADE {
+    // View space distances covered by this cascade.
+    float		split_near;
+
+    float		split_far;
+
+    // Tile size and position inside the atlas, in texels.
+    unsigned short	resolution;
+
+    unsigned short	x;
+
+    unsigned short	y;
+
+    mat4		modelview_matrix;
+
+    mat4		projection_matrix;
+
+    // World space to atlas texture coordinates, ready for a shader.
+    mat4		shadow_matrix;
+
+    vec4		frustum[6];
+
+    // Number of meshes drawn into the tile during the last draw().
+    unsigned int	n_caster;
+};
+
+
+struct SHADOW {
+    unsigned int	n_cascade;
+
+    SHADOWCASCADE	cascade[SHADOW_MAX_CASCADE];
+
+    // Blend between logarithmic (1) and uniform (0) split distances.
+    float		lambda;
+
+    // How far behind each cascade, toward the light, casters are still
+    // picked up.
+    float		caster_distance;
+
+    vec3		direction;
+
+    RENDERTARGET	*rendertarget;
+
+    // Meshes rejected by the per cascade light frustum during the last
+    // draw().
+    unsigned int	n_culled;
+
+public:
+    SHADOW(unsigned int n_cascade, const unsigned short *resolution,
+           float lambda=0.75f, float caster_distance=50.0f);
+    ~SHADOW();
+    void update(const vec3 &direction,
+                const mat4 &modelview_matrix, const mat4 &projection_matrix,
+                float clip_start, float clip_end);
+    void draw(GFX *gfx, OBJ *obj, PROGRAM *program);
+    TEXTURE *get_texture();
+private:
+    void fit_cascade(SHADOWCASCADE *shadowcascade, const mat4 &inverse_matrix,
+                     const mat4 &projection_matrix);
+    SHADOW(const SHADOW &src);
+    SHADOW &operator=(const SHADOW &rhs);
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Four lane float helpers for the engine's batch code (frustum culling,
+ * occlusion rasterization).  They map onto the glml SSE or NEON backend
+ * when GLML_USE_SIMD is defined, and onto plain loops otherwise, so that
+ * the callers are written only once.  Masks are only meant to be combined
+ * with each other and consumed by simd_select() and simd_bits().
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+
+#if defined(GLML_SIMD_SSE)
+
+typedef __m128 SIMDFLOAT4;
+
+typedef __m128 SIMDMASK4;
+
+inline SIMDFLOAT4 simd_load(const float *p) { return _mm_loadu_ps(p); }
+inline void simd_store(float *p, const SIMDFLOAT4 a) { _mm_storeu_ps(p, a); }
+inline SIMDFLOAT4 simd_splat(const float f) { return _mm_set1_ps(f); }
+inline SIMDFLOAT4 simd_add(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_add_ps(a, b); }
+inline SIMDFLOAT4 simd_sub(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_sub_ps(a, b); }
+inline SIMDFLOAT4 simd_mul(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_mul_ps(a, b); }
+inline SIMDFLOAT4 simd_madd(const SIMDFLOAT4 a, const SIMDFLOAT4 b, const SIMDFLOAT4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline SIMDFLOAT4 simd_min(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_min_ps(a, b); }
+inline SIMDMASK4 simd_none(void) { return _mm_setzero_ps(); }
+inline SIMDMASK4 simd_lt(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_cmplt_ps(a, b); }
+inline SIMDMASK4 simd_le(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return _mm_cmple_ps(a, b); }
+inline SIMDMASK4 simd_and(const SIMDMASK4 a, const SIMDMASK4 b) { return _mm_and_ps(a, b); }
+inline SIMDMASK4 simd_or(const SIMDMASK4 a, const SIMDMASK4 b) { return _mm_or_ps(a, b); }
+inline SIMDFLOAT4 simd_select(const SIMDMASK4 m, const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+inline unsigned int simd_bits(const SIMDMASK4 m) { return _mm_movemask_ps(m); }
+inline void simd_transpose(SIMDFLOAT4 &a, SIMDFLOAT4 &b, SIMDFLOAT4 &c, SIMDFLOAT4 &d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+}
+
+#elif defined(GLML_SIMD_NEON)
+
+typedef float32x4_t SIMDFLOAT4;
+
+typedef uint32x4_t SIMDMASK4;
+
+inline SIMDFLOAT4 simd_load(const float *p) { return vld1q_f32(p); }
+inline void simd_store(float *p, const SIMDFLOAT4 a) { vst1q_f32(p, a); }
+inline SIMDFLOAT4 simd_splat(const float f) { return vdupq_n_f32(f); }
+inline SIMDFLOAT4 simd_add(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vaddq_f32(a, b); }
+inline SIMDFLOAT4 simd_sub(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vsubq_f32(a, b); }
+inline SIMDFLOAT4 simd_mul(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vmulq_f32(a, b); }
+inline SIMDFLOAT4 simd_madd(const SIMDFLOAT4 a, const SIMDFLOAT4 b, const SIMDFLOAT4 c) { return vmlaq_f32(c, a, b); }
+inline SIMDFLOAT4 simd_min(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vminq_f32(a, b); }
+inline SIMDMASK4 simd_none(void) { return vdupq_n_u32(0); }
+inline SIMDMASK4 simd_lt(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vcltq_f32(a, b); }
+inline SIMDMASK4 simd_le(const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vcleq_f32(a, b); }
+inline SIMDMASK4 simd_and(const SIMDMASK4 a, const SIMDMASK4 b) { return vandq_u32(a, b); }
+inline SIMDMASK4 simd_or(const SIMDMASK4 a, const SIMDMASK4 b) { return vorrq_u32(a, b); }
+inline SIMDFLOAT4 simd_select(const SIMDMASK4 m, const SIMDFLOAT4 a, const SIMDFLOAT4 b) { return vbslq_f32(m, a, b); }
+inline unsigned int simd_bits(const SIMDMASK4 m) {
+    return (vgetq_lane_u32(m, 0) & 1)        |
+           ((vgetq_lane_u32(m, 1) & 1) << 1) |
+           ((vgetq_lane_u32(m, 2) & 1) << 2) |
+           ((vgetq_lane_u32(m, 3) & 1) << 3);
+}
+inline void simd_transpose(SIMDFLOAT4 &a, SIMDFLOAT4 &b, SIMDFLOAT4 &c, SIMDFLOAT4 &d) {
+    float32x4x2_t ab = vtrnq_f32(a, b),
+                  cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32 (ab.val[0]), vget_low_f32 (cd.val[0]));
+    b = vcombine_f32(vget_low_f32 (ab.val[1]), vget_low_f32 (cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+#else
+
+typedef struct { float f[4]; } SIMDFLOAT4;
+
+typedef struct { bool b[4]; } SIMDMASK4;
+
+inline SIMDFLOAT4 simd_load(const float *p) {
+    SIMDFLOAT4 r = { { p[0], p[1], p[2], p[3] } }; return r;
+}
+inline void simd_store(float *p, const SIMDFLOAT4 a) {
+    for (int i=0; i!=4; ++i) p[i] = a.f[i];
+}
+inline SIMDFLOAT4 simd_splat(const float f) {
+    SIMDFLOAT4 r = { { f, f, f, f } }; return r;
+}
+inline SIMDFLOAT4 simd_add(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = a.f[i] + b.f[i]; return r;
+}
+inline SIMDFLOAT4 simd_sub(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = a.f[i] - b.f[i]; return r;
+}
+inline SIMDFLOAT4 simd_mul(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = a.f[i] * b.f[i]; return r;
+}
+inline SIMDFLOAT4 simd_madd(const SIMDFLOAT4 a, const SIMDFLOAT4 b, const SIMDFLOAT4 c) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = a.f[i] * b.f[i] + c.f[i]; return r;
+}
+inline SIMDFLOAT4 simd_min(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = a.f[i] < b.f[i] ? a.f[i] : b.f[i]; return r;
+}
+inline SIMDMASK4 simd_none(void) {
+    SIMDMASK4 r = { { false, false, false, false } }; return r;
+}
+inline SIMDMASK4 simd_lt(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDMASK4 r; for (int i=0; i!=4; ++i) r.b[i] = a.f[i] < b.f[i]; return r;
+}
+inline SIMDMASK4 simd_le(const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDMASK4 r; for (int i=0; i!=4; ++i) r.b[i] = a.f[i] <= b.f[i]; return r;
+}
+inline SIMDMASK4 simd_and(const SIMDMASK4 a, const SIMDMASK4 b) {
+    SIMDMASK4 r; for (int i=0; i!=4; ++i) r.b[i] = a.b[i] && b.b[i]; return r;
+}
+inline SIMDMASK4 simd_or(const SIMDMASK4 a, const SIMDMASK4 b) {
+    SIMDMASK4 r; for (int i=0; i!=4; ++i) r.b[i] = a.b[i] || b.b[i]; return r;
+}
+inline SIMDFLOAT4 simd_select(const SIMDMASK4 m, const SIMDFLOAT4 a, const SIMDFLOAT4 b) {
+    SIMDFLOAT4 r; for (int i=0; i!=4; ++i) r.f[i] = m.b[i] ? a.f[i] : b.f[i]; return r;
+}
+inline unsigned int simd_bits(const SIMDMASK4 m) {
+    return m.b[0] | (m.b[1] << 1) | (m.b[2] << 2) | (m.b[3] << 3);
+}
+inline void simd_transpose(SIMDFLOAT4 &a, SIMDFLOAT4 &b, SIMDFLOAT4 &c, SIMDFLOAT4 &d) {
+    SIMDFLOAT4 *row[4] = { &a, &b, &c, &d };
+    for (int i=0; i!=4; ++i) {
+        for (int j=i+1; j!=4; ++j) {
+            float f = row[i]->f[j]; row[i]->f[j] = row[j]->f[i]; row[j]->f[i] = f;
+        }
+    }
+}
+
+#endif
+
+#endif
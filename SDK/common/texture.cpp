@@ -56,7 +56,7 @@ TEXTURE::TEXTURE(char *name) : tid(0), width(0), height(0), byte(0),
                                size(0), target(GL_TEXTURE_2D),
                                internal_format(0), format(0),
                                texel_type(0), texel_array(NULL),
-                               n_mipmap(0), compression(0)
+                               n_mipmap(0), compression(0), shared(NULL)
 {
     this->init(name);
 }
@@ -66,21 +66,17 @@ TEXTURE::TEXTURE(char *name, char *filename, const bool relative_path,
                  float anisotropic_filter) :
     tid(0), width(0), height(0), byte(0), size(0),
     target(GL_TEXTURE_2D), internal_format(0), format(0), texel_type(0),
-    texel_array(NULL), n_mipmap(0), compression(0)
+    texel_array(NULL), n_mipmap(0), compression(0), shared(NULL)
 {
     this->init(name);
 
-    MEMORY *m = new MEMORY(filename, relative_path);
-
-    if (m) {
-        this->load(m);
+    TEXTURE *texture = RESOURCE::acquire_texture(filename,
+                                                 relative_path,
+                                                 flags,
+                                                 filter,
+                                                 anisotropic_filter);
 
-        this->generate_id(flags, filter, anisotropic_filter);
-
-        this->free_texel_array();
-        
-        delete m;
-    }
+    if (texture) this->share(texture);
 }
 
 TEXTURE::~TEXTURE()
@@ -102,37 +98,354 @@ void TEXTURE::load(MEMORY *memory)
         this->load_png(memory);
     else if (!strcmp(ext, "PVR"))
         this->load_pvr(memory);
+    else if (!strcmp(ext, "KTX"))
+        this->load_ktx(memory);
+}
+
+
+bool TEXTURE::load_file(const char      *filename,
+                        const bool      relative_path,
+                        unsigned int    flags,
+                        unsigned char   filter,
+                        float           anisotropic_filter)
+{
+    MEMORY *m = new MEMORY(filename, relative_path);
+
+    bool loaded = m->buffer != NULL;
+
+    if (loaded) {
+        this->load(m);
+
+        // The encoded file is no longer needed once decoded; drop it
+        // before the upload so only the texels are held in memory.
+        delete m;
+
+        m = NULL;
+
+        if (flags & TEXTURE_CUBE_MAP) this->extract_cube_faces();
+
+        loaded = this->texel_array != NULL;
+
+        if (loaded) this->generate_id(flags, filter, anisotropic_filter);
+
+        this->free_texel_array();
+    }
+
+    if (m) delete m;
+
+    return loaded;
+}
+
+
+// Point this texture at the GL object owned by a registry texture.  The
+// reference taken by RESOURCE::acquire_texture() is handed back by
+// delete_id().
+void TEXTURE::share(TEXTURE *texture)
+{
+    this->delete_id();
+
+    strcpy(this->name, texture->name);
+
+    this->tid             = texture->tid;
+    this->width           = texture->width;
+    this->height          = texture->height;
+    this->byte            = texture->byte;
+    this->size            = texture->size;
+    this->target          = texture->target;
+    this->internal_format = texture->internal_format;
+    this->format          = texture->format;
+    this->texel_type      = texture->texel_type;
+    this->n_mipmap        = texture->n_mipmap;
+    this->compression     = texture->compression;
+    this->shared          = texture;
+}
+
+
+typedef struct
+{
+    const char *filename;
+
+    bool relative_path;
+
+    TEXTURE *texture;
+
+} TEXTURECUBEFACE;
+
+
+static void *TEXTURE_load_face(void *ptr)
+{
+    TEXTURECUBEFACE *face = (TEXTURECUBEFACE *)ptr;
+
+    MEMORY *m = new MEMORY(face->filename, face->relative_path);
+
+    if (m->buffer) face->texture->load(m);
+
+    delete m;
+
+    return NULL;
+}
+
+
+// Build a cube map from six images given in +X, -X, +Y, -Y, +Z, -Z
+// order.  The faces are decoded concurrently, one thread each, and then
+// uploaded together by generate_id().
+bool TEXTURE::load_cube_files(const char    *filename[6],
+                              const bool    relative_path,
+                              unsigned int  flags,
+                              unsigned char filter,
+                              float         anisotropic_filter)
+{
+    TEXTURECUBEFACE face[6];
+
+    pthread_t thread[6];
+
+    bool started[6],
+         loaded = true;
+
+    for (int i=0; i!=6; ++i) {
+        face[i].filename      = filename[i];
+        face[i].relative_path = relative_path;
+        face[i].texture       = new TEXTURE(NULL);
+
+        started[i] = !pthread_create(&thread[i],
+                                     NULL,
+                                     TEXTURE_load_face,
+                                     (void *)&face[i]);
+
+        if (!started[i]) TEXTURE_load_face(&face[i]);
+    }
+
+    for (int i=0; i!=6; ++i) {
+        if (started[i]) pthread_join(thread[i], NULL);
+    }
+
+    for (int i=0; i!=6; ++i) {
+        TEXTURE *texture = face[i].texture;
+
+        if (!texture->texel_array                  ||
+            texture->compression                   ||
+            texture->width  != texture->height     ||
+            texture->width  != face[0].texture->width ||
+            texture->format != face[0].texture->format) {
+            loaded = false;
+
+            break;
+        }
+    }
+
+    if (loaded) {
+        TEXTURE *texture = face[0].texture;
+
+        unsigned int row_size,
+                     face_size;
+
+        this->delete_id();
+
+        this->free_texel_array();
+
+        this->width           = texture->width;
+        this->height          = texture->height;
+        this->byte            = texture->byte;
+        this->target          = GL_TEXTURE_CUBE_MAP;
+        this->internal_format = texture->internal_format;
+        this->format          = texture->format;
+        this->texel_type      = texture->texel_type;
+        this->n_mipmap        = 0;
+        this->compression     = 0;
+
+        row_size  = this->width * this->byte;
+        face_size = row_size * this->height;
+
+        this->size = face_size * 6;
+
+        this->texel_array = (unsigned char *) malloc(this->size);
+
+        // Decoded images are stored bottom-up, cube faces are top-down.
+        for (int i=0; i!=6; ++i) {
+            for (int j=0; j!=this->height; ++j)
+                memcpy(this->texel_array + (i * face_size) + (j * row_size),
+                       face[i].texture->texel_array +
+                       ((this->height - (j + 1)) * row_size),
+                       row_size);
+
+            face[i].texture->free_texel_array();
+        }
+    }
+
+    for (int i=0; i!=6; ++i) delete face[i].texture;
+
+    if (loaded) {
+        this->generate_id(flags, filter, anisotropic_filter);
+
+        this->free_texel_array();
+    }
+
+    return loaded;
+}
+
+
+// Split a single decoded image holding a horizontal or vertical strip,
+// or a horizontal or vertical cross, into the six faces of a cube map.
+// Images with any other aspect ratio are left as a 2D texture.
+void TEXTURE::extract_cube_faces()
+{
+    // Column and row, counted from the top left, of each face.
+    static const unsigned char horizontal_cross[6][2] = { { 2, 1 },
+                                                          { 0, 1 },
+                                                          { 1, 0 },
+                                                          { 1, 2 },
+                                                          { 1, 1 },
+                                                          { 3, 1 } };
+
+    static const unsigned char vertical_cross[6][2] = { { 2, 1 },
+                                                        { 0, 1 },
+                                                        { 1, 0 },
+                                                        { 1, 2 },
+                                                        { 1, 1 },
+                                                        { 1, 3 } };
+
+    unsigned int w = this->width,
+                 h = this->height,
+                 face_width,
+                 row_size,
+                 face_size;
+
+    unsigned char *texel_array;
+
+    if (!this->texel_array || this->compression ||
+        this->target != GL_TEXTURE_2D)
+        return;
+
+    if      (w == h * 6)     face_width = h;
+    else if (h == w * 6)     face_width = w;
+    else if (w * 3 == h * 4) face_width = w >> 2;
+    else if (w * 4 == h * 3) face_width = h >> 2;
+    else return;
+
+    row_size  = face_width * this->byte;
+    face_size = row_size * face_width;
+
+    texel_array = (unsigned char *) malloc(face_size * 6);
+
+    for (int i=0; i!=6; ++i) {
+        unsigned int column,
+                     row;
+
+        // The -Z face of a vertical cross is stored upside down.
+        bool rotate = false;
+
+        if      (w == h * 6)     { column = i; row = 0; }
+        else if (h == w * 6)     { column = 0; row = i; }
+        else if (w * 3 == h * 4) { column = horizontal_cross[i][0];
+                                   row    = horizontal_cross[i][1]; }
+        else                     { column = vertical_cross[i][0];
+                                   row    = vertical_cross[i][1];
+                                   rotate = i == 5; }
+
+        for (unsigned int j=0; j!=face_width; ++j) {
+            unsigned int src_row = row * face_width +
+                                   (rotate ? face_width - (j + 1) : j);
+
+            unsigned char *src = this->texel_array +
+                                 ((h - (src_row + 1)) * w * this->byte) +
+                                 (column * row_size),
+                          *dst = texel_array + (i * face_size) + (j * row_size);
+
+            if (!rotate)
+                memcpy(dst, src, row_size);
+            else {
+                for (unsigned int k=0; k!=face_width; ++k)
+                    memcpy(dst + (k * this->byte),
+                           src + ((face_width - (k + 1)) * this->byte),
+                           this->byte);
+            }
+        }
+    }
+
+    free(this->texel_array);
+
+    this->texel_array = texel_array;
+    this->width       =
+    this->height      = face_width;
+    this->size        = face_size * 6;
+    this->target      = GL_TEXTURE_CUBE_MAP;
 }
 
 
-void png_memory_read(png_structp structp, png_bytep bytep, png_size_t size)
+// libpng source reading straight out of the MEMORY buffer.  Only the
+// bytes libpng asks for are copied, and they go directly into its own
+// input buffer instead of through MEMORY::read().
+typedef struct
+{
+    const unsigned char *position;
+
+    const unsigned char *end;
+
+} PNGCURSOR;
+
+
+static void png_cursor_read(png_structp structp, png_bytep bytep, png_size_t size)
 {
-    MEMORY *m = (MEMORY *) png_get_io_ptr(structp);
+    PNGCURSOR *cursor = (PNGCURSOR *) png_get_io_ptr(structp);
+
+    if ((png_size_t)(cursor->end - cursor->position) < size)
+        png_error(structp, "unexpected end of PNG data");
+
+    memcpy(bytep, cursor->position, size);
 
-    m->read(bytep, size);
+    cursor->position += size;
 }
 
 
+// Decode a PNG into texel_array.  The buffer is allocated once at its
+// final size and rows are decoded one at a time straight into their
+// bottom-up position, so no row-pointer table or intermediate image is
+// needed.
 void TEXTURE::load_png(MEMORY *memory)
 {
     png_structp structp;
 
     png_infop infop;
 
-    png_bytep *bytep = NULL;
+    PNGCURSOR cursor;
 
-    int n,
+    int n_pass,
     png_bit_depth,
     png_color_type;
 
+    unsigned int row_size;
+
+    cursor.position = memory->buffer;
+    cursor.end      = memory->buffer + memory->size;
+
     structp = png_create_read_struct(PNG_LIBPNG_VER_STRING,
                                      NULL,
                                      NULL,
                                      NULL);
 
+    if (!structp) return;
+
     infop = png_create_info_struct(structp);
 
-    png_set_read_fn(structp, (png_voidp *)memory, png_memory_read);
+    if (!infop) {
+        png_destroy_read_struct(&structp, NULL, NULL);
+
+        return;
+    }
+
+    if (setjmp(png_jmpbuf(structp))) {
+        png_destroy_read_struct(&structp, &infop, NULL);
+
+        this->free_texel_array();
+
+        this->width  =
+        this->height =
+        this->size   = 0;
+
+        return;
+    }
+
+    png_set_read_fn(structp, (png_voidp)&cursor, png_cursor_read);
 
     png_read_info(structp, infop);
 
@@ -156,6 +469,8 @@ void TEXTURE::load_png(MEMORY *memory)
         png_color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
         png_set_gray_to_rgb(structp);
 
+    n_pass = png_set_interlace_handling(structp);
+
     png_read_update_info(structp, infop);
 
     png_get_IHDR(structp,
@@ -198,29 +513,29 @@ void TEXTURE::load_png(MEMORY *memory)
 
     this->texel_type = GL_UNSIGNED_BYTE;
 
-    this->size = this->width * this->height * this->byte;
+    row_size = this->width * this->byte;
+
+    assert(row_size == png_get_rowbytes(structp, infop));
+
+    this->size = row_size * this->height;
 
     this->texel_array = (unsigned char *) malloc(this->size);
 
-    bytep = (png_bytep *) malloc(this->height * sizeof(png_bytep));
-    
-    
-    for (int i=0; i!=this->height; ++i) {
-        n = this->height - (i + 1);
-        
-        bytep[n] = this->texel_array + (n * this->width * this->byte);
+    // GL expects the first row at the bottom of the image.  Interlaced
+    // images need every pass to revisit the same destination rows.
+    for (int pass=0; pass!=n_pass; ++pass) {
+        for (int i=0; i!=this->height; ++i) {
+            png_read_row(structp,
+                         this->texel_array + ((this->height - (i + 1)) * row_size),
+                         NULL);
+        }
     }
-    
-    
-    png_read_image(structp, bytep);
-    
+
     png_read_end(structp, NULL);
-    
+
     png_destroy_read_struct(&structp,
                             &infop,
                             NULL);
-    
-    free(bytep);
 }
 
 
@@ -261,9 +576,103 @@ void TEXTURE::load_pvr(MEMORY *memory)
 }
 
 
+// Uncompressed 8 bit KTX files holding either a 2D image or a cube map.
+// Only the base level is read; TEXTURE_MIPMAP builds the rest.
+void TEXTURE::load_ktx(MEMORY *memory)
+{
+    static const unsigned char ktx_identifier[12] = { 0xAB, 'K', 'T', 'X',
+                                                      ' ', '1', '1', 0xBB,
+                                                      '\r', '\n', 0x1A, '\n' };
+
+    KTXHEADER *ktxheader = (KTXHEADER *)memory->buffer;
+
+    const unsigned char *data;
+
+    unsigned int row_size,
+                 ktx_row_size,
+                 ktx_face_size,
+                 face_size;
+
+    if (memory->size < sizeof(KTXHEADER) + sizeof(unsigned int) ||
+        memcmp(ktxheader->identifier, ktx_identifier, sizeof(ktx_identifier)) ||
+        ktxheader->endianness != 0x04030201)
+        return;
+
+    if (ktxheader->gl_type != GL_UNSIGNED_BYTE ||
+        ktxheader->pixel_depth > 1             ||
+        ktxheader->n_array_element             ||
+        (ktxheader->n_face != 1 && ktxheader->n_face != 6))
+        return;
+
+    // Cube faces must be square, and the size has to fit TEXTURE's
+    // 16 bit width/height.
+    if (!ktxheader->pixel_width                 ||
+        !ktxheader->pixel_height                ||
+        ktxheader->pixel_width  > 0xFFFF        ||
+        ktxheader->pixel_height > 0xFFFF        ||
+        (ktxheader->n_face == 6 &&
+         ktxheader->pixel_width != ktxheader->pixel_height))
+        return;
+
+    // The key/value block is skipped, so bound it by what is left of the
+    // file before using it as an offset.
+    if (ktxheader->bytes_of_key_value_data >
+        memory->size - (sizeof(KTXHEADER) + sizeof(unsigned int)))
+        return;
+
+    switch (ktxheader->gl_format) {
+        case GL_LUMINANCE:       this->byte = 1; break;
+        case GL_LUMINANCE_ALPHA: this->byte = 2; break;
+        case GL_RGB:             this->byte = 3; break;
+        case GL_RGBA:            this->byte = 4; break;
+        default: return;
+    }
+
+    row_size      = ktxheader->pixel_width * this->byte;
+    ktx_row_size  = (row_size + 3) & ~3;
+    ktx_face_size = ktx_row_size * ktxheader->pixel_height;
+    face_size     = row_size * ktxheader->pixel_height;
+
+    data = memory->buffer + sizeof(KTXHEADER) +
+           ktxheader->bytes_of_key_value_data + sizeof(unsigned int);
+
+    if ((unsigned long long)ktx_row_size * ktxheader->pixel_height *
+        ktxheader->n_face > (unsigned int)(memory->buffer + memory->size - data))
+        return;
+
+    this->width           = ktxheader->pixel_width;
+    this->height          = ktxheader->pixel_height;
+    this->internal_format =
+    this->format          = ktxheader->gl_format;
+    this->texel_type      = GL_UNSIGNED_BYTE;
+    this->target          = ktxheader->n_face == 6 ?
+                            GL_TEXTURE_CUBE_MAP :
+                            GL_TEXTURE_2D;
+    this->size            = face_size * ktxheader->n_face;
+
+    this->texel_array = (unsigned char *) malloc(this->size);
+
+    // KTX rows run top-down and are padded to four bytes.  2D images are
+    // flipped to the bottom-up order used by the rest of TEXTURE, cube
+    // faces are kept top-down.
+    for (unsigned int i=0; i!=ktxheader->n_face; ++i) {
+        for (int j=0; j!=this->height; ++j) {
+            int row = this->target == GL_TEXTURE_2D ?
+                      this->height - (j + 1) :
+                      j;
+
+            memcpy(this->texel_array + (i * face_size) + (row * row_size),
+                   data + (i * ktx_face_size) + (j * ktx_row_size),
+                   row_size);
+        }
+    }
+}
+
+
 void TEXTURE::convert_16_bits(unsigned int use_5551)
 {
-    unsigned int s = this->width * this->height,
+    unsigned int s = this->width * this->height *
+                     (this->target == GL_TEXTURE_CUBE_MAP ? 6 : 1),
     *t = NULL;
 
     unsigned short *texel_array = NULL;
@@ -271,32 +680,20 @@ void TEXTURE::convert_16_bits(unsigned int use_5551)
     switch (this->byte) {
         case 3:
         {
-            unsigned char *tmp_array = NULL;
+            // Pack in place; each 16 bit texel is written at or behind
+            // the 24 bit texel it is built from.
+            unsigned char *rgb = this->texel_array;
 
-            this->byte		 = 4;
-            this->size		 = s * this->byte;
+            this->byte       = 2;
+            this->size       = s * this->byte;
             this->texel_type = GL_UNSIGNED_SHORT_5_6_5;
 
-            tmp_array = (unsigned char *) malloc(this->size);
-
-            for (int i=0, j=0; i!=this->size; i+=this->byte, j+=3) {
-                tmp_array[i  ] = this->texel_array[j  ];
-                tmp_array[i+1] = this->texel_array[j+1];
-                tmp_array[i+2] = this->texel_array[j+2];
-                tmp_array[i+3] = 255;
-            }
-
-            free(this->texel_array);
-            this->texel_array = tmp_array;
-
             texel_array = (unsigned short *)this->texel_array;
 
-            t = (unsigned int *)this->texel_array;
-
-            for (int i=0; i!=s; ++i, ++t) {
-                *texel_array++ = ((( *t        & 0xff) >> 3) << 11) |
-                ((((*t >>  8) & 0xff) >> 2) <<  5) |
-                ((*t >> 16) & 0xff) >> 3;
+            for (int i=0; i!=s; ++i, rgb+=3) {
+                *texel_array++ = ((rgb[0] >> 3) << 11) |
+                                 ((rgb[1] >> 2) <<  5) |
+                                  (rgb[2] >> 3);
             }
 
             break;
@@ -347,19 +744,21 @@ void TEXTURE::generate_id(unsigned int flags,
 
 
     if (!this->compression) {
-        switch (this->byte) {
-            case 1: glPixelStorei(GL_PACK_ALIGNMENT, 1); break;
-            case 2: glPixelStorei(GL_PACK_ALIGNMENT, 2); break;
-            case 3:
-            case 4: glPixelStorei(GL_PACK_ALIGNMENT, 4); break;
-        }
-
         if (flags & TEXTURE_16_BITS)
             this->convert_16_bits(flags & TEXTURE_16_BITS_5551);
+
+        // Rows are tightly packed, so the unpack alignment has to follow
+        // the row size rather than the texel size.
+        unsigned int row_size = this->width *
+                                (this->texel_type == GL_UNSIGNED_BYTE ?
+                                 this->byte : 2);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT,
+                      !(row_size & 3) ? 4 : !(row_size & 1) ? 2 : 1);
     }
 
 
-    if (flags & TEXTURE_CLAMP) {
+    if (flags & TEXTURE_CLAMP || this->target == GL_TEXTURE_CUBE_MAP) {
         glTexParameteri(this->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(this->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     } else {
@@ -461,6 +860,19 @@ void TEXTURE::generate_id(unsigned int flags,
             width  >>= 1;
             height >>= 1;
         }
+    } else if (this->target == GL_TEXTURE_CUBE_MAP) {
+        unsigned int face_size = this->size / 6;
+
+        for (int i=0; i!=6; ++i)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                         0,
+                         this->internal_format,
+                         this->width,
+                         this->height,
+                         0,
+                         this->format,
+                         this->texel_type,
+                         &this->texel_array[i * face_size]);
     } else {
         glTexImage2D(this->target,
                      0,
@@ -480,7 +892,12 @@ void TEXTURE::generate_id(unsigned int flags,
 
 void TEXTURE::delete_id()
 {
-    if (this->tid) {
+    if (this->shared) {
+        RESOURCE::release_texture(this->shared);
+
+        this->shared = NULL;
+        this->tid    = 0;
+    } else if (this->tid) {
         glDeleteTextures(1, &this->tid);
         this->tid = 0;
     }
@@ -506,23 +923,15 @@ void TEXTURE::build(char            *texture_path,
                     unsigned char   filter,
                     float           anisotropic_filter)
 {
-    MEMORY *m = NULL;
-
     char filename[MAX_PATH] = {""};
 
     sprintf(filename, "%s%s", texture_path, this->name);
 
-    m = new MEMORY(filename, false);
+    TEXTURE *texture = RESOURCE::acquire_texture(filename,
+                                                 false,
+                                                 flags,
+                                                 filter,
+                                                 anisotropic_filter);
 
-    if (m) {
-        this->load(m);
-
-        this->generate_id(flags,
-                          filter,
-                          anisotropic_filter);
-        
-        this->free_texel_array();
-        
-        delete m;
-    }
+    if (texture) this->share(texture);
 }
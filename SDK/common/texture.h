@@ -51,7 +51,8 @@ enum
     TEXTURE_CLAMP        = ( 1 << 0 ),
     TEXTURE_MIPMAP       = ( 1 << 1 ),
     TEXTURE_16_BITS      = ( 1 << 2 ),
-    TEXTURE_16_BITS_5551 = ( 1 << 3 )
+    TEXTURE_16_BITS_5551 = ( 1 << 3 ),
+    TEXTURE_CUBE_MAP     = ( 1 << 4 )
 };
 
 
@@ -95,6 +96,39 @@ typedef struct
 } PVRHEADER;
 
 
+typedef struct
+{
+    unsigned char identifier[12];
+
+    unsigned int endianness;
+
+    unsigned int gl_type;
+
+    unsigned int gl_type_size;
+
+    unsigned int gl_format;
+
+    unsigned int gl_internal_format;
+
+    unsigned int gl_base_internal_format;
+
+    unsigned int pixel_width;
+
+    unsigned int pixel_height;
+
+    unsigned int pixel_depth;
+
+    unsigned int n_array_element;
+
+    unsigned int n_face;
+
+    unsigned int n_mipmap;
+
+    unsigned int bytes_of_key_value_data;
+
+} KTXHEADER;
+
+
 struct TEXTURE {
     char		name[MAX_CHAR];
 
@@ -121,6 +155,10 @@ struct TEXTURE {
     unsigned int	n_mipmap;
     
     unsigned int	compression;
+
+    // Registry owned texture whose GL object this one is borrowing, or
+    // NULL if this texture owns tid itself.
+    TEXTURE		*shared;
 private:
     void init(char *name);
 
@@ -131,8 +169,17 @@ public:
             float anisotropic_filter);
     ~TEXTURE();
     void load(MEMORY *memory);
+    bool load_file(const char *filename, const bool relative_path,
+                   unsigned int flags, unsigned char filter,
+                   float anisotropic_filter);
+    void share(TEXTURE *texture);
     void load_png(MEMORY *memory);
     void load_pvr(MEMORY *memory);
+    void load_ktx(MEMORY *memory);
+    bool load_cube_files(const char *filename[6], const bool relative_path,
+                         unsigned int flags, unsigned char filter,
+                         float anisotropic_filter);
+    void extract_cube_faces();
     void convert_16_bits(unsigned int use_5551);
     void generate_id(unsigned int flags, unsigned char filter,
                      float anisotropic_filter);
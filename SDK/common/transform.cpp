@@ -0,0 +1,313 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+#include "gfx.h"
+
+
+typedef struct
+{
+    TRANSFORMSTORE	*transformstore;
+
+    unsigned int	start;
+
+    unsigned int	end;
+
+    // Rebuild the camera dependent matrices of every entry, not only the
+    // dirty ones.
+    bool		all;
+
+    mat4		view_projection_matrix;
+
+    mat3		view_normal_matrix;
+
+    unsigned int	n_world_update;
+
+    unsigned int	n_view_update;
+
+} TRANSFORMRANGE;
+
+
+// Same Euler to quaternion conversion as OBJMESH::draw3(), expanded
+// straight into the rows of the rotation matrix, which are then scaled
+// and topped with the translation.  This is S * R * T, the matrix
+// translate(), rotate() and scale() build on the GFX stack.
+static void TRANSFORMSTORE_world_matrix(mat4         &m,
+                                        const vec3   &location,
+                                        const vec3   &rotation,
+                                        const vec3   &scale)
+{
+    float alpha(rotation->z * DEG_TO_RAD_DIV_2),
+          beta (rotation->y * DEG_TO_RAD_DIV_2),
+          gamma(rotation->x * DEG_TO_RAD_DIV_2);
+
+    float cosAlpha(cosf(alpha)), sinAlpha(sinf(alpha)),
+          cosBeta (cosf(beta )), sinBeta (sinf(beta )),
+          cosGamma(cosf(gamma)), sinGamma(sinf(gamma));
+
+    float cAcB(cosAlpha*cosBeta),
+          sAsB(sinAlpha*sinBeta),
+          cAsB(cosAlpha*sinBeta),
+          sAcB(sinAlpha*cosBeta);
+
+    float r(cAcB*cosGamma+sAsB*sinGamma),
+          i(cAcB*sinGamma-sAsB*cosGamma),
+          j(cAsB*cosGamma+sAcB*sinGamma),
+          k(sAcB*cosGamma-cAsB*sinGamma);
+
+    m[0][0] = scale->x * (1.0f - 2.0f * (j*j + k*k));
+    m[0][1] = scale->x * (2.0f * (i*j + k*r));
+    m[0][2] = scale->x * (2.0f * (k*i - j*r));
+    m[0][3] = 0.0f;
+
+    m[1][0] = scale->y * (2.0f * (i*j - k*r));
+    m[1][1] = scale->y * (1.0f - 2.0f * (k*k + i*i));
+    m[1][2] = scale->y * (2.0f * (j*k + i*r));
+    m[1][3] = 0.0f;
+
+    m[2][0] = scale->z * (2.0f * (k*i + j*r));
+    m[2][1] = scale->z * (2.0f * (j*k - i*r));
+    m[2][2] = scale->z * (1.0f - 2.0f * (j*j + i*i));
+    m[2][3] = 0.0f;
+
+    m[3][0] = location->x;
+    m[3][1] = location->y;
+    m[3][2] = location->z;
+    m[3][3] = 1.0f;
+}
+
+
+static void *TRANSFORMSTORE_update_range(void *ptr)
+{
+    TRANSFORMRANGE *range = (TRANSFORMRANGE *)ptr;
+
+    TRANSFORMSTORE *store = range->transformstore;
+
+    for (unsigned int i=range->start; i!=range->end; ++i) {
+        if (store->dirty[i]) {
+            TRANSFORMSTORE_world_matrix(store->world_matrix[i],
+                                        store->location[i],
+                                        store->rotation[i],
+                                        store->scale[i]);
+
+            ++range->n_world_update;
+        } else if (!range->all) continue;
+
+        const mat4 &w = store->world_matrix[i];
+
+        store->modelview_matrix[i] = w * store->view_matrix;
+
+        store->modelview_projection_matrix[i] = w * range->view_projection_matrix;
+
+        // The rows of the world matrix are the rotation rows times the
+        // scale, so the inverse transpose of its upper 3x3 is the same
+        // rows divided by the scale instead.  Chain it with the one of the
+        // view matrix rather than inverting every model view matrix.
+        float sx = 1.0f / (store->scale[i]->x * store->scale[i]->x),
+              sy = 1.0f / (store->scale[i]->y * store->scale[i]->y),
+              sz = 1.0f / (store->scale[i]->z * store->scale[i]->z);
+
+        store->normal_matrix[i] = mat3(w[0][0]*sx, w[0][1]*sx, w[0][2]*sx,
+                                       w[1][0]*sy, w[1][1]*sy, w[1][2]*sy,
+                                       w[2][0]*sz, w[2][1]*sz, w[2][2]*sz) *
+                                  range->view_normal_matrix;
+
+        ++range->n_view_update;
+    }
+
+    return NULL;
+}
+
+
+TRANSFORMSTORE::TRANSFORMSTORE(unsigned int n_thread) :
+    view_matrix(1), projection_matrix(1), n_thread(n_thread),
+    n_world_update(0), n_view_update(0)
+{
+    if (!this->n_thread) this->n_thread = 1;
+    else if (this->n_thread > TRANSFORM_MAX_THREAD)
+        this->n_thread = TRANSFORM_MAX_THREAD;
+}
+
+
+unsigned int TRANSFORMSTORE::add(const vec3 &location,
+                                 const vec3 &rotation,
+                                 const vec3 &scale)
+{
+    this->location.push_back(location);
+    this->rotation.push_back(rotation);
+    this->scale.push_back(scale);
+    this->dirty.push_back(1);
+
+    this->world_matrix.push_back(mat4(1));
+    this->modelview_matrix.push_back(mat4(1));
+    this->modelview_projection_matrix.push_back(mat4(1));
+    this->normal_matrix.push_back(mat3(1));
+
+    return this->size() - 1;
+}
+
+
+unsigned int TRANSFORMSTORE::add(const OBJMESH *objmesh)
+{
+    return this->add(objmesh->location, objmesh->rotation, objmesh->scale);
+}
+
+
+// Add every mesh of obj, in order, and return the index of the first one;
+// mesh i of the OBJ is then entry first + i.
+unsigned int TRANSFORMSTORE::add(const OBJ *obj)
+{
+    unsigned int first = this->size();
+
+    for (auto objmesh=obj->objmesh.begin();
+         objmesh!=obj->objmesh.end(); ++objmesh) {
+        this->add(&(*objmesh));
+    }
+
+    return first;
+}
+
+
+void TRANSFORMSTORE::set_location(unsigned int index, const vec3 &location)
+{
+    assert(index < this->size());
+
+    if (this->location[index] != location) {
+        this->location[index] = location;
+        this->dirty[index] = 1;
+    }
+}
+
+
+void TRANSFORMSTORE::set_rotation(unsigned int index, const vec3 &rotation)
+{
+    assert(index < this->size());
+
+    if (this->rotation[index] != rotation) {
+        this->rotation[index] = rotation;
+        this->dirty[index] = 1;
+    }
+}
+
+
+void TRANSFORMSTORE::set_scale(unsigned int index, const vec3 &scale)
+{
+    assert(index < this->size());
+
+    if (this->scale[index] != scale) {
+        this->scale[index] = scale;
+        this->dirty[index] = 1;
+    }
+}
+
+
+// Rebuild the matrices of the entries that changed since the last call,
+// or of all of them if the camera moved.  Large stores are split into
+// contiguous ranges, one per thread, each of which only writes to its own
+// slice of the arrays.
+void TRANSFORMSTORE::update(const mat4 &view_matrix,
+                            const mat4 &projection_matrix)
+{
+    TRANSFORMRANGE range[TRANSFORM_MAX_THREAD];
+
+    pthread_t thread[TRANSFORM_MAX_THREAD];
+
+    bool started[TRANSFORM_MAX_THREAD];
+
+    bool all = memcmp(&this->view_matrix, &view_matrix, sizeof(mat4)) ||
+               memcmp(&this->projection_matrix, &projection_matrix, sizeof(mat4));
+
+    unsigned int n = this->n_thread,
+                 count = this->size();
+
+    // Not worth waking up a thread for less than this many entries.
+    while (n > 1 && count / n < 64) --n;
+
+    this->view_matrix       = view_matrix;
+    this->projection_matrix = projection_matrix;
+
+    this->n_world_update = 0;
+    this->n_view_update  = 0;
+
+    if (!count) return;
+
+    mat4 view_projection_matrix = view_matrix * projection_matrix;
+
+    mat3 view_normal_matrix = mat3(view_matrix[0][0], view_matrix[1][0], view_matrix[2][0],
+                                   view_matrix[0][1], view_matrix[1][1], view_matrix[2][1],
+                                   view_matrix[0][2], view_matrix[1][2], view_matrix[2][2]).inverse();
+
+    for (unsigned int i=0; i!=n; ++i) {
+        range[i].transformstore         = this;
+        range[i].start                  = count * i / n;
+        range[i].end                    = count * (i + 1) / n;
+        range[i].all                    = all;
+        range[i].view_projection_matrix = view_projection_matrix;
+        range[i].view_normal_matrix     = view_normal_matrix;
+        range[i].n_world_update         = 0;
+        range[i].n_view_update          = 0;
+    }
+
+    // The calling thread takes the first range itself.
+    for (unsigned int i=1; i!=n; ++i) {
+        started[i] = !pthread_create(&thread[i],
+                                     NULL,
+                                     TRANSFORMSTORE_update_range,
+                                     (void *)&range[i]);
+
+        if (!started[i]) TRANSFORMSTORE_update_range(&range[i]);
+    }
+
+    TRANSFORMSTORE_update_range(&range[0]);
+
+    for (unsigned int i=1; i!=n; ++i) {
+        if (started[i]) pthread_join(thread[i], NULL);
+    }
+
+    for (unsigned int i=0; i!=n; ++i) {
+        this->n_world_update += range[i].n_world_update;
+        this->n_view_update  += range[i].n_view_update;
+    }
+
+    memset(&this->dirty[0], 0, count);
+}
+
+
+// Use the current model view matrix of gfx as the camera, typically right
+// after look_at().
+void TRANSFORMSTORE::update(GFX *gfx)
+{
+    this->update(gfx->get_modelview_matrix(), gfx->get_projection_matrix());
+}
+
+
+void TRANSFORMSTORE::clear()
+{
+    this->location.clear();
+    this->rotation.clear();
+    this->scale.clear();
+    this->dirty.clear();
+    this->world_matrix.clear();
+    this->modelview_matrix.clear();
+    this->modelview_projection_matrix.clear();
+    this->normal_matrix.clear();
+}
@@ -0,0 +1,91 @@
+/*
+
+GFX Lightweight OpenGLES 2.0 Game and Graphics Engine
+
+Copyright (C) 2011 Romain Marucchi-Foino http://gfx.sio2interactive.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of
+this software. Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that
+you wrote the original software. If you use this software in a product, an acknowledgment
+in the product would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and must not be misrepresented
+as being the original software.
+
+3. This notice may not be removed or altered from any source distribution.
+
+*/
+/*
+ * Structure of arrays store for object transforms.  Locations, rotations
+ * and scales live in parallel arrays, and update() turns every changed
+ * entry into world, model view, model view projection and normal
+ * matrices in a single pass, optionally split over several threads.  The
+ * draw loop then simply indexes the resulting matrix arrays instead of
+ * going through the GFX matrix stack for every mesh.
+ */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+
+#define TRANSFORM_MAX_THREAD 8
+
+
+struct TRANSFORMSTORE {
+    std::vector<vec3>		location;
+
+    // Euler angles in degrees, same convention as OBJMESH::rotation.
+    std::vector<vec3>		rotation;
+
+    std::vector<vec3>		scale;
+
+    // Non zero when the entry changed since the last update().
+    std::vector<unsigned char>	dirty;
+
+    std::vector<mat4>		world_matrix;
+
+    std::vector<mat4>		modelview_matrix;
+
+    std::vector<mat4>		modelview_projection_matrix;
+
+    std::vector<mat3>		normal_matrix;
+
+    // Camera matrices used by the last update().  When they change every
+    // entry has to be rebuilt, otherwise only the dirty ones.
+    mat4			view_matrix;
+
+    mat4			projection_matrix;
+
+    unsigned int		n_thread;
+
+    // Entries whose world matrix, respectively camera dependent matrices,
+    // were rebuilt by the last update().
+    unsigned int		n_world_update;
+
+    unsigned int		n_view_update;
+
+public:
+    TRANSFORMSTORE(unsigned int n_thread=1);
+    ~TRANSFORMSTORE() {}
+    unsigned int add(const vec3 &location, const vec3 &rotation,
+                     const vec3 &scale);
+    unsigned int add(const OBJMESH *objmesh);
+    unsigned int add(const OBJ *obj);
+    void set_location(unsigned int index, const vec3 &location);
+    void set_rotation(unsigned int index, const vec3 &rotation);
+    void set_scale(unsigned int index, const vec3 &scale);
+    void update(const mat4 &view_matrix, const mat4 &projection_matrix);
+    void update(GFX *gfx);
+    unsigned int size() const { return (unsigned int)this->location.size(); }
+    void clear();
+private:
+    TRANSFORMSTORE(const TRANSFORMSTORE &src);
+    TRANSFORMSTORE &operator=(const TRANSFORMSTORE &rhs);
+};
+
+#endif
@@ -240,6 +240,20 @@ void build_frustum(vec4 frustum[6], const mat4 &modelview_matrix, const mat4 &pr
 }
 
 
+void build_frustum(vec4 frustum[6], FRUSTUMPLANES *frustumplanes,
+                   const mat4 &modelview_matrix, const mat4 &projection_matrix)
+{
+    build_frustum(frustum, modelview_matrix, projection_matrix);
+
+    for (int i=0; i!=6; ++i) {
+        frustumplanes->x[i] = frustum[i]->x;
+        frustumplanes->y[i] = frustum[i]->y;
+        frustumplanes->z[i] = frustum[i]->z;
+        frustumplanes->w[i] = frustum[i]->w;
+    }
+}
+
+
 // CRL
 // Note that if the sphere is in the frustum the return value is always
 // dependent on the last iteration through the loop.  What is stored in
@@ -64,6 +64,19 @@ void console_print(const char *str, ...);
 
 void build_frustum(vec4 frustum[6], const mat4 &modelview_matrix, const mat4 &projection_matrix);
 
+// The same normalized planes as build_frustum() with their components
+// split into separate arrays, ready to be broadcast when testing several
+// objects against one plane at a time (see cull.h).
+struct FRUSTUMPLANES {
+    float x[6];
+    float y[6];
+    float z[6];
+    float w[6];
+};
+
+void build_frustum(vec4 frustum[6], FRUSTUMPLANES *frustumplanes,
+                   const mat4 &modelview_matrix, const mat4 &projection_matrix);
+
 float sphere_distance_in_frustum(vec4 *frustum, vec3  *location, float radius);
 
 bool point_in_frustum(vec4 *frustum, vec3 *location);